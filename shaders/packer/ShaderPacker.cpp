@@ -0,0 +1,219 @@
+// Build-time tool packing SPIR-V files into one indexed archive, or turning an archive into
+// a C++ source file that embeds it. Layout is described in src/vulkan/VulkanShaderArchive.h
+//
+// ShaderPacker pack <archive> <variants>
+// ShaderPacker embed <archive> <source.cpp>
+//
+// Variants file has a line per compiled variant: path to SPIR-V, tab, variant key
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr char Magic[4] = {'S', 'P', 'V', 'A'};
+    constexpr std::uint32_t Version = 2;
+    constexpr std::uint32_t DataAlignment = 16;
+    constexpr std::size_t IndexEntrySize = 6 * sizeof(std::uint32_t);
+
+    struct Entry
+    {
+        std::uint64_t hash;
+        std::string key;
+        std::vector<char> data;
+    };
+
+    // 64-bit FNV-1a of the key, runtime computes the same with Hasher::addBytes
+    std::uint64_t HashKey(const std::string& key)
+    {
+        std::uint64_t hash = 0xcbf29ce484222325ull;
+        for (const char c : key)
+        {
+            hash ^= static_cast<std::uint8_t>(c);
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    std::vector<char> ReadFile(const std::string& filename)
+    {
+        std::ifstream file(filename, std::ios::ate | std::ios::binary);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Failed to open file " + filename);
+        }
+
+        const std::streamsize size = file.tellg();
+        std::vector<char> data(size);
+        file.seekg(0);
+        file.read(data.data(), size);
+        return data;
+    }
+
+    void WriteFile(const std::string& filename, const std::vector<char>& data)
+    {
+        std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+        file.write(data.data(), static_cast<std::streamsize>(data.size()));
+        file.close();
+        if (file.fail())
+        {
+            throw std::runtime_error("Failed to write file " + filename);
+        }
+    }
+
+    // archive is always little-endian
+    void AppendU32(std::vector<char>& out, std::uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            out.push_back(static_cast<char>((value >> (i * 8)) & 0xff));
+        }
+    }
+
+    void PutU32(std::vector<char>& out, std::size_t offset, std::uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            out[offset + i] = static_cast<char>((value >> (i * 8)) & 0xff);
+        }
+    }
+
+    void Pack(const std::string& archiveFilename, const std::string& variantsFilename)
+    {
+        std::ifstream variants(variantsFilename);
+        if (!variants.is_open())
+        {
+            throw std::runtime_error("Failed to open file " + variantsFilename);
+        }
+
+        std::vector<Entry> entries;
+        std::string line;
+        while (std::getline(variants, line))
+        {
+            const std::size_t tab = line.find('\t');
+            if (tab == std::string::npos)
+                continue;
+
+            Entry entry = {
+                .hash = 0,
+                .key = line.substr(tab + 1),
+                .data = ReadFile(line.substr(0, tab))
+            };
+            entry.hash = HashKey(entry.key);
+
+            if (entry.data.empty() || entry.data.size() % 4 != 0)
+            {
+                throw std::runtime_error(line.substr(0, tab) + " is not a SPIR-V binary");
+            }
+            entries.push_back(std::move(entry));
+        }
+
+        // sorted, so runtime can binary search the index
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.hash < b.hash; });
+        for (std::size_t i = 1; i < entries.size(); ++i)
+        {
+            if (entries[i].hash == entries[i - 1].hash)
+            {
+                throw std::runtime_error("Variant keys " + entries[i - 1].key + " and " + entries[i].key +
+                                         " have the same hash");
+            }
+        }
+
+        std::vector<char> out(Magic, Magic + 4);
+        AppendU32(out, Version);
+        AppendU32(out, static_cast<std::uint32_t>(entries.size()));
+        AppendU32(out, 0);
+
+        // index is filled in once keys and blobs are placed
+        const std::size_t indexOffset = out.size();
+        out.resize(out.size() + entries.size() * IndexEntrySize);
+
+        std::vector<std::uint32_t> keyOffsets;
+        for (const Entry& entry : entries)
+        {
+            keyOffsets.push_back(static_cast<std::uint32_t>(out.size()));
+            out.insert(out.end(), entry.key.begin(), entry.key.end());
+        }
+
+        std::ofstream manifest(archiveFilename + ".manifest", std::ios::trunc);
+        for (std::size_t i = 0; i < entries.size(); ++i)
+        {
+            out.resize((out.size() + DataAlignment - 1) / DataAlignment * DataAlignment);
+            const auto dataOffset = static_cast<std::uint32_t>(out.size());
+            out.insert(out.end(), entries[i].data.begin(), entries[i].data.end());
+
+            const std::size_t entryOffset = indexOffset + i * IndexEntrySize;
+            PutU32(out, entryOffset + 0, static_cast<std::uint32_t>(entries[i].hash));
+            PutU32(out, entryOffset + 4, static_cast<std::uint32_t>(entries[i].hash >> 32));
+            PutU32(out, entryOffset + 8, keyOffsets[i]);
+            PutU32(out, entryOffset + 12, static_cast<std::uint32_t>(entries[i].key.size()));
+            PutU32(out, entryOffset + 16, dataOffset);
+            PutU32(out, entryOffset + 20, static_cast<std::uint32_t>(entries[i].data.size()));
+
+            manifest << std::hex << std::setw(16) << std::setfill('0') << entries[i].hash << std::dec
+                     << ' ' << std::setw(8) << std::setfill(' ') << entries[i].data.size() << ' ' << entries[i].key << '\n';
+        }
+
+        WriteFile(archiveFilename, out);
+        std::cout << "Packed " << entries.size() << " shader variants into " << archiveFilename
+                  << " (" << out.size() << " bytes)\n";
+    }
+
+    void Embed(const std::string& archiveFilename, const std::string& sourceFilename)
+    {
+        const std::vector<char> archive = ReadFile(archiveFilename);
+
+        std::ofstream file(sourceFilename, std::ios::trunc);
+        file << "// generated by ShaderPacker from " << archiveFilename << ", do not edit\n"
+             << "#include <cstddef>\n#include <cstdint>\n\n"
+             << "alignas(" << DataAlignment << ") extern const std::uint8_t EmbeddedShaderArchive[] = {";
+
+        for (std::size_t i = 0; i < archive.size(); ++i)
+        {
+            file << (i % 16 == 0 ? "\n    " : " ") << static_cast<unsigned>(static_cast<std::uint8_t>(archive[i])) << ',';
+        }
+
+        file << "\n};\n\nextern const std::size_t EmbeddedShaderArchiveSize = " << archive.size() << ";\n";
+        file.close();
+        if (file.fail())
+        {
+            throw std::runtime_error("Failed to write file " + sourceFilename);
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        if (argc == 4 && std::strcmp(argv[1], "pack") == 0)
+        {
+            Pack(argv[2], argv[3]);
+        }
+        else if (argc == 4 && std::strcmp(argv[1], "embed") == 0)
+        {
+            Embed(argv[2], argv[3]);
+        }
+        else
+        {
+            std::cerr << "Usage: ShaderPacker pack <archive> <variants>\n"
+                         "       ShaderPacker embed <archive> <source.cpp>\n";
+            return EXIT_FAILURE;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "ShaderPacker: " << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -5,7 +5,10 @@ layout(location = 1) in vec3 inColor;
 
 layout(location = 0) out vec3 fragColor;
 
+// specialization constants, folded by the driver when the pipeline is compiled
+layout(constant_id = 0) const bool USE_VERTEX_COLOR = true;
+
 void main() {
     gl_Position = vec4(inPosition, 0.0, 1.0);
-    fragColor = inColor;
+    fragColor = USE_VERTEX_COLOR ? inColor : vec3(1.0);
 }
\ No newline at end of file
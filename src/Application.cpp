@@ -1,22 +1,83 @@
 #include "Application.h"
 
+#include <chrono>
+
 #include <spdlog/spdlog.h>
 
 #include "glfw/GLFWContext.h"
+#include "utility/CpuProfiler.h"
 #include "vulkan/VulkanContext.h"
 
+Application::Application(const VulkanConfig& vulkanConfig, std::uint64_t frameLimit, std::uint32_t benchmarkDrawCount)
+    : m_vulkanConfig(vulkanConfig), m_frameLimit(frameLimit), m_benchmarkDrawCount(benchmarkDrawCount)
+{
+}
+
 void Application::run()
 {
-    GLFWContext::Initialize(1280, 720, "VulkanApp");
-    VulkanContext::Initialize();
+    if (!m_vulkanConfig.headless)
+    {
+        GLFWContext::Initialize(1280, 720, "VulkanApp");
+    }
+    VulkanContext::Initialize(m_vulkanConfig);
+
+    if (m_benchmarkDrawCount != 0)
+    {
+        VulkanContext::BenchmarkDispatch(m_benchmarkDrawCount);
+        return;
+    }
+
     mainLoop();
 }
 
+bool Application::shouldClose() const
+{
+    if (m_vulkanConfig.headless)
+        return false;
+
+    return GLFWContext::Get().appShouldClose();
+}
+
 void Application::mainLoop()
 {
-    while (!GLFWContext::Get().appShouldClose())
+    const auto startTime = std::chrono::steady_clock::now();
+    std::uint64_t frameCount = 0;
+
+    CpuProfiler::SetThreadName("main");
+
+    while (!shouldClose())
     {
-        GLFWContext::Get().pollEvents();
+        CPU_PROFILE_ZONE("frame");
+
+        if (!m_vulkanConfig.headless)
+        {
+            GLFWContext::Get().pollEvents();
+
+            // nothing to present to, sleep until window is restored
+            if (GLFWContext::Get().isMinimized())
+            {
+                GLFWContext::Get().waitEvents();
+                continue;
+            }
+        }
+
         VulkanContext::DrawFrame();
+
+        if (++frameCount == m_frameLimit)
+            break;
     }
-}
\ No newline at end of file
+
+    // include GPU time of the last frames into measurement
+    VulkanContext::WaitIdle();
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+    spdlog::info("Rendered {} frames in {:.3f} s ({:.1f} FPS, {:.3f} ms per frame)",
+        frameCount, elapsed.count(),
+        static_cast<double>(frameCount) / elapsed.count(),
+        elapsed.count() * 1000.0 / static_cast<double>(std::max<std::uint64_t>(frameCount, 1)));
+
+    for (const VulkanGpuProfiler::ScopeTiming& timing : VulkanContext::GetGpuTimings())
+    {
+        spdlog::info("GPU {:>{}}{}: {:.3f} ms", "", timing.depth * 2, timing.name, timing.durationMs);
+    }
+}
@@ -1,14 +1,29 @@
 #ifndef APPLICATION_H
 #define APPLICATION_H
 
+#include <cstdint>
+
+#include "vulkan/VulkanConfig.h"
+
 class Application {
 
 public:
+    // frameLimit of zero means rendering until window is closed.
+    // Non zero benchmarkDrawCount runs the dispatch benchmark instead of rendering
+    explicit Application(const VulkanConfig& vulkanConfig = {}, std::uint64_t frameLimit = 0,
+                         std::uint32_t benchmarkDrawCount = 0);
+
     void run();
 
 private:
     void mainLoop();
 
+    bool shouldClose() const;
+
+private:
+    VulkanConfig m_vulkanConfig;
+    std::uint64_t m_frameLimit;
+    std::uint32_t m_benchmarkDrawCount;
 };
 
 
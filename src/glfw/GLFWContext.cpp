@@ -3,8 +3,11 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include <utility>
+
 #include <spdlog/spdlog.h>
 
+#include "utility/CpuProfiler.h"
 #include "utility/Utility.h"
 
 GLFWContext GLFWContext::s_instance;
@@ -34,6 +37,17 @@ std::pair<int, int> GLFWContext::getFrameBufferSize()
     return {width, height};
 }
 
+bool GLFWContext::consumeFramebufferResized()
+{
+    return std::exchange(m_framebufferResized, false);
+}
+
+bool GLFWContext::isMinimized()
+{
+    auto [width, height] = getFrameBufferSize();
+    return width == 0 || height == 0;
+}
+
 void GLFWContext::createVulkanWindowSurface(vk::Instance instance, vk::SurfaceKHR& surface) const
 {
     auto cStyleSurface = static_cast<VkSurfaceKHR>(surface);
@@ -47,9 +61,15 @@ void GLFWContext::createVulkanWindowSurface(vk::Instance instance, vk::SurfaceKH
 
 void GLFWContext::pollEvents()
 {
+    CPU_PROFILE_ZONE("GLFWContext::pollEvents");
     glfwPollEvents();
 }
 
+void GLFWContext::waitEvents()
+{
+    glfwWaitEvents();
+}
+
 GLFWContext::~GLFWContext()
 {
     glfwDestroyWindow(m_window);
@@ -64,6 +84,10 @@ void GLFWContext::Initialize(int width, int height, const std::string& title)
 
     glfwInit();
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
     s_instance.m_window = glfwCreateWindow(width, height, title.c_str(), nullptr, nullptr);
+
+    glfwSetFramebufferSizeCallback(s_instance.m_window, [](GLFWwindow*, int, int) {
+        s_instance.m_framebufferResized = true;
+    });
 }
@@ -25,14 +25,20 @@ public:
 
     NODISCARD std::pair<int, int> getFrameBufferSize();
 
+    // returns true once after each framebuffer resize
+    NODISCARD bool consumeFramebufferResized();
+    NODISCARD bool isMinimized();
+
     void createVulkanWindowSurface(vk::Instance instance, vk::SurfaceKHR& surface) const;
 
     void pollEvents();
+    void waitEvents();
 
 private:
     GLFWContext() = default;
 
     GLFWwindow* m_window = nullptr;
+    bool m_framebufferResized = false;
 
     static GLFWContext s_instance;
 };
@@ -1,13 +1,90 @@
 #include <spdlog/spdlog.h>
 
+#include <cstring>
+#include <string>
+
 #include "Application.h"
+#include "utility/CpuProfiler.h"
 
-int main()
+int main(int argc, char** argv)
 {
-    Application app;
+    VulkanConfig vulkanConfig;
+    std::uint64_t frameLimit = 0;
+    std::uint32_t benchmarkDrawCount = 0;
+    std::string cpuTraceFilename;
+
     try
     {
+        for (int i = 1; i < argc; ++i)
+        {
+            if (std::strcmp(argv[i], "--headless") == 0)
+            {
+                vulkanConfig.headless = true;
+            }
+            else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            {
+                frameLimit = std::stoull(argv[++i]);
+            }
+            else if (std::strcmp(argv[i], "--cache-commands") == 0)
+            {
+                vulkanConfig.cacheCommandBuffers = true;
+            }
+            else if (std::strcmp(argv[i], "--record-threads") == 0 && i + 1 < argc)
+            {
+                vulkanConfig.recordingThreads = static_cast<std::uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (std::strcmp(argv[i], "--bench-dispatch") == 0 && i + 1 < argc)
+            {
+                benchmarkDrawCount = static_cast<std::uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (std::strcmp(argv[i], "--pipeline-cache") == 0 && i + 1 < argc)
+            {
+                vulkanConfig.pipelineCacheFilename = argv[++i];
+            }
+            else if (std::strcmp(argv[i], "--compile-threads") == 0 && i + 1 < argc)
+            {
+                vulkanConfig.pipelineCompileThreads = static_cast<std::uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (std::strcmp(argv[i], "--staging-size") == 0 && i + 1 < argc)
+            {
+                vulkanConfig.stagingRingSize = std::stoull(argv[++i]) << 20;
+            }
+            else if (std::strcmp(argv[i], "--no-direct-writes") == 0)
+            {
+                vulkanConfig.directBufferWrites = false;
+            }
+            else if (std::strcmp(argv[i], "--cpu-trace") == 0 && i + 1 < argc)
+            {
+                cpuTraceFilename = argv[++i];
+            }
+            else
+            {
+                throw std::runtime_error(std::string("Unknown argument ") + argv[i] +
+                                         ". Usage: VulkanApp [--headless] [--frames N] [--record-threads N] [--cache-commands]"
+                                         " [--bench-dispatch DRAWS] [--cpu-trace FILE]"
+                                         " [--pipeline-cache FILE] [--compile-threads N] [--staging-size MIB] [--no-direct-writes]");
+            }
+        }
+
+        // there is no window to close, frame limit is the only way a headless run ends
+        if (vulkanConfig.headless && frameLimit == 0 && benchmarkDrawCount == 0)
+        {
+            throw std::runtime_error("--headless needs --frames N with N greater than zero");
+        }
+
+        // profiler can also be toggled at runtime, this only enables it from the very first frame
+        if (!cpuTraceFilename.empty())
+        {
+            CpuProfiler::SetEnabled(true);
+        }
+
+        Application app(vulkanConfig, frameLimit, benchmarkDrawCount);
         app.run();
+
+        if (!cpuTraceFilename.empty())
+        {
+            CpuProfiler::ExportChromeTrace(cpuTraceFilename);
+        }
     }
     catch (const std::exception& e)
     {
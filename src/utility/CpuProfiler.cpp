@@ -0,0 +1,204 @@
+#include "CpuProfiler.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+namespace
+{
+    // fields are atomic, so exporter may read an event while its slot is overwritten without a data race.
+    // Torn events are detected through the write index and dropped
+    struct ZoneEvent
+    {
+        std::atomic<const char*> name;
+        std::atomic<std::uint64_t> startNs;
+        std::atomic<std::uint64_t> endNs;
+    };
+
+    // written by the owning thread only, exporter may read it concurrently
+    struct ThreadBuffer
+    {
+        static constexpr std::size_t Capacity = 1 << 16;
+
+        // only changes under s_buffersMutex
+        std::uint32_t threadId = 0;
+        std::atomic<const char*> threadName = nullptr;
+        std::atomic<std::uint64_t> writeIndex = 0;
+        std::array<ZoneEvent, Capacity> events;
+    };
+
+    // Buffers outlive their threads, so zones of finished workers are still exported. Buffer of
+    // a finished thread is reused by the next new one, so thread pool rebuilds don't grow memory
+    std::mutex s_buffersMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> s_buffers;
+    std::vector<ThreadBuffer*> s_freeBuffers;
+    std::uint32_t s_nextThreadId = 0;
+
+    // hands the buffer back when its thread exits
+    struct ThreadBufferOwner
+    {
+        ThreadBuffer* buffer = nullptr;
+        const char* threadName = nullptr;
+
+        ~ThreadBufferOwner()
+        {
+            if (buffer != nullptr)
+            {
+                std::lock_guard lock(s_buffersMutex);
+                s_freeBuffers.push_back(buffer);
+            }
+        }
+    };
+
+    thread_local ThreadBufferOwner t_owner;
+
+    // allocated on the first recorded zone, threads never profiled don't get one
+    ThreadBuffer& GetThreadBuffer()
+    {
+        if (t_owner.buffer == nullptr)
+        {
+            std::lock_guard lock(s_buffersMutex);
+            if (s_freeBuffers.empty())
+            {
+                s_buffers.push_back(std::make_unique<ThreadBuffer>());
+                t_owner.buffer = s_buffers.back().get();
+            }
+            else
+            {
+                // zones of the finished thread are dropped
+                t_owner.buffer = s_freeBuffers.back();
+                s_freeBuffers.pop_back();
+                t_owner.buffer->writeIndex.store(0, std::memory_order_relaxed);
+            }
+
+            t_owner.buffer->threadId = s_nextThreadId++;
+            t_owner.buffer->threadName.store(t_owner.threadName, std::memory_order_release);
+        }
+        return *t_owner.buffer;
+    }
+
+    const std::chrono::steady_clock::time_point s_epoch = std::chrono::steady_clock::now();
+
+    void WriteJsonString(std::ofstream& file, const char* string)
+    {
+        file << '"';
+        for (const char* c = string; *c != '\0'; ++c)
+        {
+            if (*c == '"' || *c == '\\')
+                file << '\\';
+            file << *c;
+        }
+        file << '"';
+    }
+}
+
+void CpuProfiler::SetEnabled(bool enabled)
+{
+    s_enabled.store(enabled, std::memory_order_relaxed);
+    spdlog::info("CPU profiler {}", enabled ? "enabled" : "disabled");
+}
+
+void CpuProfiler::SetThreadName(const char* name)
+{
+    // applied to the buffer once it's allocated
+    t_owner.threadName = name;
+    if (t_owner.buffer != nullptr)
+    {
+        t_owner.buffer->threadName.store(name, std::memory_order_release);
+    }
+}
+
+std::uint64_t CpuProfiler::NowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_epoch).count();
+}
+
+void CpuProfiler::Record(const char* name, std::uint64_t startNs, std::uint64_t endNs)
+{
+    ThreadBuffer& buffer = GetThreadBuffer();
+
+    // Only this thread writes the index, oldest zones are overwritten when ring is full. Index already
+    // points to the slot being written, exporter that reads the slot and then sees the index drops it.
+    // The fence orders the slot writes after the store of the index, it's free on x86
+    const std::uint64_t index = buffer.writeIndex.load(std::memory_order_relaxed);
+    ZoneEvent& event = buffer.events[index % ThreadBuffer::Capacity];
+    std::atomic_thread_fence(std::memory_order_release);
+    event.name.store(name, std::memory_order_relaxed);
+    event.startNs.store(startNs, std::memory_order_relaxed);
+    event.endNs.store(endNs, std::memory_order_relaxed);
+    buffer.writeIndex.store(index + 1, std::memory_order_release);
+}
+
+bool CpuProfiler::ExportChromeTrace(const std::string& filename)
+{
+    std::ofstream file(filename, std::ios::trunc);
+    if (!file.is_open())
+    {
+        spdlog::error("Failed to open {} for CPU trace export", filename);
+        return false;
+    }
+
+    // nanosecond resolution in microsecond units
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    std::size_t exportedZones = 0;
+
+    std::lock_guard lock(s_buffersMutex);
+    for (const std::unique_ptr<ThreadBuffer>& buffer : s_buffers)
+    {
+        const char* threadName = buffer->threadName.load(std::memory_order_acquire);
+        if (threadName != nullptr)
+        {
+            file << (first ? "" : ",") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":"
+                 << buffer->threadId << ",\"args\":{\"name\":";
+            WriteJsonString(file, threadName);
+            file << "}}";
+            first = false;
+        }
+
+        // profiler may keep running while exporting, zones overwritten in the meantime are skipped
+        const std::uint64_t end = buffer->writeIndex.load(std::memory_order_acquire);
+        const std::uint64_t begin = end > ThreadBuffer::Capacity ? end - ThreadBuffer::Capacity : 0;
+        for (std::uint64_t i = begin; i < end; ++i)
+        {
+            const ZoneEvent& slot = buffer->events[i % ThreadBuffer::Capacity];
+            const char* name = slot.name.load(std::memory_order_relaxed);
+            const std::uint64_t startNs = slot.startNs.load(std::memory_order_relaxed);
+            const std::uint64_t endNs = slot.endNs.load(std::memory_order_relaxed);
+
+            // writer has reached this slot again, what was read may be a mix of two zones
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (buffer->writeIndex.load(std::memory_order_relaxed) >= i + ThreadBuffer::Capacity)
+                continue;
+
+            // trace event timestamps are in microseconds
+            file << (first ? "" : ",") << "{\"ph\":\"X\",\"name\":";
+            WriteJsonString(file, name);
+            file << ",\"pid\":1,\"tid\":" << buffer->threadId
+                 << ",\"ts\":" << static_cast<double>(startNs) / 1000.0
+                 << ",\"dur\":" << static_cast<double>(endNs - startNs) / 1000.0 << "}";
+            first = false;
+            ++exportedZones;
+        }
+    }
+
+    file << "]}\n";
+    file.close();
+
+    if (file.fail())
+    {
+        spdlog::error("Failed to write CPU trace to {}", filename);
+        return false;
+    }
+
+    spdlog::info("Exported {} CPU zones to {}", exportedZones, filename);
+    return true;
+}
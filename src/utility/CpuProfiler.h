@@ -0,0 +1,80 @@
+#ifndef CPUPROFILER_H
+#define CPUPROFILER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "utility/NonCopyable.h"
+#include "utility/NonMovable.h"
+#include "utility/Utility.h"
+
+// Scoped CPU timing zones. Every thread writes finished zones into its own ring buffer without
+// any locking, so zones can be kept in hot paths. While profiling is disabled a zone costs
+// a single relaxed atomic load and threads don't get a buffer until they record a zone. Buffers
+// of finished threads are reused by new ones, which drops their zones. Collected zones are
+// exported in Chrome trace event format, which can be opened in chrome://tracing or ui.perfetto.dev.
+class CpuProfiler
+{
+public:
+    class Zone : NonCopyable, NonMovable
+    {
+    public:
+        // name must outlive the profiler, string literals are expected
+        explicit Zone(const char* name)
+        {
+            if (IsEnabled())
+            {
+                m_name = name;
+                m_startNs = NowNs();
+            }
+        }
+
+        ~Zone()
+        {
+            if (m_name != nullptr)
+            {
+                Record(m_name, m_startNs, NowNs());
+            }
+        }
+
+    private:
+        const char* m_name = nullptr;
+        std::uint64_t m_startNs = 0;
+    };
+
+public:
+    static void SetEnabled(bool enabled);
+
+    static bool IsEnabled()
+    {
+        return s_enabled.load(std::memory_order_relaxed);
+    }
+
+    // shown instead of thread number in the trace
+    static void SetThreadName(const char* name);
+
+    // Writes zones of all threads that are still in their ring buffers, returns false on IO error.
+    // Threads may keep recording meanwhile, zones they overwrite during export are left out
+    static bool ExportChromeTrace(const std::string& filename);
+
+    // nanoseconds since the profiler was first used
+    static std::uint64_t NowNs();
+
+private:
+    static void Record(const char* name, std::uint64_t startNs, std::uint64_t endNs);
+
+private:
+    inline static std::atomic<bool> s_enabled = false;
+};
+
+#define CPU_PROFILER_CONCAT_IMPL(a, b) a##b
+#define CPU_PROFILER_CONCAT(a, b) CPU_PROFILER_CONCAT_IMPL(a, b)
+
+#ifdef DISABLE_CPU_PROFILER
+#define CPU_PROFILE_ZONE(name)
+#else
+#define CPU_PROFILE_ZONE(name) const CpuProfiler::Zone CPU_PROFILER_CONCAT(cpuProfilerZone, __LINE__)(name)
+#endif
+
+#endif //CPUPROFILER_H
@@ -0,0 +1,60 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <bit>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+#include "utility/Utility.h"
+
+// 64-bit FNV-1a. Values are fed one by one in a fixed width, so the result doesn't depend on
+// struct padding and stays the same between runs, builds and platforms
+class Hasher
+{
+public:
+    void addBytes(const void* data, std::size_t size)
+    {
+        const auto* bytes = static_cast<const std::uint8_t *>(data);
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            m_hash ^= bytes[i];
+            m_hash *= Prime;
+        }
+    }
+
+    template <typename T>
+        requires std::is_integral_v<T> || std::is_enum_v<T>
+    void add(T value)
+    {
+        auto wide = static_cast<std::uint64_t>(value);
+        for (int i = 0; i < 8; ++i)
+        {
+            const auto byte = static_cast<std::uint8_t>(wide & 0xff);
+            addBytes(&byte, 1);
+            wide >>= 8;
+        }
+    }
+
+    void add(float value)
+    {
+        add(std::bit_cast<std::uint32_t>(value));
+    }
+
+    void add(std::string_view string)
+    {
+        // length first, so that ("ab", "c") and ("a", "bc") differ
+        add(string.size());
+        addBytes(string.data(), string.size());
+    }
+
+    NODISCARD std::uint64_t get() const { return m_hash; }
+
+private:
+    static constexpr std::uint64_t OffsetBasis = 0xcbf29ce484222325ull;
+    static constexpr std::uint64_t Prime = 0x100000001b3ull;
+
+    std::uint64_t m_hash = OffsetBasis;
+};
+
+#endif //HASH_H
@@ -0,0 +1,102 @@
+#include "MappedFile.h"
+
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MAPPED_FILE_USE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& filename)
+{
+#ifdef MAPPED_FILE_USE_MMAP
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Failed to open file " + filename);
+    }
+
+    struct stat fileStat = {};
+    if (fstat(fd, &fileStat) != 0)
+    {
+        close(fd);
+        throw std::runtime_error("Failed to stat file " + filename);
+    }
+
+    m_size = static_cast<std::size_t>(fileStat.st_size);
+    if (m_size > 0)
+    {
+        void* address = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED)
+        {
+            close(fd);
+            throw std::runtime_error("Failed to map file " + filename);
+        }
+
+        m_data = static_cast<const std::byte *>(address);
+        m_mapped = true;
+    }
+
+    // mapping stays valid after the descriptor is closed
+    close(fd);
+#else
+    std::ifstream file(filename, std::ios::ate | std::ios::binary);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Failed to open file " + filename);
+    }
+
+    m_size = static_cast<std::size_t>(file.tellg());
+    m_fallbackBuffer.resize((m_size + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t));
+    file.seekg(0);
+    file.read(reinterpret_cast<char *>(m_fallbackBuffer.data()), static_cast<std::streamsize>(m_size));
+    m_data = reinterpret_cast<const std::byte *>(m_fallbackBuffer.data());
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    unmap();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        unmap();
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+        m_mapped = std::exchange(other.m_mapped, false);
+        m_fallbackBuffer = std::move(other.m_fallbackBuffer);
+    }
+    return *this;
+}
+
+std::span<const std::byte> MappedFile::getData() const
+{
+    return {m_data, m_size};
+}
+
+void MappedFile::unmap() noexcept
+{
+#ifdef MAPPED_FILE_USE_MMAP
+    if (m_mapped)
+    {
+        munmap(const_cast<std::byte *>(m_data), m_size);
+    }
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_mapped = false;
+    m_fallbackBuffer.clear();
+}
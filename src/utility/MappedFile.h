@@ -0,0 +1,41 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "utility/NonCopyable.h"
+#include "utility/Utility.h"
+
+// Read-only view of a whole file. Memory mapped where possible, so pages are loaded on first
+// access and nothing is copied, otherwise read into a buffer. Data is at least page aligned
+// when mapped and aligned for any scalar type when read
+class MappedFile : NonCopyable
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // throws std::runtime_error if the file can't be opened
+    explicit MappedFile(const std::string& filename);
+
+    NODISCARD std::span<const std::byte> getData() const;
+
+private:
+    void unmap() noexcept;
+
+private:
+    const std::byte* m_data = nullptr;
+    std::size_t m_size = 0;
+    bool m_mapped = false;
+
+    // used when mapping is not available, max_align_t keeps it aligned
+    std::vector<std::max_align_t> m_fallbackBuffer;
+};
+
+#endif //MAPPEDFILE_H
@@ -0,0 +1,111 @@
+#include "OffsetAllocator.h"
+
+#include <iterator>
+
+OffsetAllocator::OffsetAllocator(std::uint32_t capacity)
+    : m_capacity(capacity)
+{
+    reset();
+}
+
+std::optional<std::uint32_t> OffsetAllocator::allocate(std::uint32_t size)
+{
+    ASSERT(size > 0 && "Empty allocation!");
+
+    // smallest free range that fits, leaves big ranges for big allocations
+    const auto bestFit = m_freeBySize.lower_bound({size, 0});
+    if (bestFit == m_freeBySize.end())
+        return std::nullopt;
+
+    const auto [rangeSize, offset] = *bestFit;
+    eraseFreeRange(m_freeByOffset.find(offset));
+
+    if (rangeSize > size)
+    {
+        insertFreeRange(offset + size, rangeSize - size);
+    }
+
+    m_allocations.emplace(offset, size);
+    m_freeSpace -= size;
+    return offset;
+}
+
+void OffsetAllocator::free(std::uint32_t offset)
+{
+    const auto allocation = m_allocations.find(offset);
+    ASSERT(allocation != m_allocations.end() && "Freeing offset that was not allocated!");
+
+    std::uint32_t size = allocation->second;
+    m_allocations.erase(allocation);
+    m_freeSpace += size;
+
+    // merge with the free range right after
+    const auto next = m_freeByOffset.find(offset + size);
+    if (next != m_freeByOffset.end())
+    {
+        size += next->second;
+        eraseFreeRange(next);
+    }
+
+    // and with the one right before
+    const auto following = m_freeByOffset.lower_bound(offset);
+    if (following != m_freeByOffset.begin())
+    {
+        const auto previous = std::prev(following);
+        if (previous->first + previous->second == offset)
+        {
+            offset = previous->first;
+            size += previous->second;
+            eraseFreeRange(previous);
+        }
+    }
+
+    insertFreeRange(offset, size);
+}
+
+void OffsetAllocator::reset()
+{
+    m_freeByOffset.clear();
+    m_freeBySize.clear();
+    m_allocations.clear();
+    m_freeSpace = m_capacity;
+
+    if (m_capacity > 0)
+    {
+        insertFreeRange(0, m_capacity);
+    }
+}
+
+std::uint32_t OffsetAllocator::getCapacity() const
+{
+    return m_capacity;
+}
+
+std::uint32_t OffsetAllocator::getFreeSpace() const
+{
+    return m_freeSpace;
+}
+
+std::uint32_t OffsetAllocator::getLargestFreeRange() const
+{
+    return m_freeBySize.empty() ? 0 : m_freeBySize.rbegin()->first;
+}
+
+std::uint32_t OffsetAllocator::getAllocationSize(std::uint32_t offset) const
+{
+    const auto allocation = m_allocations.find(offset);
+    ASSERT(allocation != m_allocations.end() && "Offset was not allocated!");
+    return allocation->second;
+}
+
+void OffsetAllocator::insertFreeRange(std::uint32_t offset, std::uint32_t size)
+{
+    m_freeByOffset.emplace(offset, size);
+    m_freeBySize.emplace(size, offset);
+}
+
+void OffsetAllocator::eraseFreeRange(std::map<std::uint32_t, std::uint32_t>::iterator range)
+{
+    m_freeBySize.erase({range->second, range->first});
+    m_freeByOffset.erase(range);
+}
@@ -0,0 +1,48 @@
+#ifndef OFFSETALLOCATOR_H
+#define OFFSETALLOCATOR_H
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <set>
+#include <unordered_map>
+#include <utility>
+
+#include "utility/Utility.h"
+
+// Hands out ranges of an abstract [0, capacity) space, e.g. elements of a GPU buffer. Doesn't touch
+// any memory itself. Best fit by size with free neighbours merged on release, both in O(log n)
+class OffsetAllocator
+{
+public:
+    explicit OffsetAllocator(std::uint32_t capacity = 0);
+
+    // nullopt if there is no free range big enough, even though total free space may be
+    NODISCARD std::optional<std::uint32_t> allocate(std::uint32_t size);
+    void free(std::uint32_t offset);
+
+    // forgets all allocations
+    void reset();
+
+    NODISCARD std::uint32_t getCapacity() const;
+    NODISCARD std::uint32_t getFreeSpace() const;
+    NODISCARD std::uint32_t getLargestFreeRange() const;
+    NODISCARD std::uint32_t getAllocationSize(std::uint32_t offset) const;
+
+private:
+    void insertFreeRange(std::uint32_t offset, std::uint32_t size);
+    void eraseFreeRange(std::map<std::uint32_t, std::uint32_t>::iterator range);
+
+private:
+    std::uint32_t m_capacity = 0;
+    std::uint32_t m_freeSpace = 0;
+
+    // offset -> size, for merging with neighbours
+    std::map<std::uint32_t, std::uint32_t> m_freeByOffset;
+    // (size, offset), for best fit lookup
+    std::set<std::pair<std::uint32_t, std::uint32_t>> m_freeBySize;
+    // offset -> size of live allocations
+    std::unordered_map<std::uint32_t, std::uint32_t> m_allocations;
+};
+
+#endif //OFFSETALLOCATOR_H
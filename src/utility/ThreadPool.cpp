@@ -0,0 +1,68 @@
+#include "ThreadPool.h"
+
+#include "CpuProfiler.h"
+
+ThreadPool::ThreadPool(std::uint32_t threadCount)
+{
+    m_threads.reserve(threadCount);
+    for (std::uint32_t i = 0; i < threadCount; ++i)
+    {
+        m_threads.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopRequested = true;
+    }
+    m_condition.notify_all();
+
+    for (std::thread& thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+std::future<void> ThreadPool::submit(std::function<void()> task)
+{
+    std::packaged_task<void()> packagedTask(std::move(task));
+    std::future<void> future = packagedTask.get_future();
+    {
+        std::lock_guard lock(m_mutex);
+        m_tasks.push(std::move(packagedTask));
+    }
+    m_condition.notify_one();
+
+    return future;
+}
+
+std::uint32_t ThreadPool::getThreadCount() const
+{
+    return static_cast<std::uint32_t>(m_threads.size());
+}
+
+void ThreadPool::workerLoop()
+{
+    CpuProfiler::SetThreadName("ThreadPool worker");
+
+    while (true)
+    {
+        std::packaged_task<void()> task;
+        {
+            std::unique_lock lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_stopRequested || !m_tasks.empty(); });
+
+            // remaining tasks are still executed so nobody waits on a future forever
+            if (m_stopRequested && m_tasks.empty())
+                return;
+
+            task = std::move(m_tasks.front());
+            m_tasks.pop();
+        }
+
+        // exceptions are stored in the future
+        task();
+    }
+}
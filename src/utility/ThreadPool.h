@@ -0,0 +1,40 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "utility/NonCopyable.h"
+#include "utility/NonMovable.h"
+#include "utility/Utility.h"
+
+// Fixed set of worker threads executing tasks in submission order
+class ThreadPool : NonCopyable, NonMovable
+{
+public:
+    explicit ThreadPool(std::uint32_t threadCount);
+    ~ThreadPool();
+
+    std::future<void> submit(std::function<void()> task);
+
+    NODISCARD std::uint32_t getThreadCount() const;
+
+private:
+    void workerLoop();
+
+private:
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::queue<std::packaged_task<void()>> m_tasks;
+    bool m_stopRequested = false;
+};
+
+#endif //THREADPOOL_H
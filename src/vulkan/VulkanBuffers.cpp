@@ -1,47 +1,60 @@
 #include "VulkanBuffers.h"
 
+#include <spdlog/spdlog.h>
 #include <vk_mem_alloc.h>
 #include <vulkan/vulkan_enums.hpp>
 
 #include "VulkanContext.h"
 
-// --------------- VulkanVertex ---------------
-
-vk::VertexInputBindingDescription VulkanVertex::GetBindingDescription()
-{
-    return {
-        .binding = 0,
-        .stride = sizeof(VulkanVertex),
-        .inputRate = vk::VertexInputRate::eVertex
-    };
-}
-
-std::array<vk::VertexInputAttributeDescription, 2> VulkanVertex::GetAttributeDescriptions()
+namespace
 {
-    std::array<vk::VertexInputAttributeDescription, 2> descriptions;
-
-    descriptions[0] = {
-        .location = 0,
-        .binding = 0,
-        .format = vk::Format::eR32G32Sfloat, // it's ok that color format is used here
-        .offset = offsetof(VulkanVertex, position)
-    };
+    // where graphics reads a buffer with given usage, uploads are made visible to exactly that
+    std::pair<vk::PipelineStageFlags2, vk::AccessFlags2> GetReadScope(vk::BufferUsageFlags usageFlags)
+    {
+        vk::PipelineStageFlags2 stages;
+        vk::AccessFlags2 access;
 
-    descriptions[1] = {
-        .location = 1,
-        .binding = 0,
-        .format = vk::Format::eR32G32B32Sfloat,
-        .offset = offsetof(VulkanVertex, color)
-    };
+        if (usageFlags & vk::BufferUsageFlagBits::eVertexBuffer)
+        {
+            stages |= vk::PipelineStageFlagBits2::eVertexAttributeInput;
+            access |= vk::AccessFlagBits2::eVertexAttributeRead;
+        }
+        if (usageFlags & vk::BufferUsageFlagBits::eIndexBuffer)
+        {
+            stages |= vk::PipelineStageFlagBits2::eIndexInput;
+            access |= vk::AccessFlagBits2::eIndexRead;
+        }
+        if (!stages)
+        {
+            stages = vk::PipelineStageFlagBits2::eAllCommands;
+            access = vk::AccessFlagBits2::eMemoryRead;
+        }
 
-    return descriptions;
+        return {stages, access};
+    }
 }
 
 // ------------ VulkanBuffer ------------
 
 VulkanBuffer::VulkanBuffer(const void *data, std::size_t size, vk::BufferUsageFlags usageFlags)
 {
-    create(data, size, usageFlags);
+    create(size, usageFlags);
+    if (writeDirect(data, size))
+        return;
+
+    const auto [dstStage, dstAccess] = GetReadScope(usageFlags);
+    m_uploadToken = VulkanContext::GetUploader().uploadBuffer(m_buffer, 0, data, size, dstStage, dstAccess);
+}
+
+VulkanBuffer::VulkanBuffer(VulkanUploader::Batch& batch, const void *data, std::size_t size,
+                           vk::BufferUsageFlags usageFlags)
+{
+    create(size, usageFlags);
+    if (writeDirect(data, size))
+        return;
+
+    const auto [dstStage, dstAccess] = GetReadScope(usageFlags);
+    m_uploadToken = batch.addBuffer(m_buffer, 0, data, size, dstStage, dstAccess);
 }
 
 VulkanBuffer::~VulkanBuffer() noexcept
@@ -54,37 +67,14 @@ vk::Buffer VulkanBuffer::getHandle() const
     return m_buffer;
 }
 
-std::pair<vk::Buffer, VmaAllocation> VulkanBuffer::createStagingBuffer(vk::DeviceSize bufferSize, VmaAllocationInfo* allocationInfo)
+const VulkanUploader::Token& VulkanBuffer::getUploadToken() const
 {
-    vk::BufferCreateInfo bufferCreateInfo = {
-        .sType = vk::StructureType::eBufferCreateInfo,
-        .pNext = nullptr,
-        .flags = vk::BufferCreateFlags(),
-        .size = bufferSize,
-        .usage = vk::BufferUsageFlagBits::eTransferSrc,
-        .sharingMode = vk::SharingMode::eExclusive,
-        .queueFamilyIndexCount = 0, // this is blank because buffer is not shared between queues
-        .pQueueFamilyIndices = nullptr
-    };
-
-    VmaAllocationCreateInfo allocationCreateInfo = {};
-    allocationCreateInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
-                                 VMA_ALLOCATION_CREATE_MAPPED_BIT;
-    allocationCreateInfo.usage = VMA_MEMORY_USAGE_AUTO;
-
-    vk::Buffer buffer;
-    VmaAllocation allocation;
-    VkResult result = vmaCreateBuffer(VulkanContext::GetDevice().getVmaAllocator(),
-                                      (VkBufferCreateInfo *) &bufferCreateInfo,
-                                      &allocationCreateInfo,
-                                      (VkBuffer *) &buffer,
-                                      &allocation,
-                                      allocationInfo);
-
-    if (result != VK_SUCCESS)
-        throw std::runtime_error("Failed to create staging vertex buffer!");
+    return m_uploadToken;
+}
 
-    return std::make_pair(buffer, allocation);
+VulkanBuffer::UploadPath VulkanBuffer::getUploadPath() const
+{
+    return m_uploadPath;
 }
 
 std::pair<vk::Buffer, VmaAllocation> VulkanBuffer::createDeviceLocalBuffer(
@@ -100,7 +90,9 @@ std::pair<vk::Buffer, VmaAllocation> VulkanBuffer::createDeviceLocalBuffer(
     };
 
     VmaAllocationCreateInfo allocationCreateInfo = {};
-    allocationCreateInfo.usage = VMA_MEMORY_USAGE_AUTO;
+    // same policy as the geometry arena: device local memory, host visible one only if it's device local too
+    allocationCreateInfo.flags = VulkanUploader::GetDirectWriteAllocationFlags();
+    allocationCreateInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
 
     VmaAllocation allocation;
     vk::Buffer buffer;
@@ -117,70 +109,45 @@ std::pair<vk::Buffer, VmaAllocation> VulkanBuffer::createDeviceLocalBuffer(
     return std::make_pair(buffer, allocation);
 }
 
-void VulkanBuffer::copyBuffer(vk::Buffer src, vk::Buffer dst, vk::DeviceSize size)
+void VulkanBuffer::create(std::size_t size, vk::BufferUsageFlags usageFlags)
 {
-    vk::CommandBufferAllocateInfo allocateInfo = {
-        .sType = vk::StructureType::eCommandBufferAllocateInfo,
-        .commandPool = VulkanContext::GetDevice().getCommandPool(),
-        .level = vk::CommandBufferLevel::ePrimary,
-        .commandBufferCount = 1
-    };
-
-    vk::CommandBuffer commandBuffer = VulkanContext::GetLogicalDevice().allocateCommandBuffers(allocateInfo).front();
-
-    vk::CommandBufferBeginInfo beginInfo = {
-        .sType = vk::StructureType::eCommandBufferBeginInfo,
-        .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
-    };
-
-    commandBuffer.begin(beginInfo);
-
-    const vk::BufferCopy copyRegion = {
-        .srcOffset = 0,
-        .dstOffset = 0,
-        .size = size
-    };
-
-    commandBuffer.copyBuffer(src, dst, copyRegion);
-
-    commandBuffer.end();
-
-    vk::SubmitInfo submitInfo = {
-        .sType = vk::StructureType::eSubmitInfo,
-        .commandBufferCount = 1,
-        .pCommandBuffers = &commandBuffer,
-    };
-
-    vk::FenceCreateInfo fenceCreateInfo = {
-        .sType = vk::StructureType::eFenceCreateInfo
-    };
-
-    vk::Fence transferCompletedFence = VulkanContext::GetLogicalDevice().createFence(fenceCreateInfo);
-    VulkanContext::GetDevice().getQueues().graphicsQueue.submit({submitInfo}, {transferCompletedFence});
-
-    constexpr std::uint64_t timeout = std::numeric_limits<std::uint64_t>::max();
-    vk::Result result = VulkanContext::GetLogicalDevice().waitForFences({transferCompletedFence}, VK_TRUE, timeout);
-    ASSERT(result == vk::Result::eSuccess);
-
-    VulkanContext::GetLogicalDevice().destroyFence(transferCompletedFence);
+    std::tie(m_buffer, m_allocation) = createDeviceLocalBuffer(size, usageFlags, nullptr);
 }
 
-void VulkanBuffer::create(const void *data, std::size_t size, vk::BufferUsageFlags usageFlags)
+bool VulkanBuffer::writeDirect(const void *data, std::size_t size)
 {
-    VmaAllocationInfo stagingAllocInfo;
-    auto [stagingBuffer, stagingAllocation] = createStagingBuffer(size, &stagingAllocInfo);
-    std::memcpy(stagingAllocInfo.pMappedData, data, size);
+    // buffer is new, so no submission uses it yet and the next one sees the data. Token stays empty
+    if (!VulkanContext::GetUploader().writeDirect(m_allocation, 0, data, size))
+        return false;
 
-    std::tie(m_buffer, m_allocation) = createDeviceLocalBuffer(size, usageFlags, nullptr);
-    copyBuffer(stagingBuffer, m_buffer, size);
-
-    vmaDestroyBuffer(VulkanContext::GetDevice().getVmaAllocator(), stagingBuffer, stagingAllocation);
+    m_uploadPath = UploadPath::Direct;
+    return true;
 }
 
 void VulkanBuffer::cleanup() noexcept
 {
-    VulkanContext::GetLogicalDevice().waitIdle();
-    vmaDestroyBuffer(VulkanContext::GetDevice().getVmaAllocator(), m_buffer, m_allocation);
+    // Every submission using the buffer is on graphics timeline by now: uploads either went to
+    // graphics queue or were acquired there. An acquire that is still pending is submitted here.
+    // It only fails when the device is lost, buffer is released anyway then
+    try
+    {
+        m_uploadToken.wait();
+    }
+    catch (const vk::SystemError& e)
+    {
+        spdlog::error("Failed to wait for buffer upload: {}", e.what());
+    }
+
+    // may still be read by frames in flight, so it is released once GPU has finished everything
+    // submitted so far instead of draining the queue
+    VulkanDevice& device = VulkanContext::GetDevice();
+    const std::uint64_t lastUse = device.getGraphicsTimeline().getLastSignaledValue();
+    device.getDeletionQueue().push(lastUse, [buffer = m_buffer, allocation = m_allocation]() {
+        vmaDestroyBuffer(VulkanContext::GetDevice().getVmaAllocator(), buffer, allocation);
+    });
+
+    m_buffer = VK_NULL_HANDLE;
+    m_allocation = VK_NULL_HANDLE;
 }
 
 std::uint32_t VulkanBuffer::findMemoryType(std::uint32_t typeFilter, vk::MemoryPropertyFlags properties)
@@ -196,20 +163,3 @@ std::uint32_t VulkanBuffer::findMemoryType(std::uint32_t typeFilter, vk::MemoryP
 
     throw std::runtime_error("Failed to find suitable memory type!");
 }
-
-
-// ------------ VulkanVertexBuffer ------------
-
-VulkanVertexBuffer::VulkanVertexBuffer(const std::vector<VulkanVertex>& vertices)
-    : VulkanBuffer(vertices.data(), vertices.size() * sizeof(VulkanVertex), vk::BufferUsageFlagBits::eVertexBuffer)
-{
-    m_vertexCount = vertices.size();
-}
-
-// ------------ VulkanIndexBuffer ------------
-
-VulkanIndexBuffer::VulkanIndexBuffer(const std::vector<uint16_t> indices)
-    : VulkanBuffer(indices.data(), indices.size() * sizeof(VulkanIndexBuffer::IndexType), vk::BufferUsageFlagBits::eIndexBuffer)
-{
-    m_indexCount = indices.size();
-}
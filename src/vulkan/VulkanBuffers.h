@@ -9,71 +9,57 @@
 #include <utility/Utility.h>
 #include <vulkan/vulkan_enums.hpp>
 
+#include "VulkanUploader.h"
+
 
 struct VulkanVertex
 {
 public:
+    // layout of vertex inputs is reflected from shaders, members go in location order without padding
     glm::vec2 position;
     glm::vec3 color;
-
-    static vk::VertexInputBindingDescription GetBindingDescription();
-    static std::array<vk::VertexInputAttributeDescription, 2> GetAttributeDescriptions();
 };
 
 
 class VulkanBuffer
 {
+public:
+    enum class UploadPath
+    {
+        Staged,  // copied from the staging ring by GPU
+        Direct   // written by host into device local memory that is host visible
+    };
+
 public:
     VulkanBuffer(const void *data, std::size_t size, vk::BufferUsageFlags usageFlags);
+    // upload is only recorded into the batch, data must stay alive until the batch is submitted
+    VulkanBuffer(VulkanUploader::Batch& batch, const void *data, std::size_t size, vk::BufferUsageFlags usageFlags);
     ~VulkanBuffer() noexcept;
 
     NODISCARD vk::Buffer getHandle() const;
 
+    // contents are uploaded asynchronously, buffer must not be drawn from before the token is ready
+    NODISCARD const VulkanUploader::Token& getUploadToken() const;
+    NODISCARD UploadPath getUploadPath() const;
+
 private:
-    void create(const void *data, std::size_t size, vk::BufferUsageFlags usageFlags);
+    void create(std::size_t size, vk::BufferUsageFlags usageFlags);
+    // writes contents directly if the buffer is host visible, returns false if they have to be staged
+    bool writeDirect(const void *data, std::size_t size);
     void cleanup() noexcept;
 
-    // TODO: use single heap buffer for all staging data
-    std::pair<vk::Buffer, VmaAllocation> createStagingBuffer(
-        vk::DeviceSize bufferSize,
-        VmaAllocationInfo* allocationInfo);
-
     std::pair<vk::Buffer, VmaAllocation> createDeviceLocalBuffer(
         vk::DeviceSize bufferSize,
         vk::BufferUsageFlags usageFlags,
         VmaAllocationInfo* allocationInfo);
 
-    void copyBuffer(vk::Buffer src, vk::Buffer dst, vk::DeviceSize size);
-
     std::uint32_t findMemoryType(std::uint32_t typeFilter, vk::MemoryPropertyFlags properties);
 
 private:
     vk::Buffer m_buffer;
     VmaAllocation  m_allocation;
-};
-
-
-class VulkanVertexBuffer : public VulkanBuffer
-{
-public:
-    VulkanVertexBuffer(const std::vector<VulkanVertex>& vertices);
-    NODISCARD std::size_t getVertexCount() const { return m_vertexCount; }
-
-private:
-    std::size_t m_vertexCount;
-};
-
-class VulkanIndexBuffer : public VulkanBuffer
-{
-public:
-    using IndexType = uint16_t;
-
-    VulkanIndexBuffer(const std::vector<IndexType> indices);
-    NODISCARD std::size_t getIndexCount() const { return m_indexCount; }
-    NODISCARD vk::IndexType getIndexType() const { return vk::IndexType::eUint16; }
-
-private:
-    std::size_t m_indexCount;
+    VulkanUploader::Token m_uploadToken;
+    UploadPath m_uploadPath = UploadPath::Staged;
 };
 
 #endif //VULKANVERTEXBUFFER_H
@@ -0,0 +1,63 @@
+#ifndef VULKANCONFIG_H
+#define VULKANCONFIG_H
+
+#include <cstdint>
+#include <string>
+
+enum class VulkanPresentPolicy
+{
+    LowestLatency,  // mailbox, or fifo if mailbox is unavailable
+    AllowTearing,   // mailbox, or immediate (may tear) if mailbox is unavailable
+    PowerSaving,    // fifo, strict vsync
+    FifoRelaxed     // vsync, but late frames are presented immediately (may tear)
+};
+
+struct VulkanConfig
+{
+    static constexpr std::uint32_t MinFramesInFlight = 1;
+    static constexpr std::uint32_t MaxFramesInFlight = 4;
+
+    // how many frames CPU is allowed to record ahead of GPU
+    std::uint32_t framesInFlight = 2;
+
+    VulkanPresentPolicy presentPolicy = VulkanPresentPolicy::LowestLatency;
+
+    // exact swapchain image count, clamped to surface limits. Zero means minImageCount + 1
+    std::uint32_t swapchainImageCount = 0;
+
+    // worker threads recording secondary command buffers, zero records everything on the calling thread
+    std::uint32_t recordingThreads = 0;
+
+    // record command buffer once per target image and resubmit it until invalidated,
+    // for scenes that don't change between frames
+    bool cacheCommandBuffers = false;
+
+    // pipeline cache is loaded from and saved to this file, empty keeps it in memory only
+    std::string pipelineCacheFilename = "pipeline_cache.bin";
+
+    // packed SPIR-V, ignored when the archive is embedded into the executable
+    std::string shaderArchiveFilename = "shaders/shaders.pack";
+
+    // threads compiling pipelines in background, zero compiles them on the requesting thread
+    std::uint32_t pipelineCompileThreads = 2;
+
+    // persistently mapped buffer all uploads are staged through, bigger uploads are split into chunks
+    std::uint64_t stagingRingSize = 32ull << 20;
+
+    // transient per-frame data (uniforms, streamed vertices) of one frame in flight
+    std::uint64_t frameAllocatorSize = 4ull << 20;
+
+    // device local buffers are written by host without staging where that memory is host visible (UMA, resizable BAR)
+    bool directBufferWrites = true;
+
+    // capacity of the buffers all meshes are sub-allocated from, in vertices and indices
+    std::uint32_t geometryArenaVertices = 1u << 20;
+    std::uint32_t geometryArenaIndices = 4u << 20;
+
+    // render into offscreen images without window, surface and present queue
+    bool headless = false;
+    std::uint32_t offscreenWidth = 1280;
+    std::uint32_t offscreenHeight = 720;
+};
+
+#endif //VULKANCONFIG_H
@@ -1,5 +1,7 @@
 #include "VulkanContext.h"
 
+#include <string_view>
+
 #include <vulkan/vulkan.hpp>
 #include <vk_mem_alloc.h>
 
@@ -11,9 +13,10 @@
 
 std::unique_ptr<VulkanContext> VulkanContext::s_instance;
 
-void VulkanContext::Initialize()
+void VulkanContext::Initialize(const VulkanConfig& config)
 {
     s_instance = std::unique_ptr<VulkanContext>(new VulkanContext());
+    s_instance->m_config = config;
     s_instance->init();
 }
 
@@ -23,6 +26,11 @@ VulkanContext& VulkanContext::Get()
     return *s_instance;
 }
 
+const VulkanConfig& VulkanContext::GetConfig()
+{
+    return Get().m_config;
+}
+
 vk::Device VulkanContext::GetLogicalDevice()
 {
     return GetDevice().getLogicalDevice();
@@ -48,19 +56,147 @@ VulkanSwapchain& VulkanContext::GetSwapchain()
     return Get().m_swapchain;
 }
 
+VulkanOffscreenTarget& VulkanContext::GetOffscreenTarget()
+{
+    return Get().m_offscreenTarget;
+}
+
 VulkanDevice& VulkanContext::GetDevice()
 {
     return Get().m_device;
 }
 
+const vk::DispatchLoaderDynamic& VulkanContext::GetDispatch()
+{
+    return GetDevice().getDispatch();
+}
+
+VulkanGpuProfiler& VulkanContext::GetGpuProfiler()
+{
+    return Get().m_gpuProfiler;
+}
+
+VulkanFrameAllocator& VulkanContext::GetFrameAllocator()
+{
+    return Get().m_frameAllocator;
+}
+
+VulkanPipelineCache& VulkanContext::GetPipelineCache()
+{
+    return Get().m_pipelineCache;
+}
+
+VulkanPipelineCompiler& VulkanContext::GetPipelineCompiler()
+{
+    return Get().m_pipelineCompiler;
+}
+
+VulkanPipelineRegistry& VulkanContext::GetPipelineRegistry()
+{
+    return Get().m_pipelineRegistry;
+}
+
+VulkanShaderArchive& VulkanContext::GetShaderArchive()
+{
+    return Get().m_shaderArchive;
+}
+
+VulkanStagingRing& VulkanContext::GetStagingRing()
+{
+    return Get().m_stagingRing;
+}
+
+VulkanUploader& VulkanContext::GetUploader()
+{
+    return Get().m_uploader;
+}
+
+VulkanGeometryArena& VulkanContext::GetGeometryArena()
+{
+    return Get().m_geometryArena;
+}
+
+VulkanRenderTarget& VulkanContext::GetRenderTarget()
+{
+    if (IsHeadless())
+        return Get().m_offscreenTarget;
+
+    return Get().m_swapchain;
+}
+
+bool VulkanContext::IsHeadless()
+{
+    return Get().m_config.headless;
+}
+
+bool VulkanContext::IsSurfaceMaintenanceEnabled()
+{
+    return Get().m_surfaceMaintenanceEnabled;
+}
+
 void VulkanContext::DrawFrame()
 {
     Get().m_renderPipeline.drawFrame();
 }
 
+void VulkanContext::BenchmarkDispatch(std::uint32_t drawCount)
+{
+    Get().m_renderPipeline.benchmarkDispatch(drawCount);
+}
+
+void VulkanContext::WaitIdle()
+{
+    GetDevice().getTransferTimeline().waitIdle();
+    GetDevice().getGraphicsTimeline().waitIdle();
+}
+
+void VulkanContext::SetPresentPolicy(VulkanPresentPolicy policy, std::uint32_t imageCount)
+{
+    Get().m_config.presentPolicy = policy;
+    Get().m_config.swapchainImageCount = imageCount;
+    Get().m_renderPipeline.requestSwapchainRecreation();
+}
+
+VulkanPresentLatencyTracker::Stats VulkanContext::GetPresentLatencyStats()
+{
+    return Get().m_swapchain.getPresentLatencyTracker().getStats();
+}
+
+std::vector<VulkanGpuProfiler::ScopeTiming> VulkanContext::GetGpuTimings()
+{
+    return Get().m_gpuProfiler.getLastFrameTimings();
+}
+
+void VulkanContext::SetFramesInFlight(std::uint32_t framesInFlight)
+{
+    Get().m_renderPipeline.setFramesInFlight(framesInFlight);
+    Get().m_config.framesInFlight = framesInFlight;
+}
+
 std::vector<const char *> VulkanContext::getRequiredInstanceExtensions()
 {
-    std::vector extensions = GLFWContext::Get().getRequiredVulkanInstanceExtensions();
+    std::vector<const char *> extensions;
+    if (!m_config.headless)
+    {
+        extensions = GLFWContext::Get().getRequiredVulkanInstanceExtensions();
+
+        // optional, needed for present fences of VK_EXT_swapchain_maintenance1
+        bool surfaceMaintenanceSupported = false;
+        bool surfaceCapabilities2Supported = false;
+        for (const vk::ExtensionProperties& extensionProperties : vk::enumerateInstanceExtensionProperties())
+        {
+            const std::string_view name = extensionProperties.extensionName;
+            surfaceMaintenanceSupported |= name == VK_EXT_SURFACE_MAINTENANCE_1_EXTENSION_NAME;
+            surfaceCapabilities2Supported |= name == VK_KHR_GET_SURFACE_CAPABILITIES_2_EXTENSION_NAME;
+        }
+
+        m_surfaceMaintenanceEnabled = surfaceMaintenanceSupported && surfaceCapabilities2Supported;
+        if (m_surfaceMaintenanceEnabled)
+        {
+            extensions.push_back(VK_KHR_GET_SURFACE_CAPABILITIES_2_EXTENSION_NAME);
+            extensions.push_back(VK_EXT_SURFACE_MAINTENANCE_1_EXTENSION_NAME);
+        }
+    }
     VulkanDebugUtils::AppendRequiredInstanceExtensions(extensions);
 
     return extensions;
@@ -120,10 +256,33 @@ void VulkanContext::init()
     createInstance();
     VulkanDebugUtils::SetupDebugMessenger(m_instance);
     LogSupportedInstanceExtensions();
-    GLFWContext::Get().createVulkanWindowSurface(m_instance, m_surface);
+    if (!m_config.headless)
+    {
+        GLFWContext::Get().createVulkanWindowSurface(m_instance, m_surface);
+    }
+
     m_device.init(m_instance.enumeratePhysicalDevices());
-    m_swapchain.init();
-    m_renderPipeline.init();
+    m_gpuProfiler.init(m_config.framesInFlight);
+    m_frameAllocator.init(m_config.frameAllocatorSize, m_config.framesInFlight);
+    m_pipelineCache.init(m_config.pipelineCacheFilename);
+    m_pipelineCompiler.init(m_config.pipelineCompileThreads);
+    m_shaderArchive.init(m_config.shaderArchiveFilename);
+    m_stagingRing.init(m_config.stagingRingSize);
+    m_uploader.init();
+    m_geometryArena.init(m_config.geometryArenaVertices, m_config.geometryArenaIndices);
+
+    if (m_config.headless)
+    {
+        // one image per frame in flight, so frames never wait for each other's target
+        const vk::Extent2D extent = {m_config.offscreenWidth, m_config.offscreenHeight};
+        m_offscreenTarget.init(extent, vk::Format::eR8G8B8A8Srgb, m_config.framesInFlight);
+    }
+    else
+    {
+        m_swapchain.init();
+    }
+
+    m_renderPipeline.init(m_config.framesInFlight);
 }
 
 VulkanContext::~VulkanContext() noexcept
@@ -135,7 +294,24 @@ void VulkanContext::cleanup() noexcept
 {
     VulkanDebugUtils::Cleanup();
     m_renderPipeline.destroy();
-    m_swapchain.destroy();
+    if (m_config.headless)
+    {
+        m_offscreenTarget.destroy();
+    }
+    else
+    {
+        m_swapchain.destroy();
+    }
+    // worker caches are merged before the main one is saved
+    m_pipelineCompiler.destroy();
+    m_pipelineRegistry.destroy();
+    m_shaderArchive.destroy();
+    m_pipelineCache.destroy();
+    m_geometryArena.destroy();
+    m_uploader.destroy();
+    m_stagingRing.destroy();
+    m_frameAllocator.destroy();
+    m_gpuProfiler.destroy();
     m_device.destroy();
     m_instance.destroySurfaceKHR(m_surface);
     m_instance.destroy();
@@ -5,9 +5,20 @@
 
 #include <memory>
 
+#include "VulkanConfig.h"
 #include "VulkanDevice.h"
+#include "VulkanFrameAllocator.h"
+#include "VulkanGeometryArena.h"
+#include "VulkanGpuProfiler.h"
+#include "VulkanOffscreenTarget.h"
+#include "VulkanPipelineCache.h"
+#include "VulkanPipelineCompiler.h"
+#include "VulkanPipelineRegistry.h"
 #include "VulkanRenderPipeline.h"
+#include "VulkanShaderArchive.h"
+#include "VulkanStagingRing.h"
 #include "VulkanSwapchain.h"
+#include "VulkanUploader.h"
 #include "utility/NonCopyable.h"
 #include "utility/NonMovable.h"
 #include "utility/Utility.h"
@@ -18,19 +29,52 @@ public:
 
     ~VulkanContext() noexcept;
 
-    static void Initialize();
+    static void Initialize(const VulkanConfig& config = {});
     static  VulkanContext& Get();
 
+    NODISCARD static const VulkanConfig& GetConfig();
+
     NODISCARD static vk::Device GetLogicalDevice();
     NODISCARD static vk::PhysicalDevice GetPhysicalDevice();
     NODISCARD static vk::Instance GetVulkanInstance();
     NODISCARD static vk::SurfaceKHR GetSurface();
 
     NODISCARD static VulkanSwapchain& GetSwapchain();
+    NODISCARD static VulkanOffscreenTarget& GetOffscreenTarget();
     NODISCARD static VulkanDevice& GetDevice();
+    NODISCARD static const vk::DispatchLoaderDynamic& GetDispatch();
+    NODISCARD static VulkanGpuProfiler& GetGpuProfiler();
+    NODISCARD static VulkanFrameAllocator& GetFrameAllocator();
+    NODISCARD static VulkanPipelineCache& GetPipelineCache();
+    NODISCARD static VulkanPipelineCompiler& GetPipelineCompiler();
+    NODISCARD static VulkanPipelineRegistry& GetPipelineRegistry();
+    NODISCARD static VulkanShaderArchive& GetShaderArchive();
+    NODISCARD static VulkanStagingRing& GetStagingRing();
+    NODISCARD static VulkanUploader& GetUploader();
+    NODISCARD static VulkanGeometryArena& GetGeometryArena();
+
+    // swapchain, or offscreen images in headless mode
+    NODISCARD static VulkanRenderTarget& GetRenderTarget();
+    NODISCARD static bool IsHeadless();
+    // VK_EXT_surface_maintenance1 is enabled on the instance, swapchain maintenance may be enabled on the device
+    NODISCARD static bool IsSurfaceMaintenanceEnabled();
 
     static void DrawFrame();
 
+    // measures CPU cost of recording draws through loader trampolines and through device dispatch table
+    static void BenchmarkDispatch(std::uint32_t drawCount);
+
+    // blocks until GPU has finished all submitted work
+    static void WaitIdle();
+    static void SetFramesInFlight(std::uint32_t framesInFlight);
+
+    // applied with swapchain recreation on the next frame, imageCount of zero picks default count
+    static void SetPresentPolicy(VulkanPresentPolicy policy, std::uint32_t imageCount = 0);
+    NODISCARD static VulkanPresentLatencyTracker::Stats GetPresentLatencyStats();
+
+    // GPU time of named scopes in the last frame GPU has finished
+    NODISCARD static std::vector<VulkanGpuProfiler::ScopeTiming> GetGpuTimings();
+
 private:
     VulkanContext() = default;
 
@@ -43,11 +87,24 @@ private:
     static void LogSupportedInstanceExtensions();
 
 private:
+    VulkanConfig m_config;
+
     vk::Instance m_instance = VK_NULL_HANDLE;
     vk::SurfaceKHR m_surface = VK_NULL_HANDLE;
+    bool m_surfaceMaintenanceEnabled = false;
 
     VulkanDevice m_device;
+    VulkanGpuProfiler m_gpuProfiler;
+    VulkanFrameAllocator m_frameAllocator;
+    VulkanPipelineCache m_pipelineCache;
+    VulkanPipelineCompiler m_pipelineCompiler;
+    VulkanPipelineRegistry m_pipelineRegistry;
+    VulkanShaderArchive m_shaderArchive;
+    VulkanStagingRing m_stagingRing;
+    VulkanUploader m_uploader;
+    VulkanGeometryArena m_geometryArena;
     VulkanSwapchain m_swapchain;
+    VulkanOffscreenTarget m_offscreenTarget;
     VulkanRenderPipeline m_renderPipeline;
 
     static std::unique_ptr<VulkanContext> s_instance;
@@ -44,6 +44,19 @@ bool VulkanDebugUtils::CheckLayerSupport(const char* requiredLayerName)
     return false;
 }
 
+bool VulkanDebugUtils::CheckInstanceExtensionSupport(const char* requiredExtensionName)
+{
+    for (const auto& extensionProperties : vk::enumerateInstanceExtensionProperties())
+    {
+        if (std::strcmp(extensionProperties.extensionName, requiredExtensionName) == 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void VulkanDebugUtils::PopulateDebugMessengerCreateInfo(vk::DebugUtilsMessengerCreateInfoEXT& createInfo)
 {
     createInfo = vk::DebugUtilsMessengerCreateInfoEXT{};
@@ -79,12 +92,37 @@ void VulkanDebugUtils::Cleanup()
 
 void VulkanDebugUtils::AppendRequiredInstanceExtensions(std::vector<const char *>& instanceExtensions)
 {
-    if constexpr (ValidationLayersEnabled())
+    if (ValidationLayersEnabled() || CheckInstanceExtensionSupport(VK_EXT_DEBUG_UTILS_EXTENSION_NAME))
     {
         instanceExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+        s_labelsEnabled = true;
     }
 }
 
+void VulkanDebugUtils::BeginLabel(vk::CommandBuffer commandBuffer, const char* name,
+                                  const vk::DispatchLoaderDynamic& dispatch)
+{
+    if (!s_labelsEnabled)
+        return;
+
+    const vk::DebugUtilsLabelEXT label = {
+        .sType = vk::StructureType::eDebugUtilsLabelEXT,
+        .pNext = nullptr,
+        .pLabelName = name,
+        .color = std::array{0.0f, 0.0f, 0.0f, 0.0f}
+    };
+
+    commandBuffer.beginDebugUtilsLabelEXT(label, dispatch);
+}
+
+void VulkanDebugUtils::EndLabel(vk::CommandBuffer commandBuffer, const vk::DispatchLoaderDynamic& dispatch)
+{
+    if (!s_labelsEnabled)
+        return;
+
+    commandBuffer.endDebugUtilsLabelEXT(dispatch);
+}
+
 void VulkanDebugUtils::AppendInstanceLayers(std::vector<const char *>& instanceLayers)
 {
     if constexpr (ValidationLayersEnabled())
@@ -17,6 +17,15 @@ public:
 
     static void Cleanup();
 
+    // labels show up in capture tools and crash dumps, so they are used in release builds too
+    static bool LabelsEnabled()
+    {
+        return s_labelsEnabled;
+    }
+
+    static void BeginLabel(vk::CommandBuffer commandBuffer, const char* name, const vk::DispatchLoaderDynamic& dispatch);
+    static void EndLabel(vk::CommandBuffer commandBuffer, const vk::DispatchLoaderDynamic& dispatch);
+
     static constexpr bool ValidationLayersEnabled()
     {
         return s_enableValidationLayers;
@@ -30,9 +39,11 @@ private:
         void* pUserData);
 
     static bool CheckLayerSupport(const char* requiredLayerName);
+    static bool CheckInstanceExtensionSupport(const char* requiredExtensionName);
 
 private:
     inline static vk::DebugUtilsMessengerEXT s_debug_messenger = VK_NULL_HANDLE;
+    inline static bool s_labelsEnabled = false;
 
     inline const static std::vector<const char *> s_validation_layers = {
         "VK_LAYER_KHRONOS_validation",
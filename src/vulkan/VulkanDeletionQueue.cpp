@@ -0,0 +1,49 @@
+#include "VulkanDeletionQueue.h"
+
+void VulkanDeletionQueue::push(std::uint64_t timelineValue, std::function<void()>&& deleter)
+{
+    std::lock_guard lock(m_mutex);
+    m_entries.push_back({timelineValue, std::move(deleter)});
+}
+
+void VulkanDeletionQueue::collect(std::uint64_t completedValue)
+{
+    std::deque<Entry> ready;
+    {
+        std::lock_guard lock(m_mutex);
+
+        // entries are pushed with non-decreasing values most of the time,
+        // so stopping at the first unreached one is enough
+        while (!m_entries.empty() && m_entries.front().timelineValue <= completedValue)
+        {
+            ready.push_back(std::move(m_entries.front()));
+            m_entries.pop_front();
+        }
+    }
+
+    // deleters may push new entries themselves, so they run without the lock
+    for (Entry& entry : ready)
+    {
+        entry.deleter();
+    }
+}
+
+void VulkanDeletionQueue::flush() noexcept
+{
+    while (true)
+    {
+        std::deque<Entry> entries;
+        {
+            std::lock_guard lock(m_mutex);
+            entries.swap(m_entries);
+        }
+
+        if (entries.empty())
+            break;
+
+        for (Entry& entry : entries)
+        {
+            entry.deleter();
+        }
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef VULKANDELETIONQUEUE_H
+#define VULKANDELETIONQUEUE_H
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+#include "utility/NonCopyable.h"
+#include "utility/NonMovable.h"
+
+// Destroys GPU objects once graphics timeline passes the value of their last use,
+// so releasing a resource never has to drain the queue with waitIdle().
+class VulkanDeletionQueue : NonCopyable, NonMovable
+{
+public:
+    VulkanDeletionQueue() = default;
+
+    void push(std::uint64_t timelineValue, std::function<void()>&& deleter);
+
+    // runs deleters whose timeline value is already reached by GPU
+    void collect(std::uint64_t completedValue);
+
+    // runs all remaining deleters, GPU must be idle
+    void flush() noexcept;
+
+private:
+    struct Entry
+    {
+        std::uint64_t timelineValue;
+        std::function<void()> deleter;
+    };
+
+    std::mutex m_mutex;
+    std::deque<Entry> m_entries;
+};
+
+#endif //VULKANDELETIONQUEUE_H
@@ -16,13 +16,26 @@ void VulkanDevice::init(const std::vector<vk::PhysicalDevice>& availableDevices)
     createLogicalDevice(m_physicalDevice);
     createVmaAllocator();
     createCommandPool();
+    m_graphicsTimeline.init(m_logicalDevice, m_dispatch);
+    if (hasDedicatedTransferQueue())
+    {
+        m_transferTimeline.init(m_logicalDevice, m_dispatch);
+    }
 }
 
 void VulkanDevice::destroy() noexcept
 {
-    m_logicalDevice.destroyCommandPool(m_commandPool);
+    m_logicalDevice.waitIdle(m_dispatch);
+    m_deletionQueue.flush();
+
+    if (hasDedicatedTransferQueue())
+    {
+        m_transferTimeline.destroy();
+    }
+    m_graphicsTimeline.destroy();
+    m_logicalDevice.destroyCommandPool(m_commandPool, nullptr, m_dispatch);
     vmaDestroyAllocator(m_vmaAllocator);
-    m_logicalDevice.destroy();
+    m_logicalDevice.destroy(nullptr, m_dispatch);
 }
 
 vk::Device VulkanDevice::getLogicalDevice() const
@@ -45,12 +58,57 @@ const VulkanDevice::DeviceQueues& VulkanDevice::getQueues() const
     return m_queues;
 }
 
+const VulkanQueueFamilyIndices& VulkanDevice::getQueueFamilyIndices() const
+{
+    return m_queueFamilyIndices;
+}
+
 VmaAllocator VulkanDevice::getVmaAllocator() const
 {
     ASSERT(m_vmaAllocator != VK_NULL_HANDLE && "Vulkan memory allocator is not yet initialized!");
     return m_vmaAllocator;
 }
 
+const vk::DispatchLoaderDynamic& VulkanDevice::getDispatch() const
+{
+    return m_dispatch;
+}
+
+VulkanTimeline& VulkanDevice::getGraphicsTimeline()
+{
+    return m_graphicsTimeline;
+}
+
+VulkanTimeline& VulkanDevice::getTransferTimeline()
+{
+    return hasDedicatedTransferQueue() ? m_transferTimeline : m_graphicsTimeline;
+}
+
+bool VulkanDevice::hasDedicatedTransferQueue() const
+{
+    return m_queueFamilyIndices.transferFamily.has_value();
+}
+
+VulkanDeletionQueue& VulkanDevice::getDeletionQueue()
+{
+    return m_deletionQueue;
+}
+
+bool VulkanDevice::isPresentWaitEnabled() const
+{
+    return m_presentWaitEnabled;
+}
+
+bool VulkanDevice::isSwapchainMaintenanceEnabled() const
+{
+    return m_swapchainMaintenanceEnabled;
+}
+
+bool VulkanDevice::isPipelineCacheControlEnabled() const
+{
+    return m_pipelineCacheControlEnabled;
+}
+
 bool VulkanDevice::isDescreteGPU(const vk::PhysicalDevice device)
 {
     const auto deviceProperties = device.getProperties();
@@ -80,9 +138,21 @@ void VulkanDevice::logPhysicalDeviceInfo(vk::PhysicalDevice device)
         VK_VERSION_PATCH(props.apiVersion));
 }
 
+std::vector<const char *> VulkanDevice::getRequiredExtensions() const
+{
+    std::vector<const char *> extensions = m_deviceExtensions;
+    if (!VulkanContext::GetConfig().headless)
+    {
+        extensions.insert(extensions.end(), m_presentationExtensions.begin(), m_presentationExtensions.end());
+    }
+
+    return extensions;
+}
+
 bool VulkanDevice::checkDeviceExtensionsSupport(const vk::PhysicalDevice device)
 {
-    std::set<std::string> requiredExtensions(m_deviceExtensions.begin(), m_deviceExtensions.end());
+    const std::vector<const char *> extensions = getRequiredExtensions();
+    std::set<std::string> requiredExtensions(extensions.begin(), extensions.end());
 
     for (const auto deviceExtensionProperties : device.enumerateDeviceExtensionProperties())
     {
@@ -92,13 +162,100 @@ bool VulkanDevice::checkDeviceExtensionsSupport(const vk::PhysicalDevice device)
     return requiredExtensions.empty();
 }
 
+bool VulkanDevice::checkDeviceFeaturesSupport(const vk::PhysicalDevice device)
+{
+    vk::PhysicalDeviceVulkan13Features vulkan13Features;
+    vk::PhysicalDeviceVulkan12Features vulkan12Features;
+    vulkan12Features.pNext = &vulkan13Features;
+
+    vk::PhysicalDeviceFeatures2 features;
+    features.pNext = &vulkan12Features;
+    device.getFeatures2(&features);
+
+    return vulkan12Features.timelineSemaphore &&
+           vulkan12Features.hostQueryReset &&
+           vulkan13Features.dynamicRendering &&
+           vulkan13Features.synchronization2;
+}
+
+bool VulkanDevice::checkExtensionSupport(const vk::PhysicalDevice device, const char* extensionName)
+{
+    for (const auto& deviceExtensionProperties : device.enumerateDeviceExtensionProperties())
+    {
+        if (std::strcmp(deviceExtensionProperties.extensionName, extensionName) == 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool VulkanDevice::checkPresentWaitSupport(const vk::PhysicalDevice device)
+{
+    if (!checkExtensionSupport(device, VK_KHR_PRESENT_ID_EXTENSION_NAME) ||
+        !checkExtensionSupport(device, VK_KHR_PRESENT_WAIT_EXTENSION_NAME))
+    {
+        return false;
+    }
+
+    vk::PhysicalDevicePresentIdFeaturesKHR presentIdFeatures;
+    vk::PhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures;
+    presentWaitFeatures.pNext = &presentIdFeatures;
+
+    vk::PhysicalDeviceFeatures2 features;
+    features.pNext = &presentWaitFeatures;
+    device.getFeatures2(&features);
+
+    return presentIdFeatures.presentId && presentWaitFeatures.presentWait;
+}
+
+bool VulkanDevice::checkSwapchainMaintenanceSupport(const vk::PhysicalDevice device)
+{
+    if (!VulkanContext::IsSurfaceMaintenanceEnabled() ||
+        !checkExtensionSupport(device, VK_EXT_SWAPCHAIN_MAINTENANCE_1_EXTENSION_NAME))
+    {
+        return false;
+    }
+
+    vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT swapchainMaintenanceFeatures;
+
+    vk::PhysicalDeviceFeatures2 features;
+    features.pNext = &swapchainMaintenanceFeatures;
+    device.getFeatures2(&features);
+
+    return swapchainMaintenanceFeatures.swapchainMaintenance1;
+}
+
+bool VulkanDevice::checkPipelineCacheControlSupport(const vk::PhysicalDevice device)
+{
+    vk::PhysicalDeviceVulkan13Features vulkan13Features;
+
+    vk::PhysicalDeviceFeatures2 features;
+    features.pNext = &vulkan13Features;
+    device.getFeatures2(&features);
+
+    return vulkan13Features.pipelineCreationCacheControl;
+}
+
 bool VulkanDevice::isDeviceSuitable(const vk::PhysicalDevice device)
 {
     const auto indices = VulkanQueueFamilyIndices::FindQueueFamilies(device, VulkanContext::GetSurface());
     const bool extensionsSupported = checkDeviceExtensionsSupport(device);
-    const auto swapChainSupportDetails = VulkanSwapchainSupportDetails::QuerySwapChainSupport(device, VulkanContext::GetSurface());
 
-    return indices.isComplete() && extensionsSupported && swapChainSupportDetails.isAdequate();
+    if (!indices.isComplete() || !extensionsSupported || !checkDeviceFeaturesSupport(device))
+    {
+        return false;
+    }
+
+    // headless rendering has no surface to present to
+    if (VulkanContext::GetConfig().headless)
+    {
+        return true;
+    }
+
+    const auto swapChainSupportDetails = VulkanSwapchainSupportDetails::QuerySwapChainSupport(device, VulkanContext::GetSurface());
+    return swapChainSupportDetails.isAdequate();
 }
 
 vk::PhysicalDevice VulkanDevice::pickPhysicalDevice(const std::vector<vk::PhysicalDevice>& devices)
@@ -135,7 +292,8 @@ vk::PhysicalDevice VulkanDevice::pickPhysicalDevice(const std::vector<vk::Physic
 
 void VulkanDevice::createLogicalDevice(const vk::PhysicalDevice physicalDevice)
 {
-    const auto indices = VulkanQueueFamilyIndices::FindQueueFamilies(m_physicalDevice, VulkanContext::GetSurface());
+    m_queueFamilyIndices = VulkanQueueFamilyIndices::FindQueueFamilies(m_physicalDevice, VulkanContext::GetSurface());
+    const VulkanQueueFamilyIndices& indices = m_queueFamilyIndices;
     std::set<std::uint32_t> uniqueQueueFamilies = indices.getUniqueIndices();
 
     std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
@@ -156,14 +314,53 @@ void VulkanDevice::createLogicalDevice(const vk::PhysicalDevice physicalDevice)
 
     vk::PhysicalDeviceVulkan13Features deviceVulkan13Features;
     deviceVulkan13Features.dynamicRendering = VK_TRUE;
+    deviceVulkan13Features.synchronization2 = VK_TRUE;
+
+    // optional, lets pipeline compiler threads use unlocked caches of their own
+    m_pipelineCacheControlEnabled = checkPipelineCacheControlSupport(physicalDevice);
+    deviceVulkan13Features.pipelineCreationCacheControl = m_pipelineCacheControlEnabled ? VK_TRUE : VK_FALSE;
+
+    vk::PhysicalDeviceVulkan12Features deviceVulkan12Features;
+    deviceVulkan12Features.pNext = &deviceVulkan13Features;
+    deviceVulkan12Features.timelineSemaphore = VK_TRUE;
+    deviceVulkan12Features.hostQueryReset = VK_TRUE;
+
+    std::vector<const char *> enabledExtensions = getRequiredExtensions();
+
+    // optional, used to measure real present latency
+    vk::PhysicalDevicePresentIdFeaturesKHR presentIdFeatures;
+    vk::PhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures;
+    m_presentWaitEnabled = !VulkanContext::GetConfig().headless && checkPresentWaitSupport(physicalDevice);
+    if (m_presentWaitEnabled)
+    {
+        enabledExtensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+        enabledExtensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+
+        presentIdFeatures.presentId = VK_TRUE;
+        presentWaitFeatures.presentWait = VK_TRUE;
+        presentWaitFeatures.pNext = &presentIdFeatures;
+        deviceVulkan13Features.pNext = &presentWaitFeatures;
+    }
+
+    // optional, tells when presentation engine is done with a swapchain and the semaphores presents wait on
+    vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT swapchainMaintenanceFeatures;
+    m_swapchainMaintenanceEnabled = !VulkanContext::GetConfig().headless && checkSwapchainMaintenanceSupport(physicalDevice);
+    if (m_swapchainMaintenanceEnabled)
+    {
+        enabledExtensions.push_back(VK_EXT_SWAPCHAIN_MAINTENANCE_1_EXTENSION_NAME);
+
+        swapchainMaintenanceFeatures.swapchainMaintenance1 = VK_TRUE;
+        swapchainMaintenanceFeatures.pNext = deviceVulkan13Features.pNext;
+        deviceVulkan13Features.pNext = &swapchainMaintenanceFeatures;
+    }
 
     vk::DeviceCreateInfo deviceCreateInfo = {
         .sType = vk::StructureType::eDeviceCreateInfo,
-        .pNext = &deviceVulkan13Features,
+        .pNext = &deviceVulkan12Features,
         .queueCreateInfoCount = static_cast<std::uint32_t>(queueCreateInfos.size()),
         .pQueueCreateInfos = queueCreateInfos.data(),
-        .enabledExtensionCount = static_cast<uint32_t>(m_deviceExtensions.size()),
-        .ppEnabledExtensionNames = m_deviceExtensions.data(),
+        .enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size()),
+        .ppEnabledExtensionNames = enabledExtensions.data(),
         .pEnabledFeatures = &deviceFeatures
     };
 
@@ -174,15 +371,57 @@ void VulkanDevice::createLogicalDevice(const vk::PhysicalDevice physicalDevice)
     deviceCreateInfo.ppEnabledLayerNames = enabledLayers.data();
 
     m_logicalDevice = m_physicalDevice.createDevice(deviceCreateInfo);
-    m_queues.graphicsQueue = m_logicalDevice.getQueue(indices.graphicsFamily.value(), 0);
-    m_queues.presentQueue = m_logicalDevice.getQueue(indices.presentFamily.value(), 0);
+    loadDispatch();
+
+    m_queues.graphicsQueue = m_logicalDevice.getQueue(indices.graphicsFamily.value(), 0, m_dispatch);
+    if (indices.presentFamily.has_value())
+    {
+        m_queues.presentQueue = m_logicalDevice.getQueue(indices.presentFamily.value(), 0, m_dispatch);
+    }
+
+    m_queues.transferQueue = indices.transferFamily.has_value()
+                                 ? m_logicalDevice.getQueue(indices.transferFamily.value(), 0, m_dispatch)
+                                 : m_queues.graphicsQueue;
+    spdlog::info("Uploads go to {} queue", indices.transferFamily.has_value() ? "dedicated transfer" : "graphics");
+}
+
+void VulkanDevice::loadDispatch()
+{
+    // with device given, device-level functions resolve straight to the driver
+    m_dispatch.init(VulkanContext::GetVulkanInstance(), vkGetInstanceProcAddr, m_logicalDevice, vkGetDeviceProcAddr);
 }
 
 void VulkanDevice::createVmaAllocator()
 {
+    // share the already loaded table, so VMA doesn't go through the loader either
     VmaVulkanFunctions vulkanFunctions = {};
-    vulkanFunctions.vkGetInstanceProcAddr = &vkGetInstanceProcAddr;
-    vulkanFunctions.vkGetDeviceProcAddr = &vkGetDeviceProcAddr;
+    vulkanFunctions.vkGetInstanceProcAddr = m_dispatch.vkGetInstanceProcAddr;
+    vulkanFunctions.vkGetDeviceProcAddr = m_dispatch.vkGetDeviceProcAddr;
+    vulkanFunctions.vkGetPhysicalDeviceProperties = m_dispatch.vkGetPhysicalDeviceProperties;
+    vulkanFunctions.vkGetPhysicalDeviceMemoryProperties = m_dispatch.vkGetPhysicalDeviceMemoryProperties;
+    vulkanFunctions.vkAllocateMemory = m_dispatch.vkAllocateMemory;
+    vulkanFunctions.vkFreeMemory = m_dispatch.vkFreeMemory;
+    vulkanFunctions.vkMapMemory = m_dispatch.vkMapMemory;
+    vulkanFunctions.vkUnmapMemory = m_dispatch.vkUnmapMemory;
+    vulkanFunctions.vkFlushMappedMemoryRanges = m_dispatch.vkFlushMappedMemoryRanges;
+    vulkanFunctions.vkInvalidateMappedMemoryRanges = m_dispatch.vkInvalidateMappedMemoryRanges;
+    vulkanFunctions.vkBindBufferMemory = m_dispatch.vkBindBufferMemory;
+    vulkanFunctions.vkBindImageMemory = m_dispatch.vkBindImageMemory;
+    vulkanFunctions.vkGetBufferMemoryRequirements = m_dispatch.vkGetBufferMemoryRequirements;
+    vulkanFunctions.vkGetImageMemoryRequirements = m_dispatch.vkGetImageMemoryRequirements;
+    vulkanFunctions.vkCreateBuffer = m_dispatch.vkCreateBuffer;
+    vulkanFunctions.vkDestroyBuffer = m_dispatch.vkDestroyBuffer;
+    vulkanFunctions.vkCreateImage = m_dispatch.vkCreateImage;
+    vulkanFunctions.vkDestroyImage = m_dispatch.vkDestroyImage;
+    vulkanFunctions.vkCmdCopyBuffer = m_dispatch.vkCmdCopyBuffer;
+    // core in Vulkan 1.1+, VMA only knows them by KHR names
+    vulkanFunctions.vkGetBufferMemoryRequirements2KHR = m_dispatch.vkGetBufferMemoryRequirements2;
+    vulkanFunctions.vkGetImageMemoryRequirements2KHR = m_dispatch.vkGetImageMemoryRequirements2;
+    vulkanFunctions.vkBindBufferMemory2KHR = m_dispatch.vkBindBufferMemory2;
+    vulkanFunctions.vkBindImageMemory2KHR = m_dispatch.vkBindImageMemory2;
+    vulkanFunctions.vkGetPhysicalDeviceMemoryProperties2KHR = m_dispatch.vkGetPhysicalDeviceMemoryProperties2;
+    vulkanFunctions.vkGetDeviceBufferMemoryRequirements = m_dispatch.vkGetDeviceBufferMemoryRequirements;
+    vulkanFunctions.vkGetDeviceImageMemoryRequirements = m_dispatch.vkGetDeviceImageMemoryRequirements;
 
     const VmaAllocatorCreateInfo createInfo = {
         .flags = VmaAllocatorCreateFlags(), // add extensions here if ones are used
@@ -200,17 +439,13 @@ void VulkanDevice::createVmaAllocator()
 
 void VulkanDevice::createCommandPool()
 {
-    VulkanQueueFamilyIndices queueIndices = VulkanQueueFamilyIndices::FindQueueFamilies(
-        VulkanContext::GetPhysicalDevice(),
-        VulkanContext::GetSurface()
-    );
-
     vk::CommandPoolCreateInfo commandPoolCreateInfo = {
         .sType = vk::StructureType::eCommandPoolCreateInfo,
         .pNext = nullptr,
         .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
-        .queueFamilyIndex = queueIndices.graphicsFamily.value()
+        .queueFamilyIndex = m_queueFamilyIndices.graphicsFamily.value()
     };
 
-    m_commandPool = VulkanContext::GetLogicalDevice().createCommandPool(commandPoolCreateInfo);
+    m_commandPool = VulkanContext::GetLogicalDevice().createCommandPool(
+        commandPoolCreateInfo, nullptr, VulkanContext::GetDispatch());
 }
@@ -4,6 +4,9 @@
 #include <vk_mem_alloc.h>
 #include <vulkan/vulkan.hpp>
 
+#include "VulkanDeletionQueue.h"
+#include "VulkanQueueFamilyIndices.h"
+#include "VulkanTimeline.h"
 #include "utility/Utility.h"
 
 class VulkanDevice {
@@ -12,6 +15,8 @@ public:
     {
         vk::Queue graphicsQueue = VK_NULL_HANDLE;
         vk::Queue presentQueue = VK_NULL_HANDLE;
+        // graphics queue if there is no dedicated transfer family
+        vk::Queue transferQueue = VK_NULL_HANDLE;
     };
 
 public:
@@ -22,8 +27,32 @@ public:
     NODISCARD vk::PhysicalDevice getPhysicalDevice() const;
     NODISCARD vk::CommandPool getCommandPool() const;
     NODISCARD const DeviceQueues& getQueues() const;
+    NODISCARD const VulkanQueueFamilyIndices& getQueueFamilyIndices() const;
     NODISCARD VmaAllocator getVmaAllocator() const;
 
+    // device-level entry points loaded with vkGetDeviceProcAddr, skip the loader trampoline.
+    // Pass it to command buffer and queue calls on hot paths
+    NODISCARD const vk::DispatchLoaderDynamic& getDispatch() const;
+
+    // progress of all work submitted to graphics queue
+    NODISCARD VulkanTimeline& getGraphicsTimeline();
+
+    // progress of all work submitted to transfer queue, graphics timeline if the queue is shared
+    NODISCARD VulkanTimeline& getTransferTimeline();
+    NODISCARD bool hasDedicatedTransferQueue() const;
+
+    // objects pushed here are destroyed once graphics timeline reaches their value
+    NODISCARD VulkanDeletionQueue& getDeletionQueue();
+
+    // VK_KHR_present_id and VK_KHR_present_wait are both enabled
+    NODISCARD bool isPresentWaitEnabled() const;
+
+    // VK_EXT_swapchain_maintenance1 is enabled, presents can signal fences
+    NODISCARD bool isSwapchainMaintenanceEnabled() const;
+
+    // pipelineCreationCacheControl is enabled, pipeline caches may be created externally synchronized
+    NODISCARD bool isPipelineCacheControlEnabled() const;
+
 private:
     static bool isDescreteGPU(vk::PhysicalDevice device);
 
@@ -31,14 +60,28 @@ private:
 
     static void logPhysicalDeviceInfo(vk::PhysicalDevice device);
 
+    std::vector<const char *> getRequiredExtensions() const;
+
     bool checkDeviceExtensionsSupport(vk::PhysicalDevice device);
 
+    static bool checkDeviceFeaturesSupport(vk::PhysicalDevice device);
+
+    static bool checkExtensionSupport(vk::PhysicalDevice device, const char* extensionName);
+
+    static bool checkPresentWaitSupport(vk::PhysicalDevice device);
+
+    static bool checkPipelineCacheControlSupport(vk::PhysicalDevice device);
+
+    static bool checkSwapchainMaintenanceSupport(vk::PhysicalDevice device);
+
     bool isDeviceSuitable(vk::PhysicalDevice device);
 
     vk::PhysicalDevice pickPhysicalDevice(const std::vector<vk::PhysicalDevice>& devices);
 
     void createLogicalDevice(vk::PhysicalDevice physicalDevice);
 
+    void loadDispatch();
+
     void createCommandPool();
 
     void createVmaAllocator();
@@ -48,13 +91,28 @@ private:
     vk::Device m_logicalDevice = VK_NULL_HANDLE;
     vk::CommandPool m_commandPool = VK_NULL_HANDLE;
     DeviceQueues m_queues;
+    VulkanQueueFamilyIndices m_queueFamilyIndices;
+
+    vk::DispatchLoaderDynamic m_dispatch;
+
+    VulkanTimeline m_graphicsTimeline;
+    VulkanTimeline m_transferTimeline;
+    VulkanDeletionQueue m_deletionQueue;
 
     VmaAllocator m_vmaAllocator = VK_NULL_HANDLE;
 
+    bool m_presentWaitEnabled = false;
+    bool m_pipelineCacheControlEnabled = false;
+    bool m_swapchainMaintenanceEnabled = false;
+
     const std::vector<const char *> m_deviceExtensions = {
-        VK_KHR_SWAPCHAIN_EXTENSION_NAME,
         VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME
     };
+
+    // not needed for headless rendering
+    const std::vector<const char *> m_presentationExtensions = {
+        VK_KHR_SWAPCHAIN_EXTENSION_NAME
+    };
 };
 
 
@@ -0,0 +1,156 @@
+#include "VulkanFrameAllocator.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include "VulkanContext.h"
+
+namespace
+{
+    vk::DeviceSize AlignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+void VulkanFrameAllocator::init(vk::DeviceSize frameCapacity, std::uint32_t framesInFlight)
+{
+    const vk::PhysicalDeviceLimits limits = VulkanContext::GetPhysicalDevice().getProperties().limits;
+    m_uniformAlignment = limits.minUniformBufferOffsetAlignment;
+    m_storageAlignment = limits.minStorageBufferOffsetAlignment;
+
+    // every frame region starts at an offset usable by any descriptor type
+    m_frameCapacity = AlignUp(frameCapacity, std::max(m_uniformAlignment, m_storageAlignment));
+    const vk::DeviceSize bufferSize = m_frameCapacity * framesInFlight;
+    if (bufferSize > std::numeric_limits<std::uint32_t>::max())
+        throw std::runtime_error("Frame allocator doesn't fit 32 bit dynamic offsets, decrease frameAllocatorSize!");
+
+    vk::BufferCreateInfo bufferCreateInfo = {
+        .sType = vk::StructureType::eBufferCreateInfo,
+        .pNext = nullptr,
+        .flags = vk::BufferCreateFlags(),
+        .size = bufferSize,
+        .usage = vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer |
+                 vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer,
+        .sharingMode = vk::SharingMode::eExclusive,
+        .queueFamilyIndexCount = 0,
+        .pQueueFamilyIndices = nullptr
+    };
+
+    // GPU reads it straight from host visible memory, device local one where available
+    VmaAllocationCreateInfo allocationCreateInfo = {};
+    allocationCreateInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+                                 VMA_ALLOCATION_CREATE_MAPPED_BIT;
+    allocationCreateInfo.usage = VMA_MEMORY_USAGE_AUTO;
+
+    VmaAllocationInfo allocationInfo;
+    VkResult result = vmaCreateBuffer(VulkanContext::GetDevice().getVmaAllocator(),
+                                      (VkBufferCreateInfo *) &bufferCreateInfo,
+                                      &allocationCreateInfo,
+                                      (VkBuffer *) &m_buffer,
+                                      &m_allocation,
+                                      &allocationInfo);
+
+    if (result != VK_SUCCESS)
+        throw std::runtime_error("Failed to create frame allocator buffer!");
+
+    m_mappedData = static_cast<std::byte *>(allocationInfo.pMappedData);
+    m_frameBegin = 0;
+    m_frameUsage = 0;
+}
+
+void VulkanFrameAllocator::destroy() noexcept
+{
+    // also called when frames in flight change, every buffer reports its own peak
+    if (m_peakFrameUsage > 0)
+    {
+        spdlog::info("Frame allocator: peak {} of {} KiB per frame", m_peakFrameUsage / 1024, m_frameCapacity / 1024);
+    }
+
+    vmaDestroyBuffer(VulkanContext::GetDevice().getVmaAllocator(), m_buffer, m_allocation);
+
+    m_buffer = VK_NULL_HANDLE;
+    m_allocation = VK_NULL_HANDLE;
+    m_mappedData = nullptr;
+    m_frameCapacity = 0;
+    m_frameBegin = 0;
+    m_frameUsage = 0;
+    m_lastFrameUsage = 0;
+    m_peakFrameUsage = 0;
+}
+
+void VulkanFrameAllocator::beginFrame(std::uint32_t frameIndex)
+{
+    m_lastFrameUsage = m_frameUsage.load(std::memory_order_relaxed);
+    m_peakFrameUsage = std::max(m_peakFrameUsage, m_lastFrameUsage);
+
+    m_frameBegin = m_frameCapacity * frameIndex;
+    m_frameUsage.store(0, std::memory_order_relaxed);
+}
+
+void VulkanFrameAllocator::flush()
+{
+    const vk::DeviceSize usage = m_frameUsage.load(std::memory_order_relaxed);
+    if (usage > 0)
+    {
+        vmaFlushAllocation(VulkanContext::GetDevice().getVmaAllocator(), m_allocation, m_frameBegin, usage);
+    }
+}
+
+VulkanFrameAllocator::Allocation VulkanFrameAllocator::allocate(vk::DeviceSize size, vk::DeviceSize alignment)
+{
+    ASSERT(size > 0 && "Empty allocation!");
+    if (alignment == 0)
+        throw std::runtime_error("Frame allocator alignment must not be zero!");
+
+    // recording threads allocate concurrently, bump is a compare-exchange instead of a lock
+    vk::DeviceSize usage = m_frameUsage.load(std::memory_order_relaxed);
+    vk::DeviceSize offset;
+    do
+    {
+        // alignment is relative to the buffer, not to the frame region
+        offset = AlignUp(m_frameBegin + usage, alignment) - m_frameBegin;
+        if (offset + size > m_frameCapacity)
+            throw std::runtime_error("Frame allocator is out of space, increase frameAllocatorSize!");
+    }
+    while (!m_frameUsage.compare_exchange_weak(usage, offset + size, std::memory_order_relaxed));
+
+    return {
+        .buffer = m_buffer,
+        .offset = static_cast<std::uint32_t>(m_frameBegin + offset),
+        .size = size,
+        .mappedData = m_mappedData + m_frameBegin + offset
+    };
+}
+
+VulkanFrameAllocator::Allocation VulkanFrameAllocator::allocateUniform(vk::DeviceSize size)
+{
+    return allocate(size, m_uniformAlignment);
+}
+
+VulkanFrameAllocator::Allocation VulkanFrameAllocator::allocateStorage(vk::DeviceSize size)
+{
+    return allocate(size, m_storageAlignment);
+}
+
+vk::Buffer VulkanFrameAllocator::getBuffer() const
+{
+    return m_buffer;
+}
+
+vk::DeviceSize VulkanFrameAllocator::getFrameCapacity() const
+{
+    return m_frameCapacity;
+}
+
+VulkanFrameAllocator::Stats VulkanFrameAllocator::getStats() const
+{
+    return {
+        .frameCapacity = m_frameCapacity,
+        .lastFrameUsage = m_lastFrameUsage,
+        .peakFrameUsage = std::max(m_peakFrameUsage, m_frameUsage.load(std::memory_order_relaxed))
+    };
+}
@@ -0,0 +1,99 @@
+#ifndef VULKANFRAMEALLOCATOR_H
+#define VULKANFRAMEALLOCATOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan.hpp>
+
+#include "utility/NonCopyable.h"
+#include "utility/NonMovable.h"
+#include "utility/Utility.h"
+
+// Transient GPU data of one frame: camera matrices, per-draw constants, streamed vertices.
+// One persistently mapped buffer is split into a region per frame in flight, allocations bump
+// an offset inside the current region and the whole region is reset once the slot comes around again.
+//
+// All regions live in the same buffer, so a single dynamic uniform or storage buffer descriptor
+// covers every frame and the returned offset is passed as its dynamic offset:
+//
+//   Allocation constants = allocator.push(DrawConstants{...});
+//   commandBuffer.bindDescriptorSets(..., set, 1, &constants.offset);
+//
+// Offsets change every frame, so command buffers using it can't be cached and resubmitted.
+class VulkanFrameAllocator : NonCopyable, NonMovable
+{
+public:
+    struct Allocation
+    {
+        vk::Buffer buffer = VK_NULL_HANDLE;
+        // dynamic offsets are 32 bit
+        std::uint32_t offset = 0;
+        vk::DeviceSize size = 0;
+        std::byte* mappedData = nullptr;
+    };
+
+    struct Stats
+    {
+        vk::DeviceSize frameCapacity = 0;
+        // bytes allocated by the most recent frame and the most by any frame so far
+        vk::DeviceSize lastFrameUsage = 0;
+        vk::DeviceSize peakFrameUsage = 0;
+    };
+
+public:
+    VulkanFrameAllocator() = default;
+
+    // throws std::runtime_error when the whole buffer exceeds range of 32 bit dynamic offsets
+    void init(vk::DeviceSize frameCapacity, std::uint32_t framesInFlight);
+    // GPU must be done with all frames, stats are reset
+    void destroy() noexcept;
+
+    // GPU must be done with the frame slot, everything allocated in it before is discarded
+    void beginFrame(std::uint32_t frameIndex);
+    // makes host writes of the current frame visible to GPU, called before its submission
+    void flush();
+
+    // Throws std::runtime_error when the frame region is exhausted or alignment is zero.
+    // Safe to call from recording threads
+    NODISCARD Allocation allocate(vk::DeviceSize size, vk::DeviceSize alignment);
+    // aligned to minUniformBufferOffsetAlignment and minStorageBufferOffsetAlignment respectively
+    NODISCARD Allocation allocateUniform(vk::DeviceSize size);
+    NODISCARD Allocation allocateStorage(vk::DeviceSize size);
+
+    // copies the value into a new uniform allocation
+    template <typename T>
+    NODISCARD Allocation push(const T& value)
+    {
+        const Allocation allocation = allocateUniform(sizeof(T));
+        std::memcpy(allocation.mappedData, &value, sizeof(T));
+        return allocation;
+    }
+
+    // whole buffer, for descriptors and vertex or index bindings
+    NODISCARD vk::Buffer getBuffer() const;
+    NODISCARD vk::DeviceSize getFrameCapacity() const;
+    NODISCARD Stats getStats() const;
+
+private:
+    vk::Buffer m_buffer = VK_NULL_HANDLE;
+    VmaAllocation m_allocation = VK_NULL_HANDLE;
+    std::byte* m_mappedData = nullptr;
+
+    vk::DeviceSize m_frameCapacity = 0;
+    vk::DeviceSize m_uniformAlignment = 1;
+    vk::DeviceSize m_storageAlignment = 1;
+
+    // start of the current frame region in the buffer
+    vk::DeviceSize m_frameBegin = 0;
+    // bump offset relative to m_frameBegin
+    std::atomic<vk::DeviceSize> m_frameUsage = 0;
+
+    vk::DeviceSize m_lastFrameUsage = 0;
+    vk::DeviceSize m_peakFrameUsage = 0;
+};
+
+#endif //VULKANFRAMEALLOCATOR_H
@@ -0,0 +1,317 @@
+#include "VulkanGeometryArena.h"
+
+#include <stdexcept>
+#include <utility>
+
+#include "VulkanContext.h"
+
+namespace
+{
+    constexpr vk::PipelineStageFlags2 GeometryReadStages =
+        vk::PipelineStageFlagBits2::eVertexAttributeInput | vk::PipelineStageFlagBits2::eIndexInput;
+    constexpr vk::AccessFlags2 GeometryReadAccess =
+        vk::AccessFlagBits2::eVertexAttributeRead | vk::AccessFlagBits2::eIndexRead;
+}
+
+void VulkanGeometryArena::init(std::uint32_t vertexCapacity, std::uint32_t indexCapacity)
+{
+    ASSERT(vertexCapacity > 0 && indexCapacity > 0 && "Empty geometry arena!");
+
+    m_vertexAllocator = OffsetAllocator(vertexCapacity);
+    m_indexAllocator = OffsetAllocator(indexCapacity);
+    m_buffers = createBuffers();
+}
+
+void VulkanGeometryArena::destroy() noexcept
+{
+    const VmaAllocator allocator = VulkanContext::GetDevice().getVmaAllocator();
+    if (m_buffers.vertexBuffer)
+    {
+        vmaDestroyBuffer(allocator, m_buffers.vertexBuffer, m_buffers.vertexAllocation);
+    }
+    if (m_buffers.indexBuffer)
+    {
+        vmaDestroyBuffer(allocator, m_buffers.indexBuffer, m_buffers.indexAllocation);
+    }
+
+    m_buffers = {};
+    m_meshes.clear();
+    m_freeIds.clear();
+    m_retired.clear();
+    m_vertexAllocator = OffsetAllocator();
+    m_indexAllocator = OffsetAllocator();
+}
+
+VulkanGeometryArena::MeshId VulkanGeometryArena::addMesh(VulkanUploader::Batch& batch,
+                                                         std::span<const VulkanVertex> vertices,
+                                                         std::span<const IndexType> indices)
+{
+    ASSERT(!vertices.empty() && !indices.empty() && "Empty mesh!");
+
+    reclaimRetired();
+
+    const auto vertexCount = static_cast<std::uint32_t>(vertices.size());
+    const auto indexCount = static_cast<std::uint32_t>(indices.size());
+
+    const std::optional<std::uint32_t> vertexOffset = m_vertexAllocator.allocate(vertexCount);
+    if (!vertexOffset)
+        throw std::runtime_error("Geometry arena is out of vertex space!");
+
+    const std::optional<std::uint32_t> indexOffset = m_indexAllocator.allocate(indexCount);
+    if (!indexOffset)
+    {
+        m_vertexAllocator.free(*vertexOffset);
+        throw std::runtime_error("Geometry arena is out of index space!");
+    }
+
+    VulkanUploader::Token upload;
+    VulkanUploader& uploader = VulkanContext::GetUploader();
+    const vk::DeviceSize vertexByteOffset = *vertexOffset * sizeof(VulkanVertex);
+    const vk::DeviceSize indexByteOffset = *indexOffset * sizeof(IndexType);
+
+    // freshly allocated ranges are not used by GPU, so host visible buffers are written right away
+    const bool vertexWritten =
+        uploader.writeDirect(m_buffers.vertexAllocation, vertexByteOffset, vertices.data(), vertices.size_bytes());
+    const bool indexWritten =
+        uploader.writeDirect(m_buffers.indexAllocation, indexByteOffset, indices.data(), indices.size_bytes());
+
+    // other ranges are read by frames in flight while this one is written
+    const vk::SharingMode sharingMode = VulkanUploader::GetSharingFamilies().empty()
+        ? vk::SharingMode::eExclusive
+        : vk::SharingMode::eConcurrent;
+
+    // both copies share the token of the batch
+    if (!vertexWritten)
+    {
+        upload = batch.addBuffer(m_buffers.vertexBuffer, vertexByteOffset, vertices.data(), vertices.size_bytes(),
+                                 vk::PipelineStageFlagBits2::eVertexAttributeInput,
+                                 vk::AccessFlagBits2::eVertexAttributeRead, sharingMode);
+    }
+    if (!indexWritten)
+    {
+        upload = batch.addBuffer(m_buffers.indexBuffer, indexByteOffset, indices.data(), indices.size_bytes(),
+                                 vk::PipelineStageFlagBits2::eIndexInput, vk::AccessFlagBits2::eIndexRead,
+                                 sharingMode);
+    }
+
+    MeshId id;
+    if (m_freeIds.empty())
+    {
+        id = static_cast<MeshId>(m_meshes.size());
+        m_meshes.emplace_back();
+    }
+    else
+    {
+        id = m_freeIds.back();
+        m_freeIds.pop_back();
+    }
+
+    m_meshes[id] = {
+        .alive = true,
+        .vertexOffset = *vertexOffset,
+        .vertexCount = vertexCount,
+        .indexOffset = *indexOffset,
+        .indexCount = indexCount,
+        .upload = upload
+    };
+
+    return id;
+}
+
+void VulkanGeometryArena::removeMesh(MeshId mesh)
+{
+    Mesh& removed = m_meshes[mesh];
+    ASSERT(removed.alive && "Removing mesh that doesn't exist!");
+
+    // pending upload would write into the range after it's handed out again, once it's acquired
+    // every use of the range is on graphics timeline
+    removed.upload.wait();
+
+    const std::uint64_t lastUse = VulkanContext::GetDevice().getGraphicsTimeline().getLastSignaledValue();
+    m_retired.push_back({lastUse, removed.vertexOffset, removed.indexOffset});
+
+    removed = {};
+    m_freeIds.push_back(mesh);
+}
+
+VulkanGeometryArena::DrawRange VulkanGeometryArena::getDrawRange(MeshId mesh) const
+{
+    const Mesh& drawn = getMesh(mesh);
+    return {
+        .firstIndex = drawn.indexOffset,
+        .vertexOffset = static_cast<std::int32_t>(drawn.vertexOffset),
+        .indexCount = drawn.indexCount
+    };
+}
+
+const VulkanUploader::Token& VulkanGeometryArena::getUploadToken(MeshId mesh) const
+{
+    return getMesh(mesh).upload;
+}
+
+void VulkanGeometryArena::defragment()
+{
+    for (const Mesh& mesh : m_meshes)
+    {
+        if (mesh.alive)
+        {
+            mesh.upload.wait();
+        }
+    }
+
+    // Copy regions of vkCmdCopyBuffer must not overlap within one buffer, so meshes are packed into
+    // new buffers instead of being moved in place. Frames in flight keep reading the old ones
+    const GeometryBuffers oldBuffers = m_buffers;
+    m_buffers = createBuffers();
+
+    // retired ranges are gone with the old buffers
+    m_retired.clear();
+    m_vertexAllocator.reset();
+    m_indexAllocator.reset();
+
+    VulkanUploader::GpuCopy vertexCopy = {.src = oldBuffers.vertexBuffer, .dst = m_buffers.vertexBuffer, .regions = {}};
+    VulkanUploader::GpuCopy indexCopy = {.src = oldBuffers.indexBuffer, .dst = m_buffers.indexBuffer, .regions = {}};
+    for (Mesh& mesh : m_meshes)
+    {
+        if (!mesh.alive)
+            continue;
+
+        // allocator is empty, so every range is placed right after the previous one
+        const std::uint32_t vertexOffset = m_vertexAllocator.allocate(mesh.vertexCount).value();
+        const std::uint32_t indexOffset = m_indexAllocator.allocate(mesh.indexCount).value();
+
+        vertexCopy.regions.push_back({
+            .srcOffset = mesh.vertexOffset * sizeof(VulkanVertex),
+            .dstOffset = vertexOffset * sizeof(VulkanVertex),
+            .size = mesh.vertexCount * sizeof(VulkanVertex)
+        });
+        indexCopy.regions.push_back({
+            .srcOffset = mesh.indexOffset * sizeof(IndexType),
+            .dstOffset = indexOffset * sizeof(IndexType),
+            .size = mesh.indexCount * sizeof(IndexType)
+        });
+
+        mesh.vertexOffset = vertexOffset;
+        mesh.indexOffset = indexOffset;
+        // contents are moved by graphics queue, draws submitted after the copy see them
+        mesh.upload = {};
+    }
+
+    VulkanDevice& device = VulkanContext::GetDevice();
+    std::uint64_t lastUse = device.getGraphicsTimeline().getLastSignaledValue();
+    if (!vertexCopy.regions.empty())
+    {
+        const VulkanUploader::GpuCopy copies[] = {std::move(vertexCopy), std::move(indexCopy)};
+        lastUse = VulkanContext::GetUploader().copyBuffers(copies, GeometryReadStages, GeometryReadAccess);
+    }
+
+    device.getDeletionQueue().push(lastUse, [oldBuffers]() {
+        const VmaAllocator allocator = VulkanContext::GetDevice().getVmaAllocator();
+        vmaDestroyBuffer(allocator, oldBuffers.vertexBuffer, oldBuffers.vertexAllocation);
+        vmaDestroyBuffer(allocator, oldBuffers.indexBuffer, oldBuffers.indexAllocation);
+    });
+
+    ++m_generation;
+    ++m_defragmentations;
+}
+
+std::uint64_t VulkanGeometryArena::getGeneration() const
+{
+    return m_generation;
+}
+
+vk::Buffer VulkanGeometryArena::getVertexBuffer() const
+{
+    return m_buffers.vertexBuffer;
+}
+
+vk::Buffer VulkanGeometryArena::getIndexBuffer() const
+{
+    return m_buffers.indexBuffer;
+}
+
+VulkanGeometryArena::Stats VulkanGeometryArena::getStats() const
+{
+    Stats stats = {
+        .vertexCapacity = m_vertexAllocator.getCapacity(),
+        .usedVertices = m_vertexAllocator.getCapacity() - m_vertexAllocator.getFreeSpace(),
+        .largestFreeVertexRange = m_vertexAllocator.getLargestFreeRange(),
+        .indexCapacity = m_indexAllocator.getCapacity(),
+        .usedIndices = m_indexAllocator.getCapacity() - m_indexAllocator.getFreeSpace(),
+        .largestFreeIndexRange = m_indexAllocator.getLargestFreeRange(),
+        .defragmentations = m_defragmentations
+    };
+
+    stats.meshes = static_cast<std::uint32_t>(m_meshes.size() - m_freeIds.size());
+    return stats;
+}
+
+VulkanGeometryArena::GeometryBuffers VulkanGeometryArena::createBuffers() const
+{
+    const std::vector<std::uint32_t> sharingFamilies = VulkanUploader::GetSharingFamilies();
+    const VmaAllocator allocator = VulkanContext::GetDevice().getVmaAllocator();
+
+    VmaAllocationCreateInfo allocationCreateInfo = {};
+    allocationCreateInfo.flags = VulkanUploader::GetDirectWriteAllocationFlags();
+    allocationCreateInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+
+    const auto createBuffer = [&](vk::DeviceSize size, vk::BufferUsageFlags usage, VmaAllocation& allocation) {
+        const vk::BufferCreateInfo bufferCreateInfo = {
+            .sType = vk::StructureType::eBufferCreateInfo,
+            .pNext = nullptr,
+            .flags = vk::BufferCreateFlags(),
+            .size = size,
+            // source of the copy when defragmenting
+            .usage = usage | vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eTransferSrc,
+            .sharingMode = sharingFamilies.empty() ? vk::SharingMode::eExclusive : vk::SharingMode::eConcurrent,
+            .queueFamilyIndexCount = static_cast<std::uint32_t>(sharingFamilies.size()),
+            .pQueueFamilyIndices = sharingFamilies.data()
+        };
+
+        vk::Buffer buffer;
+        const VkResult result = vmaCreateBuffer(allocator,
+                                                reinterpret_cast<const VkBufferCreateInfo *>(&bufferCreateInfo),
+                                                &allocationCreateInfo,
+                                                reinterpret_cast<VkBuffer *>(&buffer),
+                                                &allocation,
+                                                nullptr);
+
+        if (result != VK_SUCCESS)
+            throw std::runtime_error("Failed to create geometry arena buffer!");
+
+        return buffer;
+    };
+
+    GeometryBuffers buffers;
+    buffers.vertexBuffer = createBuffer(static_cast<vk::DeviceSize>(m_vertexAllocator.getCapacity()) * sizeof(VulkanVertex),
+                                        vk::BufferUsageFlagBits::eVertexBuffer, buffers.vertexAllocation);
+    try
+    {
+        buffers.indexBuffer = createBuffer(static_cast<vk::DeviceSize>(m_indexAllocator.getCapacity()) * sizeof(IndexType),
+                                           vk::BufferUsageFlagBits::eIndexBuffer, buffers.indexAllocation);
+    }
+    catch (...)
+    {
+        vmaDestroyBuffer(allocator, buffers.vertexBuffer, buffers.vertexAllocation);
+        throw;
+    }
+
+    return buffers;
+}
+
+void VulkanGeometryArena::reclaimRetired()
+{
+    VulkanTimeline& timeline = VulkanContext::GetDevice().getGraphicsTimeline();
+    while (!m_retired.empty() && timeline.isReached(m_retired.front().lastUse))
+    {
+        m_vertexAllocator.free(m_retired.front().vertexOffset);
+        m_indexAllocator.free(m_retired.front().indexOffset);
+        m_retired.pop_front();
+    }
+}
+
+const VulkanGeometryArena::Mesh& VulkanGeometryArena::getMesh(MeshId mesh) const
+{
+    ASSERT(mesh < m_meshes.size() && m_meshes[mesh].alive && "Mesh doesn't exist!");
+    return m_meshes[mesh];
+}
@@ -0,0 +1,133 @@
+#ifndef VULKANGEOMETRYARENA_H
+#define VULKANGEOMETRYARENA_H
+
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <vector>
+
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan.hpp>
+
+#include "VulkanBuffers.h"
+#include "VulkanUploader.h"
+#include "utility/NonCopyable.h"
+#include "utility/NonMovable.h"
+#include "utility/OffsetAllocator.h"
+#include "utility/Utility.h"
+
+// Vertices and indices of all meshes in one device local vertex buffer and one index buffer,
+// sub-allocated per mesh. Every mesh is drawn from the same two bindings with its own
+// firstIndex and vertexOffset, so draws don't rebind buffers and fit into multi-draw indirect.
+//
+// Ranges of removed meshes are reused once GPU is done with them. Fragmented free space is
+// compacted by defragment(), which moves meshes and so changes their draw ranges and getGeneration()
+class VulkanGeometryArena : NonCopyable, NonMovable
+{
+public:
+    using MeshId = std::uint32_t;
+    using IndexType = std::uint16_t;
+
+    // arguments of vkCmdDrawIndexed
+    struct DrawRange
+    {
+        std::uint32_t firstIndex = 0;
+        std::int32_t vertexOffset = 0;
+        std::uint32_t indexCount = 0;
+    };
+
+    struct Stats
+    {
+        std::uint32_t meshes = 0;
+        std::uint32_t vertexCapacity = 0;
+        std::uint32_t usedVertices = 0;
+        std::uint32_t largestFreeVertexRange = 0;
+        std::uint32_t indexCapacity = 0;
+        std::uint32_t usedIndices = 0;
+        std::uint32_t largestFreeIndexRange = 0;
+        std::uint64_t defragmentations = 0;
+    };
+
+public:
+    VulkanGeometryArena() = default;
+
+    // capacities are in vertices and indices
+    void init(std::uint32_t vertexCapacity, std::uint32_t indexCapacity);
+    // GPU must be idle
+    void destroy() noexcept;
+
+    // Data is written right away if arena memory is host visible, otherwise its upload is recorded into
+    // the batch and must stay alive until it's submitted. Throws std::runtime_error
+    // when there is no free range big enough, defragment() may help if total free space is enough
+    NODISCARD MeshId addMesh(VulkanUploader::Batch& batch, std::span<const VulkanVertex> vertices,
+                             std::span<const IndexType> indices);
+    // range is reused once GPU has finished every submission made so far
+    void removeMesh(MeshId mesh);
+
+    NODISCARD DrawRange getDrawRange(MeshId mesh) const;
+    // mesh must not be drawn before the token is ready
+    NODISCARD const VulkanUploader::Token& getUploadToken(MeshId mesh) const;
+
+    // Moves all meshes to the beginning of new buffers with one GPU copy on graphics queue, old buffers
+    // are released once frames in flight are done. Both sets are alive until then, so device memory
+    // of the arena peaks at twice its capacity. Waits for pending uploads, so all batches with meshes
+    // of the arena must be submitted before
+    void defragment();
+
+    // changes when buffers or draw ranges of existing meshes change, draws recorded before must be rebuilt
+    NODISCARD std::uint64_t getGeneration() const;
+
+    NODISCARD vk::Buffer getVertexBuffer() const;
+    NODISCARD vk::Buffer getIndexBuffer() const;
+    NODISCARD vk::IndexType getIndexType() const { return vk::IndexType::eUint16; }
+
+    NODISCARD Stats getStats() const;
+
+private:
+    struct Mesh
+    {
+        bool alive = false;
+        std::uint32_t vertexOffset = 0;
+        std::uint32_t vertexCount = 0;
+        std::uint32_t indexOffset = 0;
+        std::uint32_t indexCount = 0;
+        VulkanUploader::Token upload;
+    };
+
+    struct RetiredMesh
+    {
+        // graphics timeline value of the last submission that may have used the ranges
+        std::uint64_t lastUse;
+        std::uint32_t vertexOffset;
+        std::uint32_t indexOffset;
+    };
+
+    struct GeometryBuffers
+    {
+        vk::Buffer vertexBuffer = VK_NULL_HANDLE;
+        VmaAllocation vertexAllocation = VK_NULL_HANDLE;
+        vk::Buffer indexBuffer = VK_NULL_HANDLE;
+        VmaAllocation indexAllocation = VK_NULL_HANDLE;
+    };
+
+    NODISCARD GeometryBuffers createBuffers() const;
+    // frees ranges of removed meshes GPU is done with
+    void reclaimRetired();
+    const Mesh& getMesh(MeshId mesh) const;
+
+private:
+    GeometryBuffers m_buffers;
+
+    OffsetAllocator m_vertexAllocator;
+    OffsetAllocator m_indexAllocator;
+
+    // indexed by MeshId, ids of removed meshes are reused
+    std::vector<Mesh> m_meshes;
+    std::vector<MeshId> m_freeIds;
+    std::deque<RetiredMesh> m_retired;
+
+    std::uint64_t m_generation = 0;
+    std::uint64_t m_defragmentations = 0;
+};
+
+#endif //VULKANGEOMETRYARENA_H
@@ -0,0 +1,193 @@
+#include "VulkanGpuProfiler.h"
+
+#include <spdlog/spdlog.h>
+
+#include "VulkanContext.h"
+#include "VulkanDebugUtils.h"
+
+// ------------ Scope ------------
+
+VulkanGpuProfiler::Scope::Scope(VulkanGpuProfiler& profiler, vk::CommandBuffer commandBuffer, const char* name)
+    : m_profiler(profiler), m_commandBuffer(commandBuffer)
+{
+    m_profiler.beginScope(m_commandBuffer, name);
+}
+
+VulkanGpuProfiler::Scope::~Scope()
+{
+    m_profiler.endScope(m_commandBuffer);
+}
+
+// ------------ VulkanGpuProfiler ------------
+
+void VulkanGpuProfiler::init(std::uint32_t framesInFlight)
+{
+    const vk::PhysicalDevice physicalDevice = VulkanContext::GetPhysicalDevice();
+    const std::uint32_t graphicsFamily = VulkanContext::GetDevice().getQueueFamilyIndices().graphicsFamily.value();
+    const std::uint32_t validBits = physicalDevice.getQueueFamilyProperties()[graphicsFamily].timestampValidBits;
+
+    // cached command buffers would replay queries of the frame slot they were recorded for
+    m_enabled = validBits != 0 && !VulkanContext::GetConfig().cacheCommandBuffers;
+    if (!m_enabled)
+    {
+        spdlog::info("GPU profiler is disabled");
+        return;
+    }
+
+    m_timestampPeriod = physicalDevice.getProperties().limits.timestampPeriod;
+    m_timestampMask = validBits == 64 ? std::numeric_limits<std::uint64_t>::max() : (1ull << validBits) - 1;
+
+    const vk::Device device = VulkanContext::GetLogicalDevice();
+    const vk::DispatchLoaderDynamic& dispatch = VulkanContext::GetDispatch();
+
+    m_frames.resize(framesInFlight);
+    for (FrameQueries& frame : m_frames)
+    {
+        vk::QueryPoolCreateInfo queryPoolCreateInfo = {
+            .sType = vk::StructureType::eQueryPoolCreateInfo,
+            .pNext = nullptr,
+            .flags = vk::QueryPoolCreateFlags(),
+            .queryType = vk::QueryType::eTimestamp,
+            .queryCount = s_maxQueriesPerFrame,
+            .pipelineStatistics = vk::QueryPipelineStatisticFlags()
+        };
+
+        frame.queryPool = device.createQueryPool(queryPoolCreateInfo, nullptr, dispatch);
+        // queries must be reset before the first use, host reset needs no command buffer
+        device.resetQueryPool(frame.queryPool, 0, s_maxQueriesPerFrame, dispatch);
+    }
+}
+
+void VulkanGpuProfiler::destroy() noexcept
+{
+    const vk::Device device = VulkanContext::GetLogicalDevice();
+    const vk::DispatchLoaderDynamic& dispatch = VulkanContext::GetDispatch();
+    for (const FrameQueries& frame : m_frames)
+    {
+        device.destroyQueryPool(frame.queryPool, nullptr, dispatch);
+    }
+    m_frames.clear();
+    m_currentFrame = nullptr;
+    m_openScopes.clear();
+}
+
+bool VulkanGpuProfiler::isEnabled() const
+{
+    return m_enabled;
+}
+
+void VulkanGpuProfiler::beginFrame(std::uint32_t frameIndex)
+{
+    if (!m_enabled)
+        return;
+
+    ASSERT(m_openScopes.empty() && "Previous frame has unfinished GPU scopes!");
+
+    FrameQueries& frame = m_frames[frameIndex];
+    collectResults(frame);
+
+    if (frame.usedQueries > 0)
+    {
+        VulkanContext::GetLogicalDevice().resetQueryPool(frame.queryPool, 0, frame.usedQueries,
+                                                         VulkanContext::GetDispatch());
+    }
+    frame.usedQueries = 0;
+    frame.scopes.clear();
+
+    m_currentFrame = &frame;
+}
+
+void VulkanGpuProfiler::beginScope(vk::CommandBuffer commandBuffer, const char* name)
+{
+    const vk::DispatchLoaderDynamic& dispatch = VulkanContext::GetDispatch();
+    VulkanDebugUtils::BeginLabel(commandBuffer, name, dispatch);
+
+    if (!m_enabled || m_currentFrame == nullptr)
+        return;
+
+    // pool is full, scope is only labeled
+    if (m_currentFrame->usedQueries + 2 > s_maxQueriesPerFrame)
+    {
+        m_openScopes.push_back(std::numeric_limits<std::uint32_t>::max());
+        return;
+    }
+
+    const std::uint32_t beginQuery = m_currentFrame->usedQueries;
+    m_currentFrame->usedQueries += 2;
+
+    m_openScopes.push_back(static_cast<std::uint32_t>(m_currentFrame->scopes.size()));
+    m_currentFrame->scopes.push_back({
+        .name = name,
+        .depth = static_cast<std::uint32_t>(m_openScopes.size() - 1),
+        .beginQuery = beginQuery,
+        .endQuery = beginQuery + 1
+    });
+
+    commandBuffer.writeTimestamp2(vk::PipelineStageFlagBits2::eTopOfPipe, m_currentFrame->queryPool,
+                                  beginQuery, dispatch);
+}
+
+void VulkanGpuProfiler::endScope(vk::CommandBuffer commandBuffer)
+{
+    const vk::DispatchLoaderDynamic& dispatch = VulkanContext::GetDispatch();
+
+    if (m_enabled && m_currentFrame != nullptr)
+    {
+        ASSERT(!m_openScopes.empty() && "GPU scope ended without being begun!");
+        const std::uint32_t scopeIndex = m_openScopes.back();
+        m_openScopes.pop_back();
+
+        if (scopeIndex != std::numeric_limits<std::uint32_t>::max())
+        {
+            // written once everything recorded before it has finished
+            commandBuffer.writeTimestamp2(vk::PipelineStageFlagBits2::eBottomOfPipe, m_currentFrame->queryPool,
+                                          m_currentFrame->scopes[scopeIndex].endQuery, dispatch);
+        }
+    }
+
+    VulkanDebugUtils::EndLabel(commandBuffer, dispatch);
+}
+
+std::vector<VulkanGpuProfiler::ScopeTiming> VulkanGpuProfiler::getLastFrameTimings() const
+{
+    std::lock_guard lock(m_resultsMutex);
+    return m_lastFrameTimings;
+}
+
+void VulkanGpuProfiler::collectResults(FrameQueries& frame)
+{
+    if (frame.usedQueries == 0)
+        return;
+
+    // value followed by availability for every query
+    std::vector<std::uint64_t> results(frame.usedQueries * 2);
+
+    // pointer overload doesn't throw on eNotReady, e.g. when recorded frame was never submitted
+    const vk::Result result = VulkanContext::GetLogicalDevice().getQueryPoolResults(
+        frame.queryPool, 0, frame.usedQueries,
+        results.size() * sizeof(std::uint64_t), results.data(), 2 * sizeof(std::uint64_t),
+        vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWithAvailability,
+        VulkanContext::GetDispatch());
+
+    ASSERT((result == vk::Result::eSuccess || result == vk::Result::eNotReady) &&
+           "Failed to read GPU timestamps!");
+
+    std::vector<ScopeTiming> timings;
+    timings.reserve(frame.scopes.size());
+    for (const ScopeQueries& scope : frame.scopes)
+    {
+        const bool available = results[scope.beginQuery * 2 + 1] != 0 && results[scope.endQuery * 2 + 1] != 0;
+        if (!available)
+            continue;
+
+        const std::uint64_t ticks = (results[scope.endQuery * 2] - results[scope.beginQuery * 2]) & m_timestampMask;
+        timings.push_back({
+            .name = scope.name,
+            .depth = scope.depth,
+            .durationMs = static_cast<double>(ticks) * m_timestampPeriod / 1'000'000.0
+        });
+    }
+
+    std::lock_guard lock(m_resultsMutex);
+    m_lastFrameTimings = std::move(timings);
+}
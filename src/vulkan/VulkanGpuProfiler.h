@@ -0,0 +1,94 @@
+#ifndef VULKANGPUPROFILER_H
+#define VULKANGPUPROFILER_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "utility/NonCopyable.h"
+#include "utility/NonMovable.h"
+#include "utility/Utility.h"
+
+// Measures GPU time of named scopes with timestamp queries. Every frame in flight owns a query pool,
+// its results are read once the frame slot comes around again, so reading never stalls.
+// Scopes are also emitted as VK_EXT_debug_utils labels for capture tools.
+class VulkanGpuProfiler : NonCopyable, NonMovable
+{
+public:
+    struct ScopeTiming
+    {
+        std::string name;
+        // nesting level, zero for outermost scopes
+        std::uint32_t depth;
+        double durationMs;
+    };
+
+    // records begin and end of a scope in constructor and destructor
+    class Scope : NonCopyable, NonMovable
+    {
+    public:
+        Scope(VulkanGpuProfiler& profiler, vk::CommandBuffer commandBuffer, const char* name);
+        ~Scope();
+
+    private:
+        VulkanGpuProfiler& m_profiler;
+        vk::CommandBuffer m_commandBuffer;
+    };
+
+public:
+    VulkanGpuProfiler() = default;
+
+    void init(std::uint32_t framesInFlight);
+    void destroy() noexcept;
+
+    NODISCARD bool isEnabled() const;
+
+    // GPU must be done with the frame slot. Collects its previous results and resets its queries
+    void beginFrame(std::uint32_t frameIndex);
+
+    // scopes must be properly nested and recorded into primary command buffers of the current frame
+    void beginScope(vk::CommandBuffer commandBuffer, const char* name);
+    void endScope(vk::CommandBuffer commandBuffer);
+
+    // timings of the most recent frame GPU has finished, in order scopes were begun
+    NODISCARD std::vector<ScopeTiming> getLastFrameTimings() const;
+
+private:
+    struct ScopeQueries
+    {
+        std::string name;
+        std::uint32_t depth;
+        std::uint32_t beginQuery;
+        std::uint32_t endQuery;
+    };
+
+    struct FrameQueries
+    {
+        vk::QueryPool queryPool = VK_NULL_HANDLE;
+        std::uint32_t usedQueries = 0;
+        std::vector<ScopeQueries> scopes;
+    };
+
+    void collectResults(FrameQueries& frame);
+
+private:
+    static constexpr std::uint32_t s_maxQueriesPerFrame = 256;
+
+    bool m_enabled = false;
+    // nanoseconds per timestamp tick
+    double m_timestampPeriod = 0.0;
+    // timestamps are only this many bits wide on graphics queue
+    std::uint64_t m_timestampMask = 0;
+
+    std::vector<FrameQueries> m_frames;
+    FrameQueries* m_currentFrame = nullptr;
+    std::vector<std::uint32_t> m_openScopes;
+
+    mutable std::mutex m_resultsMutex;
+    std::vector<ScopeTiming> m_lastFrameTimings;
+};
+
+#endif //VULKANGPUPROFILER_H
@@ -0,0 +1,163 @@
+#include "VulkanGraphicsPipelineDesc.h"
+
+#include <bit>
+
+#include "utility/Hash.h"
+
+namespace
+{
+    void HashBlendAttachment(Hasher& hasher, const vk::PipelineColorBlendAttachmentState& attachment)
+    {
+        hasher.add(attachment.blendEnable);
+        hasher.add(attachment.srcColorBlendFactor);
+        hasher.add(attachment.dstColorBlendFactor);
+        hasher.add(attachment.colorBlendOp);
+        hasher.add(attachment.srcAlphaBlendFactor);
+        hasher.add(attachment.dstAlphaBlendFactor);
+        hasher.add(attachment.alphaBlendOp);
+        hasher.add(static_cast<VkColorComponentFlags>(attachment.colorWriteMask));
+    }
+
+    void HashSpecialization(Hasher& hasher, const VulkanSpecialization& specialization)
+    {
+        hasher.add(specialization.entries.size());
+        for (const vk::SpecializationMapEntry& entry : specialization.entries)
+        {
+            hasher.add(entry.constantID);
+            hasher.add(entry.offset);
+            hasher.add(entry.size);
+        }
+
+        hasher.add(specialization.data.size());
+        hasher.addBytes(specialization.data.data(), specialization.data.size());
+    }
+}
+
+std::uint64_t VulkanDescriptorSetLayoutDesc::hash() const
+{
+    Hasher hasher;
+
+    hasher.add(bindings.size());
+    for (const vk::DescriptorSetLayoutBinding& binding : bindings)
+    {
+        hasher.add(binding.binding);
+        hasher.add(binding.descriptorType);
+        hasher.add(binding.descriptorCount);
+        hasher.add(static_cast<VkShaderStageFlags>(binding.stageFlags));
+    }
+
+    return hasher.get();
+}
+
+std::uint64_t VulkanPipelineLayoutDesc::hash() const
+{
+    Hasher hasher;
+
+    hasher.add(setLayouts.size());
+    for (const vk::DescriptorSetLayout setLayout : setLayouts)
+    {
+        hasher.add(std::bit_cast<std::uint64_t>(static_cast<VkDescriptorSetLayout>(setLayout)));
+    }
+
+    hasher.add(pushConstantRanges.size());
+    for (const vk::PushConstantRange& range : pushConstantRanges)
+    {
+        hasher.add(static_cast<VkShaderStageFlags>(range.stageFlags));
+        hasher.add(range.offset);
+        hasher.add(range.size);
+    }
+
+    return hasher.get();
+}
+
+std::uint64_t VulkanGraphicsPipelineDesc::hash() const
+{
+    Hasher hasher;
+
+    hasher.add(vertexShader);
+    hasher.add(fragmentShader);
+    HashSpecialization(hasher, vertexSpecialization);
+    HashSpecialization(hasher, fragmentSpecialization);
+
+    // counts are hashed too, otherwise moving an element between neighbouring arrays would collide
+    hasher.add(vertexBindings.size());
+    for (const vk::VertexInputBindingDescription& binding : vertexBindings)
+    {
+        hasher.add(binding.binding);
+        hasher.add(binding.stride);
+        hasher.add(binding.inputRate);
+    }
+
+    hasher.add(vertexAttributes.size());
+    for (const vk::VertexInputAttributeDescription& attribute : vertexAttributes)
+    {
+        hasher.add(attribute.location);
+        hasher.add(attribute.binding);
+        hasher.add(attribute.format);
+        hasher.add(attribute.offset);
+    }
+
+    hasher.add(topology);
+    hasher.add(polygonMode);
+    hasher.add(static_cast<VkCullModeFlags>(cullMode));
+    hasher.add(frontFace);
+    hasher.add(rasterizationSamples);
+
+    hasher.add(depthTestEnable);
+    hasher.add(depthWriteEnable);
+    hasher.add(depthCompareOp);
+
+    hasher.add(colorFormats.size());
+    for (const vk::Format format : colorFormats)
+    {
+        hasher.add(format);
+    }
+
+    hasher.add(colorBlendAttachments.size());
+    for (const vk::PipelineColorBlendAttachmentState& attachment : colorBlendAttachments)
+    {
+        HashBlendAttachment(hasher, attachment);
+    }
+
+    hasher.add(depthFormat);
+
+    hasher.add(dynamicStates.size());
+    for (const vk::DynamicState state : dynamicStates)
+    {
+        hasher.add(state);
+    }
+
+    hasher.add(layout.hash());
+
+    return hasher.get();
+}
+
+vk::PipelineColorBlendAttachmentState VulkanGraphicsPipelineDesc::OpaqueAttachment()
+{
+    return {
+        .blendEnable = VK_FALSE,
+        .srcColorBlendFactor = vk::BlendFactor::eOne,
+        .dstColorBlendFactor = vk::BlendFactor::eZero,
+        .colorBlendOp = vk::BlendOp::eAdd,
+        .srcAlphaBlendFactor = vk::BlendFactor::eOne,
+        .dstAlphaBlendFactor = vk::BlendFactor::eZero,
+        .alphaBlendOp = vk::BlendOp::eAdd,
+        .colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+                          vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA
+    };
+}
+
+vk::PipelineColorBlendAttachmentState VulkanGraphicsPipelineDesc::AlphaBlendAttachment()
+{
+    return {
+        .blendEnable = VK_TRUE,
+        .srcColorBlendFactor = vk::BlendFactor::eSrcAlpha,
+        .dstColorBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha,
+        .colorBlendOp = vk::BlendOp::eAdd,
+        .srcAlphaBlendFactor = vk::BlendFactor::eOne,
+        .dstAlphaBlendFactor = vk::BlendFactor::eZero,
+        .alphaBlendOp = vk::BlendOp::eAdd,
+        .colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+                          vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA
+    };
+}
@@ -0,0 +1,77 @@
+#ifndef VULKANGRAPHICSPIPELINEDESC_H
+#define VULKANGRAPHICSPIPELINEDESC_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "VulkanSpecialization.h"
+#include "utility/Utility.h"
+
+struct VulkanDescriptorSetLayoutDesc
+{
+    // sorted by binding
+    std::vector<vk::DescriptorSetLayoutBinding> bindings;
+
+    bool operator==(const VulkanDescriptorSetLayoutDesc&) const = default;
+
+    NODISCARD std::uint64_t hash() const;
+};
+
+struct VulkanPipelineLayoutDesc
+{
+    // indexed by set number, identical set layouts are the same handle
+    std::vector<vk::DescriptorSetLayout> setLayouts;
+    std::vector<vk::PushConstantRange> pushConstantRanges;
+
+    bool operator==(const VulkanPipelineLayoutDesc&) const = default;
+
+    NODISCARD std::uint64_t hash() const;
+};
+
+// Complete state of a graphics pipeline for dynamic rendering, everything is held by value
+// so descriptions can be copied to compiler threads and compared
+struct VulkanGraphicsPipelineDesc
+{
+    // names in shader archive
+    std::string vertexShader;
+    std::string fragmentShader;
+
+    // part of the key, so every variant is a separate pipeline the driver can constant-fold
+    VulkanSpecialization vertexSpecialization;
+    VulkanSpecialization fragmentSpecialization;
+
+    std::vector<vk::VertexInputBindingDescription> vertexBindings;
+    std::vector<vk::VertexInputAttributeDescription> vertexAttributes;
+    vk::PrimitiveTopology topology = vk::PrimitiveTopology::eTriangleList;
+
+    vk::PolygonMode polygonMode = vk::PolygonMode::eFill;
+    vk::CullModeFlags cullMode = vk::CullModeFlagBits::eBack;
+    vk::FrontFace frontFace = vk::FrontFace::eClockwise;
+    vk::SampleCountFlagBits rasterizationSamples = vk::SampleCountFlagBits::e1;
+
+    bool depthTestEnable = false;
+    bool depthWriteEnable = false;
+    vk::CompareOp depthCompareOp = vk::CompareOp::eLess;
+
+    // blend state for each of the color attachments
+    std::vector<vk::Format> colorFormats;
+    std::vector<vk::PipelineColorBlendAttachmentState> colorBlendAttachments;
+    vk::Format depthFormat = vk::Format::eUndefined;
+
+    std::vector<vk::DynamicState> dynamicStates = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+
+    VulkanPipelineLayoutDesc layout;
+
+    bool operator==(const VulkanGraphicsPipelineDesc&) const = default;
+
+    // same across runs, except for the descriptor set layout handles in layout
+    NODISCARD std::uint64_t hash() const;
+
+    NODISCARD static vk::PipelineColorBlendAttachmentState OpaqueAttachment();
+    NODISCARD static vk::PipelineColorBlendAttachmentState AlphaBlendAttachment();
+};
+
+#endif //VULKANGRAPHICSPIPELINEDESC_H
@@ -0,0 +1,122 @@
+#include "VulkanOffscreenTarget.h"
+
+#include "VulkanContext.h"
+
+void VulkanOffscreenTarget::init(vk::Extent2D extent, vk::Format format, std::uint32_t imageCount)
+{
+    m_extent = extent;
+    m_format = format;
+    createImages(imageCount);
+}
+
+void VulkanOffscreenTarget::destroy() noexcept
+{
+    destroyImages();
+}
+
+void VulkanOffscreenTarget::setImageCount(std::uint32_t imageCount)
+{
+    if (imageCount == m_images.size())
+        return;
+
+    destroyImages();
+    createImages(imageCount);
+}
+
+vk::Extent2D VulkanOffscreenTarget::getExtent() const
+{
+    return m_extent;
+}
+
+vk::Format VulkanOffscreenTarget::getFormat() const
+{
+    return m_format;
+}
+
+vk::ImageView VulkanOffscreenTarget::getImageView(std::uint32_t index) const
+{
+    return m_images[index].imageView;
+}
+
+vk::Image VulkanOffscreenTarget::getImage(std::uint32_t index) const
+{
+    return m_images[index].image;
+}
+
+std::uint32_t VulkanOffscreenTarget::getImageCount() const
+{
+    return static_cast<std::uint32_t>(m_images.size());
+}
+
+vk::ImageLayout VulkanOffscreenTarget::getFinalLayout() const
+{
+    // ready to be read back or blitted somewhere else
+    return vk::ImageLayout::eTransferSrcOptimal;
+}
+
+void VulkanOffscreenTarget::createImages(std::uint32_t imageCount)
+{
+    m_images.resize(imageCount);
+    for (Image& image : m_images)
+    {
+        vk::ImageCreateInfo imageCreateInfo = {
+            .sType = vk::StructureType::eImageCreateInfo,
+            .pNext = nullptr,
+            .flags = vk::ImageCreateFlags(),
+            .imageType = vk::ImageType::e2D,
+            .format = m_format,
+            .extent = {m_extent.width, m_extent.height, 1},
+            .mipLevels = 1,
+            .arrayLayers = 1,
+            .samples = vk::SampleCountFlagBits::e1,
+            .tiling = vk::ImageTiling::eOptimal,
+            .usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc,
+            .sharingMode = vk::SharingMode::eExclusive,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices = nullptr,
+            .initialLayout = vk::ImageLayout::eUndefined
+        };
+
+        // render targets are better off in their own memory blocks
+        VmaAllocationCreateInfo allocationCreateInfo = {};
+        allocationCreateInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+        allocationCreateInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+
+        VkResult result = vmaCreateImage(VulkanContext::GetDevice().getVmaAllocator(),
+                                         (VkImageCreateInfo *) &imageCreateInfo,
+                                         &allocationCreateInfo,
+                                         (VkImage *) &image.image,
+                                         &image.allocation,
+                                         nullptr);
+
+        if (result != VK_SUCCESS)
+            throw std::runtime_error("Failed to create offscreen color image!");
+
+        const vk::ImageViewCreateInfo imageViewCreateInfo = {
+            .sType = vk::StructureType::eImageViewCreateInfo,
+            .pNext = nullptr,
+            .flags = {},
+            .image = image.image,
+            .viewType = vk::ImageViewType::e2D,
+            .format = m_format,
+            .components = vk::ComponentMapping(),
+            .subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)
+        };
+
+        image.imageView = VulkanContext::GetLogicalDevice().createImageView(
+            imageViewCreateInfo, nullptr, VulkanContext::GetDispatch());
+    }
+
+    spdlog::info("Offscreen target: {} images {}x{}, format {}",
+        imageCount, m_extent.width, m_extent.height, vk::to_string(m_format));
+}
+
+void VulkanOffscreenTarget::destroyImages() noexcept
+{
+    for (const Image& image : m_images)
+    {
+        VulkanContext::GetLogicalDevice().destroyImageView(image.imageView, nullptr, VulkanContext::GetDispatch());
+        vmaDestroyImage(VulkanContext::GetDevice().getVmaAllocator(), image.image, image.allocation);
+    }
+    m_images.clear();
+}
@@ -0,0 +1,47 @@
+#ifndef VULKANOFFSCREENTARGET_H
+#define VULKANOFFSCREENTARGET_H
+
+#include <vector>
+
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan.hpp>
+
+#include "VulkanRenderTarget.h"
+#include "utility/Utility.h"
+
+// Color images allocated with VMA, used instead of swapchain when there is no surface to present to
+class VulkanOffscreenTarget : public VulkanRenderTarget
+{
+public:
+    void init(vk::Extent2D extent, vk::Format format, std::uint32_t imageCount);
+    void destroy() noexcept;
+
+    // images must not be used by GPU anymore
+    void setImageCount(std::uint32_t imageCount);
+
+    NODISCARD vk::Extent2D getExtent() const override;
+    NODISCARD vk::Format getFormat() const override;
+    NODISCARD vk::ImageView getImageView(std::uint32_t index) const override;
+    NODISCARD vk::Image getImage(std::uint32_t index) const override;
+    NODISCARD std::uint32_t getImageCount() const override;
+    NODISCARD vk::ImageLayout getFinalLayout() const override;
+
+private:
+    void createImages(std::uint32_t imageCount);
+    void destroyImages() noexcept;
+
+private:
+    struct Image
+    {
+        vk::Image image = VK_NULL_HANDLE;
+        vk::ImageView imageView = VK_NULL_HANDLE;
+        VmaAllocation allocation = VK_NULL_HANDLE;
+    };
+
+    std::vector<Image> m_images;
+
+    vk::Extent2D m_extent;
+    vk::Format m_format = vk::Format::eUndefined;
+};
+
+#endif //VULKANOFFSCREENTARGET_H
@@ -0,0 +1,138 @@
+#include "VulkanParallelRecorder.h"
+
+#include <spdlog/spdlog.h>
+
+#include "VulkanContext.h"
+#include "utility/CpuProfiler.h"
+
+void VulkanParallelRecorder::init(std::uint32_t threadCount, std::uint32_t framesInFlight)
+{
+    if (threadCount == 0)
+        return;
+
+    const vk::Device device = VulkanContext::GetLogicalDevice();
+    const vk::DispatchLoaderDynamic& dispatch = VulkanContext::GetDispatch();
+    const std::uint32_t graphicsFamily = VulkanContext::GetDevice().getQueueFamilyIndices().graphicsFamily.value();
+
+    m_workers.resize(threadCount);
+    for (Worker& worker : m_workers)
+    {
+        for (std::uint32_t frame = 0; frame < framesInFlight; ++frame)
+        {
+            vk::CommandPoolCreateInfo commandPoolCreateInfo = {
+                .sType = vk::StructureType::eCommandPoolCreateInfo,
+                .pNext = nullptr,
+                .flags = vk::CommandPoolCreateFlagBits::eTransient,
+                .queueFamilyIndex = graphicsFamily
+            };
+            vk::CommandPool commandPool = device.createCommandPool(commandPoolCreateInfo, nullptr, dispatch);
+
+            vk::CommandBufferAllocateInfo commandBufferAllocateInfo = {
+                .sType = vk::StructureType::eCommandBufferAllocateInfo,
+                .pNext = nullptr,
+                .commandPool = commandPool,
+                .level = vk::CommandBufferLevel::eSecondary,
+                .commandBufferCount = 1
+            };
+
+            worker.commandPools.push_back(commandPool);
+            worker.commandBuffers.push_back(device.allocateCommandBuffers(commandBufferAllocateInfo, dispatch).front());
+        }
+    }
+
+    m_threadPool = std::make_unique<ThreadPool>(threadCount);
+    spdlog::info("Recording command buffers on {} worker threads", threadCount);
+}
+
+void VulkanParallelRecorder::destroy() noexcept
+{
+    m_threadPool.reset();
+
+    const vk::Device device = VulkanContext::GetLogicalDevice();
+    const vk::DispatchLoaderDynamic& dispatch = VulkanContext::GetDispatch();
+    for (const Worker& worker : m_workers)
+    {
+        for (const vk::CommandPool commandPool : worker.commandPools)
+        {
+            device.destroyCommandPool(commandPool, nullptr, dispatch);
+        }
+    }
+    m_workers.clear();
+}
+
+bool VulkanParallelRecorder::isEnabled() const
+{
+    return !m_workers.empty();
+}
+
+std::vector<vk::CommandBuffer> VulkanParallelRecorder::record(std::uint32_t frameIndex,
+                                                              const vk::CommandBufferInheritanceRenderingInfo& renderingInfo,
+                                                              std::uint32_t itemCount,
+                                                              const RecordRangeFunction& recordRange)
+{
+    ASSERT(isEnabled() && "Parallel recording is disabled!")
+
+    const std::uint32_t maxWorkers = static_cast<std::uint32_t>(m_workers.size());
+    const std::uint32_t workerCount = std::clamp((itemCount + s_minItemsPerWorker - 1) / s_minItemsPerWorker, 1u, maxWorkers);
+    const std::uint32_t itemsPerWorker = (itemCount + workerCount - 1) / workerCount;
+
+    std::vector<std::future<void>> futures;
+    std::vector<vk::CommandBuffer> commandBuffers;
+    futures.reserve(workerCount);
+    commandBuffers.reserve(workerCount);
+
+    for (std::uint32_t i = 0; i < workerCount; ++i)
+    {
+        const std::uint32_t first = std::min(i * itemsPerWorker, itemCount);
+        const std::uint32_t last = std::min(first + itemsPerWorker, itemCount);
+
+        // pool of worker i is only ever touched by the task recording chunk i,
+        // so no two threads use the same pool at the same time
+        const vk::CommandPool commandPool = m_workers[i].commandPools[frameIndex];
+        const vk::CommandBuffer commandBuffer = m_workers[i].commandBuffers[frameIndex];
+        commandBuffers.push_back(commandBuffer);
+
+        futures.push_back(m_threadPool->submit([=, &renderingInfo, &recordRange]() {
+            CPU_PROFILE_ZONE("record secondary");
+
+            const vk::DispatchLoaderDynamic& dispatch = VulkanContext::GetDispatch();
+            VulkanContext::GetLogicalDevice().resetCommandPool(commandPool, vk::CommandPoolResetFlags(), dispatch);
+
+            const vk::CommandBufferInheritanceInfo inheritanceInfo = {
+                .sType = vk::StructureType::eCommandBufferInheritanceInfo,
+                .pNext = &renderingInfo,
+                .renderPass = VK_NULL_HANDLE, // dynamic rendering
+                .subpass = 0,
+                .framebuffer = VK_NULL_HANDLE,
+                .occlusionQueryEnable = VK_FALSE,
+                .queryFlags = vk::QueryControlFlags(),
+                .pipelineStatistics = vk::QueryPipelineStatisticFlags()
+            };
+
+            const vk::CommandBufferBeginInfo beginInfo = {
+                .sType = vk::StructureType::eCommandBufferBeginInfo,
+                .pNext = nullptr,
+                .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit |
+                         vk::CommandBufferUsageFlagBits::eRenderPassContinue,
+                .pInheritanceInfo = &inheritanceInfo
+            };
+
+            commandBuffer.begin(beginInfo, dispatch);
+            recordRange(commandBuffer, first, last);
+            commandBuffer.end(dispatch);
+        }));
+    }
+
+    // tasks reference locals of this function, so all of them must finish before anything is rethrown
+    for (const std::future<void>& future : futures)
+    {
+        future.wait();
+    }
+
+    for (std::future<void>& future : futures)
+    {
+        future.get();
+    }
+
+    return commandBuffers;
+}
@@ -0,0 +1,53 @@
+#ifndef VULKANPARALLELRECORDER_H
+#define VULKANPARALLELRECORDER_H
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "utility/NonCopyable.h"
+#include "utility/NonMovable.h"
+#include "utility/ThreadPool.h"
+#include "utility/Utility.h"
+
+// Splits recording of a draw list between worker threads. Every worker owns a command pool
+// per frame in flight and records a secondary command buffer that inherits dynamic rendering
+// state, primary command buffer then executes them in order.
+class VulkanParallelRecorder : NonCopyable, NonMovable
+{
+public:
+    // records items [first, last) into given secondary command buffer
+    using RecordRangeFunction = std::function<void(vk::CommandBuffer commandBuffer, std::uint32_t first, std::uint32_t last)>;
+
+public:
+    VulkanParallelRecorder() = default;
+
+    void init(std::uint32_t threadCount, std::uint32_t framesInFlight);
+    void destroy() noexcept;
+
+    NODISCARD bool isEnabled() const;
+
+    // frame slot must not be in use by GPU anymore
+    NODISCARD std::vector<vk::CommandBuffer> record(std::uint32_t frameIndex,
+                                                    const vk::CommandBufferInheritanceRenderingInfo& renderingInfo,
+                                                    std::uint32_t itemCount,
+                                                    const RecordRangeFunction& recordRange);
+
+private:
+    struct Worker
+    {
+        // indexed by frame in flight
+        std::vector<vk::CommandPool> commandPools;
+        std::vector<vk::CommandBuffer> commandBuffers;
+    };
+
+    // too small chunks cost more in synchronization than they save
+    static constexpr std::uint32_t s_minItemsPerWorker = 256;
+
+    std::unique_ptr<ThreadPool> m_threadPool;
+    std::vector<Worker> m_workers;
+};
+
+#endif //VULKANPARALLELRECORDER_H
@@ -0,0 +1,230 @@
+#include "VulkanPipelineCache.h"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include <spdlog/spdlog.h>
+
+#include "VulkanContext.h"
+
+void VulkanPipelineCache::init(std::string filename)
+{
+    m_filename = std::move(filename);
+
+    std::vector<char> data = loadFile();
+    if (!data.empty() && !IsHeaderValid(data))
+    {
+        spdlog::warn("Pipeline cache {} was created by another device or driver, ignoring it", m_filename);
+        data.clear();
+    }
+
+    vk::PipelineCacheCreateInfo createInfo = {
+        .sType = vk::StructureType::ePipelineCacheCreateInfo,
+        .pNext = nullptr,
+        .flags = vk::PipelineCacheCreateFlags(),
+        .initialDataSize = data.size(),
+        .pInitialData = data.data()
+    };
+
+    m_cache = VulkanContext::GetLogicalDevice().createPipelineCache(createInfo, nullptr, VulkanContext::GetDispatch());
+    m_dirty = false;
+
+    if (!data.empty())
+    {
+        spdlog::info("Loaded pipeline cache {} ({} bytes)", m_filename, data.size());
+    }
+}
+
+void VulkanPipelineCache::destroy() noexcept
+{
+    if (m_dirty)
+    {
+        save();
+    }
+
+    const Stats stats = getStats();
+    spdlog::info("Pipeline cache: {} hits, {} misses", stats.hits, stats.misses);
+
+    VulkanContext::GetLogicalDevice().destroyPipelineCache(m_cache, nullptr, VulkanContext::GetDispatch());
+    m_cache = VK_NULL_HANDLE;
+}
+
+vk::PipelineCache VulkanPipelineCache::getHandle() const
+{
+    return m_cache;
+}
+
+vk::PipelineCache VulkanPipelineCache::createLocalCache() const
+{
+    const vk::Device device = VulkanContext::GetLogicalDevice();
+    const vk::DispatchLoaderDynamic& dispatch = VulkanContext::GetDispatch();
+
+    // seeded with the main cache, otherwise pipelines loaded from disk would miss on workers
+    const std::vector<std::uint8_t> data = device.getPipelineCacheData(m_cache, dispatch);
+
+    // cache is used by one thread only, so driver may skip locking when allowed to
+    const vk::PipelineCacheCreateFlags flags = VulkanContext::GetDevice().isPipelineCacheControlEnabled()
+        ? vk::PipelineCacheCreateFlags(vk::PipelineCacheCreateFlagBits::eExternallySynchronized)
+        : vk::PipelineCacheCreateFlags();
+
+    vk::PipelineCacheCreateInfo createInfo = {
+        .sType = vk::StructureType::ePipelineCacheCreateInfo,
+        .pNext = nullptr,
+        .flags = flags,
+        .initialDataSize = data.size(),
+        .pInitialData = data.data()
+    };
+
+    return device.createPipelineCache(createInfo, nullptr, dispatch);
+}
+
+void VulkanPipelineCache::merge(const std::vector<vk::PipelineCache>& caches)
+{
+    if (caches.empty())
+        return;
+
+    const vk::Device device = VulkanContext::GetLogicalDevice();
+    const vk::DispatchLoaderDynamic& dispatch = VulkanContext::GetDispatch();
+    device.mergePipelineCaches(m_cache, caches, dispatch);
+    for (const vk::PipelineCache cache : caches)
+    {
+        device.destroyPipelineCache(cache, nullptr, dispatch);
+    }
+    m_dirty = true;
+}
+
+bool VulkanPipelineCache::save()
+{
+    if (m_filename.empty())
+        return false;
+
+    const std::vector<std::uint8_t> data = VulkanContext::GetLogicalDevice().getPipelineCacheData(
+        m_cache, VulkanContext::GetDispatch());
+
+    // rename is atomic, so readers see either the old file or the complete new one
+    const std::string temporaryFilename = m_filename + ".tmp";
+    {
+        std::ofstream file(temporaryFilename, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+        file.close();
+
+        if (file.fail())
+        {
+            spdlog::error("Failed to write pipeline cache {}", temporaryFilename);
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryFilename, m_filename, error);
+    if (error)
+    {
+        spdlog::error("Failed to replace pipeline cache {}: {}", m_filename, error.message());
+        return false;
+    }
+
+    m_dirty = false;
+    spdlog::info("Saved pipeline cache {} ({} bytes)", m_filename, data.size());
+    return true;
+}
+
+vk::Pipeline VulkanPipelineCache::createGraphicsPipeline(const vk::GraphicsPipelineCreateInfo& createInfo,
+                                                         const char* name, vk::PipelineCache cache)
+{
+    const std::uint32_t stageCount = createInfo.stageCount;
+    std::vector<vk::PipelineCreationFeedback> stageFeedbacks(stageCount);
+    vk::PipelineCreationFeedback pipelineFeedback;
+
+    const vk::PipelineCreationFeedbackCreateInfo feedbackCreateInfo = {
+        .sType = vk::StructureType::ePipelineCreationFeedbackCreateInfo,
+        .pNext = createInfo.pNext,
+        .pPipelineCreationFeedback = &pipelineFeedback,
+        .pipelineStageCreationFeedbackCount = stageCount,
+        .pPipelineStageCreationFeedbacks = stageFeedbacks.data()
+    };
+
+    vk::GraphicsPipelineCreateInfo feedbackPipelineCreateInfo = createInfo;
+    feedbackPipelineCreateInfo.pNext = &feedbackCreateInfo;
+
+    const auto startTime = std::chrono::steady_clock::now();
+    const vk::ResultValue<vk::Pipeline> result = VulkanContext::GetLogicalDevice().createGraphicsPipeline(
+        cache ? cache : m_cache, feedbackPipelineCreateInfo, nullptr, VulkanContext::GetDispatch());
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - startTime;
+
+    // feedback is optional for implementations, valid bit tells whether it was written at all
+    if (pipelineFeedback.flags & vk::PipelineCreationFeedbackFlagBits::eValid)
+    {
+        const bool hit = static_cast<bool>(
+            pipelineFeedback.flags & vk::PipelineCreationFeedbackFlagBits::eApplicationPipelineCacheHit);
+
+        (hit ? m_hits : m_misses)++;
+        if (!hit)
+        {
+            m_dirty = true;
+        }
+
+        spdlog::debug("Pipeline {}: cache {}, {:.3f} ms (driver reports {:.3f} ms)", name, hit ? "hit" : "miss",
+                      elapsed.count(), static_cast<double>(pipelineFeedback.duration) / 1'000'000.0);
+    }
+    else
+    {
+        // can't tell, assume the cache has grown
+        m_misses++;
+        m_dirty = true;
+        spdlog::debug("Pipeline {}: created in {:.3f} ms", name, elapsed.count());
+    }
+
+    return result.value;
+}
+
+VulkanPipelineCache::Stats VulkanPipelineCache::getStats() const
+{
+    return {
+        .hits = m_hits.load(),
+        .misses = m_misses.load()
+    };
+}
+
+std::vector<char> VulkanPipelineCache::loadFile() const
+{
+    if (m_filename.empty())
+        return {};
+
+    std::ifstream file(m_filename, std::ios::ate | std::ios::binary);
+    if (!file.is_open())
+        return {};
+
+    const std::streamsize size = file.tellg();
+    std::vector<char> data(size);
+
+    file.seekg(0);
+    file.read(data.data(), size);
+    if (file.fail())
+    {
+        spdlog::warn("Failed to read pipeline cache {}", m_filename);
+        return {};
+    }
+
+    return data;
+}
+
+bool VulkanPipelineCache::IsHeaderValid(const std::vector<char>& data)
+{
+    VkPipelineCacheHeaderVersionOne header;
+    if (data.size() < sizeof(header))
+        return false;
+
+    std::memcpy(&header, data.data(), sizeof(header));
+
+    const vk::PhysicalDeviceProperties properties = VulkanContext::GetPhysicalDevice().getProperties();
+
+    // drivers are supposed to reject foreign data themselves, but not all of them do it gracefully
+    return header.headerSize >= sizeof(header) &&
+           header.headerSize <= data.size() &&
+           header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           header.vendorID == properties.vendorID &&
+           header.deviceID == properties.deviceID &&
+           std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID.data(), VK_UUID_SIZE) == 0;
+}
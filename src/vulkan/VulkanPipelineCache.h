@@ -0,0 +1,67 @@
+#ifndef VULKANPIPELINECACHE_H
+#define VULKANPIPELINECACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "utility/NonCopyable.h"
+#include "utility/NonMovable.h"
+#include "utility/Utility.h"
+
+// vk::PipelineCache persisted between launches. File is only accepted if its header matches
+// the current device and driver, otherwise pipelines are compiled from scratch and the file
+// is replaced on save. Saving writes a temporary file and renames it, so a crash never leaves
+// a truncated cache behind.
+class VulkanPipelineCache : NonCopyable, NonMovable
+{
+public:
+    struct Stats
+    {
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+    };
+
+public:
+    VulkanPipelineCache() = default;
+
+    // empty filename keeps the cache in memory only
+    void init(std::string filename);
+    // saves the cache if anything was added to it
+    void destroy() noexcept;
+
+    // internally synchronized, may be used from any thread
+    NODISCARD vk::PipelineCache getHandle() const;
+
+    // copy of the main cache for a single worker thread, hand it back with merge(). Created without
+    // internal locking where pipelineCreationCacheControl is supported
+    NODISCARD vk::PipelineCache createLocalCache() const;
+    // merges caches into the main one and destroys them
+    void merge(const std::vector<vk::PipelineCache>& caches);
+
+    bool save();
+
+    // creates pipeline through given cache, or the main one if none is given, and reports
+    // whether driver found it in the cache
+    NODISCARD vk::Pipeline createGraphicsPipeline(const vk::GraphicsPipelineCreateInfo& createInfo, const char* name,
+                                                  vk::PipelineCache cache = VK_NULL_HANDLE);
+
+    NODISCARD Stats getStats() const;
+
+private:
+    NODISCARD std::vector<char> loadFile() const;
+    NODISCARD static bool IsHeaderValid(const std::vector<char>& data);
+
+private:
+    std::string m_filename;
+    vk::PipelineCache m_cache = VK_NULL_HANDLE;
+
+    std::atomic<std::uint64_t> m_hits = 0;
+    std::atomic<std::uint64_t> m_misses = 0;
+    std::atomic<bool> m_dirty = false;
+};
+
+#endif //VULKANPIPELINECACHE_H
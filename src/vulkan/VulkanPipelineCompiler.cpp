@@ -0,0 +1,141 @@
+#include "VulkanPipelineCompiler.h"
+
+#include <spdlog/spdlog.h>
+
+#include "VulkanContext.h"
+#include "utility/CpuProfiler.h"
+
+// ------------ Handle ------------
+
+VulkanPipelineCompiler::Handle::Handle(std::shared_ptr<State> state)
+    : m_state(std::move(state))
+{
+}
+
+VulkanPipelineCompiler::Status VulkanPipelineCompiler::Handle::getStatus() const
+{
+    ASSERT(m_state != nullptr && "Empty pipeline handle!");
+    return m_state->status.load(std::memory_order_acquire);
+}
+
+bool VulkanPipelineCompiler::Handle::isReady() const
+{
+    return m_state != nullptr && getStatus() == Status::Ready;
+}
+
+vk::Pipeline VulkanPipelineCompiler::Handle::get() const
+{
+    // fallbacks may have fallbacks of their own
+    for (const State* state = m_state.get(); state != nullptr; state = state->fallback.get())
+    {
+        if (state->status.load(std::memory_order_acquire) == Status::Ready)
+            return state->pipeline;
+    }
+
+    return VK_NULL_HANDLE;
+}
+
+void VulkanPipelineCompiler::Handle::wait() const
+{
+    if (m_state != nullptr && m_state->done.valid())
+    {
+        m_state->done.wait();
+    }
+}
+
+// ------------ VulkanPipelineCompiler ------------
+
+void VulkanPipelineCompiler::init(std::uint32_t threadCount)
+{
+    if (threadCount > 0)
+    {
+        m_threadPool = std::make_unique<ThreadPool>(threadCount);
+    }
+    spdlog::info("Pipeline compiler uses {} threads", threadCount);
+}
+
+void VulkanPipelineCompiler::destroy() noexcept
+{
+    // joins workers after the remaining compilations are done
+    m_threadPool.reset();
+
+    std::vector<vk::PipelineCache> threadCaches;
+    for (const auto& [threadId, cache] : m_threadCaches)
+    {
+        threadCaches.push_back(cache);
+    }
+    m_threadCaches.clear();
+    VulkanContext::GetPipelineCache().merge(threadCaches);
+
+    const vk::Device device = VulkanContext::GetLogicalDevice();
+    const vk::DispatchLoaderDynamic& dispatch = VulkanContext::GetDispatch();
+    for (const std::shared_ptr<Handle::State>& state : m_states)
+    {
+        if (state->status == Status::Ready)
+        {
+            device.destroyPipeline(state->pipeline, nullptr, dispatch);
+        }
+    }
+    m_states.clear();
+}
+
+VulkanPipelineCompiler::Handle VulkanPipelineCompiler::compile(std::string name, BuildFunction build,
+                                                               const Handle& fallback)
+{
+    auto state = std::make_shared<Handle::State>();
+    state->name = std::move(name);
+    state->fallback = fallback.m_state;
+
+    {
+        std::lock_guard lock(m_mutex);
+        m_states.push_back(state);
+    }
+
+    if (!m_threadPool)
+    {
+        runBuild(*state, build);
+        return Handle(state);
+    }
+
+    ++m_pendingCount;
+    // state is kept alive by m_states until destroy(), which waits for all tasks first
+    state->done = m_threadPool->submit([this, statePtr = state.get(), build = std::move(build)]() {
+        runBuild(*statePtr, build);
+        --m_pendingCount;
+    }).share();
+
+    return Handle(state);
+}
+
+std::uint32_t VulkanPipelineCompiler::getPendingCount() const
+{
+    return m_pendingCount;
+}
+
+void VulkanPipelineCompiler::runBuild(Handle::State& state, const BuildFunction& build)
+{
+    CPU_PROFILE_ZONE("compile pipeline");
+
+    try
+    {
+        state.pipeline = build(m_threadPool ? getThreadCache() : VulkanContext::GetPipelineCache().getHandle());
+        state.status.store(Status::Ready, std::memory_order_release);
+    }
+    catch (const std::exception& e)
+    {
+        spdlog::error("Failed to compile pipeline {}: {}", state.name, e.what());
+        state.status.store(Status::Failed, std::memory_order_release);
+    }
+}
+
+vk::PipelineCache VulkanPipelineCompiler::getThreadCache()
+{
+    std::lock_guard lock(m_mutex);
+
+    vk::PipelineCache& cache = m_threadCaches[std::this_thread::get_id()];
+    if (!cache)
+    {
+        cache = VulkanContext::GetPipelineCache().createLocalCache();
+    }
+    return cache;
+}
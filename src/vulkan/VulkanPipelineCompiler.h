@@ -0,0 +1,100 @@
+#ifndef VULKANPIPELINECOMPILER_H
+#define VULKANPIPELINECOMPILER_H
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "utility/NonCopyable.h"
+#include "utility/NonMovable.h"
+#include "utility/ThreadPool.h"
+#include "utility/Utility.h"
+
+// Compiles pipelines on worker threads and hands out handles right away. Until a pipeline is ready
+// its handle resolves to the fallback pipeline it was given, or to nothing, and draw code is
+// expected to skip such draws instead of waiting. Compiler owns all pipelines it has created.
+class VulkanPipelineCompiler : NonCopyable, NonMovable
+{
+public:
+    // creates pipeline through given cache, called on a worker thread. Must own everything it uses
+    using BuildFunction = std::function<vk::Pipeline(vk::PipelineCache cache)>;
+
+    enum class Status
+    {
+        Pending,
+        Ready,
+        Failed
+    };
+
+    class Handle
+    {
+    public:
+        Handle() = default;
+
+        NODISCARD Status getStatus() const;
+        NODISCARD bool isReady() const;
+
+        // compiled pipeline, fallback while it's pending or failed, null if there is neither
+        NODISCARD vk::Pipeline get() const;
+
+        // blocks until compilation is finished, for loading screens and shutdown
+        void wait() const;
+
+        NODISCARD explicit operator bool() const { return m_state != nullptr; }
+
+    private:
+        friend class VulkanPipelineCompiler;
+
+        struct State
+        {
+            std::string name;
+            std::atomic<Status> status = Status::Pending;
+            // written once before status becomes Ready
+            vk::Pipeline pipeline = VK_NULL_HANDLE;
+            std::shared_ptr<const State> fallback;
+            std::shared_future<void> done;
+        };
+
+        explicit Handle(std::shared_ptr<State> state);
+
+        std::shared_ptr<State> m_state;
+    };
+
+public:
+    VulkanPipelineCompiler() = default;
+
+    // zero threads compiles synchronously inside of compile()
+    void init(std::uint32_t threadCount);
+    // waits for pending compilations and destroys every pipeline
+    void destroy() noexcept;
+
+    NODISCARD Handle compile(std::string name, BuildFunction build, const Handle& fallback = {});
+
+    // number of compilations that are not finished yet
+    NODISCARD std::uint32_t getPendingCount() const;
+
+private:
+    void runBuild(Handle::State& state, const BuildFunction& build);
+
+    // per worker thread cache without internal locking, merged into the main one on destroy
+    vk::PipelineCache getThreadCache();
+
+private:
+    std::unique_ptr<ThreadPool> m_threadPool;
+
+    std::mutex m_mutex;
+    std::vector<std::shared_ptr<Handle::State>> m_states;
+    std::unordered_map<std::thread::id, vk::PipelineCache> m_threadCaches;
+
+    std::atomic<std::uint32_t> m_pendingCount = 0;
+};
+
+#endif //VULKANPIPELINECOMPILER_H
@@ -0,0 +1,424 @@
+#include "VulkanPipelineRegistry.h"
+
+#include <algorithm>
+#include <map>
+#include <optional>
+
+#include <spdlog/spdlog.h>
+
+#include "VulkanContext.h"
+
+namespace
+{
+    // runs on a pipeline compiler thread, so it only touches what it was given
+    vk::Pipeline CreateGraphicsPipeline(const VulkanGraphicsPipelineDesc& desc, const std::string& name,
+                                        vk::PipelineCache cache, vk::ShaderModule vertexShaderModule,
+                                        vk::ShaderModule fragmentShaderModule, vk::PipelineLayout layout)
+    {
+        ASSERT(desc.colorFormats.size() == desc.colorBlendAttachments.size() &&
+               "Every color attachment needs its blend state!");
+
+        const vk::SpecializationInfo vertexSpecializationInfo = desc.vertexSpecialization.getInfo();
+        const vk::SpecializationInfo fragmentSpecializationInfo = desc.fragmentSpecialization.getInfo();
+
+        vk::PipelineShaderStageCreateInfo vertexShaderStageCreateInfo = {
+            .sType = vk::StructureType::ePipelineShaderStageCreateInfo,
+            .pNext = nullptr,
+            .flags = vk::PipelineShaderStageCreateFlags(),
+            .stage = vk::ShaderStageFlagBits::eVertex,
+            .module = vertexShaderModule,
+            .pName = "main",
+            .pSpecializationInfo = desc.vertexSpecialization.empty() ? nullptr : &vertexSpecializationInfo
+        };
+
+        vk::PipelineShaderStageCreateInfo fragmentShaderStageCreateInfo = {
+            .sType = vk::StructureType::ePipelineShaderStageCreateInfo,
+            .pNext = nullptr,
+            .flags = vk::PipelineShaderStageCreateFlags(),
+            .stage = vk::ShaderStageFlagBits::eFragment,
+            .module = fragmentShaderModule,
+            .pName = "main",
+            .pSpecializationInfo = desc.fragmentSpecialization.empty() ? nullptr : &fragmentSpecializationInfo
+        };
+
+        vk::PipelineShaderStageCreateInfo shaderStages[] = {
+            vertexShaderStageCreateInfo,
+            fragmentShaderStageCreateInfo
+        };
+
+        vk::PipelineDynamicStateCreateInfo dynamicStateInfo = {
+            .sType = vk::StructureType::ePipelineDynamicStateCreateInfo,
+            .pNext = nullptr,
+            .flags = vk::PipelineDynamicStateCreateFlags(),
+            .dynamicStateCount = static_cast<std::uint32_t>(desc.dynamicStates.size()),
+            .pDynamicStates = desc.dynamicStates.data()
+        };
+
+        vk::PipelineVertexInputStateCreateInfo vertexInputInfo = {
+            .sType = vk::StructureType::ePipelineVertexInputStateCreateInfo,
+            .pNext = nullptr,
+            .flags = vk::PipelineVertexInputStateCreateFlags(),
+            .vertexBindingDescriptionCount = static_cast<std::uint32_t>(desc.vertexBindings.size()),
+            .pVertexBindingDescriptions = desc.vertexBindings.data(),
+            .vertexAttributeDescriptionCount = static_cast<std::uint32_t>(desc.vertexAttributes.size()),
+            .pVertexAttributeDescriptions = desc.vertexAttributes.data()
+        };
+
+        vk::PipelineInputAssemblyStateCreateInfo inputAssemblyInfo = {
+            .sType = vk::StructureType::ePipelineInputAssemblyStateCreateInfo,
+            .pNext = nullptr,
+            .flags = vk::PipelineInputAssemblyStateCreateFlags(),
+            .topology = desc.topology,
+            .primitiveRestartEnable = VK_FALSE
+        };
+
+        vk::PipelineViewportStateCreateInfo viewportInfo = {
+            .sType = vk::StructureType::ePipelineViewportStateCreateInfo,
+            .pNext = nullptr,
+            .flags = vk::PipelineViewportStateCreateFlags(),
+            .viewportCount = 1,
+            .pViewports = nullptr, // not specifying it here because of dynamic state
+            .scissorCount = 1,
+            .pScissors = nullptr
+        };
+
+        vk::PipelineRasterizationStateCreateInfo rasterizationInfo = {
+            .sType = vk::StructureType::ePipelineRasterizationStateCreateInfo,
+            .pNext = nullptr,
+            .flags = vk::PipelineRasterizationStateCreateFlags(),
+            .depthClampEnable = VK_FALSE,
+            .rasterizerDiscardEnable = VK_FALSE,
+            .polygonMode = desc.polygonMode,
+            .cullMode = desc.cullMode,
+            .frontFace = desc.frontFace,
+            .depthBiasEnable = VK_FALSE,
+            .depthBiasConstantFactor = 0.0f,
+            .depthBiasClamp = 0.0f,
+            .depthBiasSlopeFactor = 0.0f,
+            .lineWidth = 1.0f
+        };
+
+        vk::PipelineMultisampleStateCreateInfo multisamplingInfo = {
+            .sType = vk::StructureType::ePipelineMultisampleStateCreateInfo,
+            .pNext = nullptr,
+            .flags = vk::PipelineMultisampleStateCreateFlags(),
+            .rasterizationSamples = desc.rasterizationSamples,
+            .sampleShadingEnable = VK_FALSE,
+            .minSampleShading = 1.0f,
+            .pSampleMask = nullptr,
+            .alphaToCoverageEnable = VK_FALSE,
+            .alphaToOneEnable = VK_FALSE
+        };
+
+        vk::PipelineDepthStencilStateCreateInfo depthStencilInfo = {
+            .sType = vk::StructureType::ePipelineDepthStencilStateCreateInfo,
+            .pNext = nullptr,
+            .flags = vk::PipelineDepthStencilStateCreateFlags(),
+            .depthTestEnable = desc.depthTestEnable,
+            .depthWriteEnable = desc.depthWriteEnable,
+            .depthCompareOp = desc.depthCompareOp,
+            .depthBoundsTestEnable = VK_FALSE,
+            .stencilTestEnable = VK_FALSE,
+            .front = {},
+            .back = {},
+            .minDepthBounds = 0.0f,
+            .maxDepthBounds = 1.0f
+        };
+
+        vk::PipelineColorBlendStateCreateInfo colorBlendInfo = {
+            .sType = vk::StructureType::ePipelineColorBlendStateCreateInfo,
+            .pNext = nullptr,
+            .flags = vk::PipelineColorBlendStateCreateFlags(),
+            .logicOpEnable = VK_FALSE,
+            .logicOp = vk::LogicOp::eCopy,
+            .attachmentCount = static_cast<std::uint32_t>(desc.colorBlendAttachments.size()),
+            .pAttachments = desc.colorBlendAttachments.data(),
+            .blendConstants = vk::ArrayWrapper1D<float, 4>{}
+        };
+
+        vk::PipelineRenderingCreateInfo pipelineRenderingCreateInfo{};
+        pipelineRenderingCreateInfo.setColorAttachmentFormats(desc.colorFormats);
+        pipelineRenderingCreateInfo.setDepthAttachmentFormat(desc.depthFormat);
+
+        const bool hasDepth = desc.depthFormat != vk::Format::eUndefined;
+
+        vk::GraphicsPipelineCreateInfo pipelineCreateInfo = {
+            .sType = vk::StructureType::eGraphicsPipelineCreateInfo,
+            .pNext = &pipelineRenderingCreateInfo,
+            .flags = vk::PipelineCreateFlags(),
+            .stageCount = 2,
+            .pStages = shaderStages,
+            .pVertexInputState = &vertexInputInfo,
+            .pInputAssemblyState = &inputAssemblyInfo,
+            .pTessellationState = nullptr,
+            .pViewportState = &viewportInfo,
+            .pRasterizationState = &rasterizationInfo,
+            .pMultisampleState = &multisamplingInfo,
+            .pDepthStencilState = hasDepth ? &depthStencilInfo : nullptr,
+            .pColorBlendState = &colorBlendInfo,
+            .pDynamicState = &dynamicStateInfo,
+            .layout = layout,
+            .renderPass = VK_NULL_HANDLE, // render pass is not required cause we're using dynamic rendering
+            .subpass = 0,
+            .basePipelineHandle = VK_NULL_HANDLE,
+            .basePipelineIndex = -1
+        };
+
+        return VulkanContext::GetPipelineCache().createGraphicsPipeline(pipelineCreateInfo, name.c_str(), cache);
+    }
+}
+
+void VulkanPipelineRegistry::destroy() noexcept
+{
+    const Stats stats = getStats();
+    spdlog::info("Pipeline registry: {} requests, {} pipelines, {} layouts, {} set layouts, {} shader modules",
+                 stats.requests, stats.pipelines, stats.layouts, stats.setLayouts, stats.shaderModules);
+
+    const vk::Device device = VulkanContext::GetLogicalDevice();
+    const vk::DispatchLoaderDynamic& dispatch = VulkanContext::GetDispatch();
+
+    m_pipelines.clear();
+    for (const auto& [desc, layout] : m_layouts)
+    {
+        device.destroyPipelineLayout(layout, nullptr, dispatch);
+    }
+    m_layouts.clear();
+    for (const auto& [desc, setLayout] : m_setLayouts)
+    {
+        device.destroyDescriptorSetLayout(setLayout, nullptr, dispatch);
+    }
+    m_setLayouts.clear();
+    for (const auto& [name, shaderModule] : m_shaderModules)
+    {
+        device.destroyShaderModule(shaderModule, nullptr, dispatch);
+    }
+    m_shaderModules.clear();
+    m_reflections.clear();
+    m_requests = 0;
+}
+
+VulkanPipelineCompiler::Handle VulkanPipelineRegistry::getPipeline(const VulkanGraphicsPipelineDesc& desc,
+                                                                   const VulkanPipelineCompiler::Handle& fallback)
+{
+    std::lock_guard lock(m_mutex);
+    m_requests++;
+
+    // hash only picks the bucket, descriptions are compared in full, so a collision can't alias two pipelines
+    if (const auto it = m_pipelines.find(desc); it != m_pipelines.end())
+        return it->second;
+
+    const vk::PipelineLayout layout = getPipelineLayoutLocked(desc.layout);
+    const vk::ShaderModule vertexShaderModule = getShaderModuleLocked(desc.vertexShader);
+    const vk::ShaderModule fragmentShaderModule = getShaderModuleLocked(desc.fragmentShader);
+
+    std::string name = fmt::format("{} + {} ({:016x})", desc.vertexShader, desc.fragmentShader, desc.hash());
+
+    // modules and layout are only destroyed with the registry, after the compiler is done
+    VulkanPipelineCompiler::Handle handle = VulkanContext::GetPipelineCompiler().compile(name,
+        [desc, name, vertexShaderModule, fragmentShaderModule, layout](vk::PipelineCache cache) {
+            return CreateGraphicsPipeline(desc, name, cache, vertexShaderModule, fragmentShaderModule, layout);
+        }, fallback);
+
+    m_pipelines.emplace(desc, handle);
+    return handle;
+}
+
+vk::PipelineLayout VulkanPipelineRegistry::getPipelineLayout(const VulkanPipelineLayoutDesc& desc)
+{
+    std::lock_guard lock(m_mutex);
+    return getPipelineLayoutLocked(desc);
+}
+
+vk::DescriptorSetLayout VulkanPipelineRegistry::getDescriptorSetLayout(const VulkanDescriptorSetLayoutDesc& desc)
+{
+    std::lock_guard lock(m_mutex);
+    return getDescriptorSetLayoutLocked(desc);
+}
+
+void VulkanPipelineRegistry::applyReflection(VulkanGraphicsPipelineDesc& desc)
+{
+    std::lock_guard lock(m_mutex);
+
+    const VulkanShaderReflection& vertex = getReflectionLocked(desc.vertexShader);
+    const VulkanShaderReflection& fragment = getReflectionLocked(desc.fragmentShader);
+
+    desc.vertexBindings.clear();
+    desc.vertexAttributes.clear();
+    std::uint32_t stride = 0;
+    for (const VulkanShaderReflection::VertexInput& input : vertex.vertexInputs)
+    {
+        desc.vertexAttributes.push_back({
+            .location = input.location,
+            .binding = 0,
+            .format = input.format,
+            .offset = stride
+        });
+        stride += input.size;
+    }
+
+    if (stride > 0)
+    {
+        desc.vertexBindings.push_back({
+            .binding = 0,
+            .stride = stride,
+            .inputRate = vk::VertexInputRate::eVertex
+        });
+    }
+
+    std::map<std::uint32_t, std::vector<vk::DescriptorSetLayoutBinding>> sets;
+    std::optional<vk::PushConstantRange> pushConstants;
+    for (const VulkanShaderReflection* stage : {&vertex, &fragment})
+    {
+        for (const auto& [set, bindings] : stage->descriptorSets)
+        {
+            std::vector<vk::DescriptorSetLayoutBinding>& mergedBindings = sets[set];
+            for (const vk::DescriptorSetLayoutBinding& binding : bindings)
+            {
+                const auto it = std::find_if(mergedBindings.begin(), mergedBindings.end(),
+                                             [&](const auto& merged) { return merged.binding == binding.binding; });
+                if (it == mergedBindings.end())
+                {
+                    mergedBindings.push_back(binding);
+                    continue;
+                }
+
+                if (it->descriptorType != binding.descriptorType || it->descriptorCount != binding.descriptorCount)
+                {
+                    throw std::runtime_error(fmt::format("Shaders {} and {} disagree on set {} binding {}",
+                                                         desc.vertexShader, desc.fragmentShader, set, binding.binding));
+                }
+                it->stageFlags |= binding.stageFlags;
+            }
+        }
+
+        // one range visible to all stages that use push constants keeps the layout simple
+        if (stage->pushConstants)
+        {
+            if (!pushConstants)
+            {
+                pushConstants = stage->pushConstants;
+                continue;
+            }
+
+            const std::uint32_t begin = std::min(pushConstants->offset, stage->pushConstants->offset);
+            const std::uint32_t end = std::max(pushConstants->offset + pushConstants->size,
+                                               stage->pushConstants->offset + stage->pushConstants->size);
+            pushConstants->stageFlags |= stage->pushConstants->stageFlags;
+            pushConstants->offset = begin;
+            pushConstants->size = end - begin;
+        }
+    }
+
+    desc.layout = {};
+    if (!sets.empty())
+    {
+        // set numbers index the layout array, unused ones in between get an empty layout
+        desc.layout.setLayouts.resize(sets.rbegin()->first + 1);
+        for (std::uint32_t set = 0; set < desc.layout.setLayouts.size(); ++set)
+        {
+            VulkanDescriptorSetLayoutDesc setDesc;
+            if (const auto it = sets.find(set); it != sets.end())
+            {
+                setDesc.bindings = it->second;
+                std::sort(setDesc.bindings.begin(), setDesc.bindings.end(),
+                          [](const auto& a, const auto& b) { return a.binding < b.binding; });
+            }
+            desc.layout.setLayouts[set] = getDescriptorSetLayoutLocked(setDesc);
+        }
+    }
+
+    if (pushConstants)
+    {
+        desc.layout.pushConstantRanges.push_back(*pushConstants);
+    }
+}
+
+VulkanPipelineRegistry::Stats VulkanPipelineRegistry::getStats() const
+{
+    std::lock_guard lock(m_mutex);
+    return {
+        .requests = m_requests,
+        .pipelines = m_pipelines.size(),
+        .layouts = m_layouts.size(),
+        .setLayouts = m_setLayouts.size(),
+        .shaderModules = m_shaderModules.size()
+    };
+}
+
+vk::PipelineLayout VulkanPipelineRegistry::getPipelineLayoutLocked(const VulkanPipelineLayoutDesc& desc)
+{
+    if (const auto it = m_layouts.find(desc); it != m_layouts.end())
+        return it->second;
+
+    vk::PipelineLayoutCreateInfo layoutInfo = {
+        .sType = vk::StructureType::ePipelineLayoutCreateInfo,
+        .pNext = nullptr,
+        .flags = vk::PipelineLayoutCreateFlags(),
+        .setLayoutCount = static_cast<std::uint32_t>(desc.setLayouts.size()),
+        .pSetLayouts = desc.setLayouts.data(),
+        .pushConstantRangeCount = static_cast<std::uint32_t>(desc.pushConstantRanges.size()),
+        .pPushConstantRanges = desc.pushConstantRanges.data()
+    };
+
+    const vk::PipelineLayout layout = VulkanContext::GetLogicalDevice().createPipelineLayout(
+        layoutInfo, nullptr, VulkanContext::GetDispatch());
+    m_layouts.emplace(desc, layout);
+    return layout;
+}
+
+vk::ShaderModule VulkanPipelineRegistry::getShaderModuleLocked(const std::string& name)
+{
+    if (const auto it = m_shaderModules.find(name); it != m_shaderModules.end())
+        return it->second;
+
+    // points into the archive, no copy is made
+    const std::span<const std::uint32_t> code = VulkanContext::GetShaderArchive().getCode(name);
+
+    const vk::ShaderModuleCreateInfo createInfo = {
+        .sType = vk::StructureType::eShaderModuleCreateInfo,
+        .pNext = nullptr,
+        .flags = {},
+        .codeSize = code.size_bytes(),
+        .pCode = code.data()
+    };
+
+    const vk::ShaderModule shaderModule = VulkanContext::GetLogicalDevice().createShaderModule(
+        createInfo, nullptr, VulkanContext::GetDispatch());
+    m_shaderModules.emplace(name, shaderModule);
+    return shaderModule;
+}
+
+vk::DescriptorSetLayout VulkanPipelineRegistry::getDescriptorSetLayoutLocked(const VulkanDescriptorSetLayoutDesc& desc)
+{
+    if (const auto it = m_setLayouts.find(desc); it != m_setLayouts.end())
+        return it->second;
+
+    const vk::DescriptorSetLayoutCreateInfo createInfo = {
+        .sType = vk::StructureType::eDescriptorSetLayoutCreateInfo,
+        .pNext = nullptr,
+        .flags = vk::DescriptorSetLayoutCreateFlags(),
+        .bindingCount = static_cast<std::uint32_t>(desc.bindings.size()),
+        .pBindings = desc.bindings.data()
+    };
+
+    const vk::DescriptorSetLayout setLayout = VulkanContext::GetLogicalDevice().createDescriptorSetLayout(
+        createInfo, nullptr, VulkanContext::GetDispatch());
+    m_setLayouts.emplace(desc, setLayout);
+    return setLayout;
+}
+
+const VulkanShaderReflection& VulkanPipelineRegistry::getReflectionLocked(const std::string& name)
+{
+    if (const auto it = m_reflections.find(name); it != m_reflections.end())
+        return it->second;
+
+    try
+    {
+        return m_reflections.emplace(name, VulkanShaderReflection::Reflect(
+            VulkanContext::GetShaderArchive().getCode(name))).first->second;
+    }
+    catch (const std::runtime_error& e)
+    {
+        throw std::runtime_error(fmt::format("Failed to reflect shader {}: {}", name, e.what()));
+    }
+}
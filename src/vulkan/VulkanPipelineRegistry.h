@@ -0,0 +1,80 @@
+#ifndef VULKANPIPELINEREGISTRY_H
+#define VULKANPIPELINEREGISTRY_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <vulkan/vulkan.hpp>
+
+#include "VulkanGraphicsPipelineDesc.h"
+#include "VulkanPipelineCompiler.h"
+#include "VulkanShaderReflection.h"
+#include "utility/NonCopyable.h"
+#include "utility/NonMovable.h"
+#include "utility/Utility.h"
+
+// Hands out pipelines by description. Identical descriptions share one compiled pipeline,
+// and pipeline layouts and shader modules are shared between all pipelines using them.
+// Shader modules are created from the shader archive. Everything is kept alive until destroy()
+class VulkanPipelineRegistry : NonCopyable, NonMovable
+{
+public:
+    struct Stats
+    {
+        std::uint64_t requests = 0;
+        std::uint64_t pipelines = 0;
+        std::uint64_t layouts = 0;
+        std::uint64_t setLayouts = 0;
+        std::uint64_t shaderModules = 0;
+    };
+
+public:
+    VulkanPipelineRegistry() = default;
+
+    // pipelines are owned by compiler, so it must be destroyed before the registry
+    void destroy() noexcept;
+
+    // compiles the pipeline on the first request, later requests get the same handle
+    NODISCARD VulkanPipelineCompiler::Handle getPipeline(const VulkanGraphicsPipelineDesc& desc,
+                                                         const VulkanPipelineCompiler::Handle& fallback = {});
+
+    NODISCARD vk::PipelineLayout getPipelineLayout(const VulkanPipelineLayoutDesc& desc);
+    NODISCARD vk::DescriptorSetLayout getDescriptorSetLayout(const VulkanDescriptorSetLayoutDesc& desc);
+
+    // fills vertex input and layout of the description from its shaders. Vertex attributes are
+    // tightly packed into binding 0 in location order. Bindings of both stages are merged,
+    // and identical set layouts are shared with every other pipeline
+    void applyReflection(VulkanGraphicsPipelineDesc& desc);
+
+    NODISCARD Stats getStats() const;
+
+private:
+    template <typename Desc>
+    struct DescHash
+    {
+        std::size_t operator()(const Desc& desc) const { return static_cast<std::size_t>(desc.hash()); }
+    };
+
+    // expects m_mutex to be locked
+    vk::PipelineLayout getPipelineLayoutLocked(const VulkanPipelineLayoutDesc& desc);
+    vk::ShaderModule getShaderModuleLocked(const std::string& name);
+    vk::DescriptorSetLayout getDescriptorSetLayoutLocked(const VulkanDescriptorSetLayoutDesc& desc);
+    const VulkanShaderReflection& getReflectionLocked(const std::string& name);
+
+private:
+    mutable std::mutex m_mutex;
+
+    std::unordered_map<VulkanGraphicsPipelineDesc, VulkanPipelineCompiler::Handle,
+                       DescHash<VulkanGraphicsPipelineDesc>> m_pipelines;
+    std::unordered_map<VulkanPipelineLayoutDesc, vk::PipelineLayout, DescHash<VulkanPipelineLayoutDesc>> m_layouts;
+    std::unordered_map<VulkanDescriptorSetLayoutDesc, vk::DescriptorSetLayout,
+                       DescHash<VulkanDescriptorSetLayoutDesc>> m_setLayouts;
+    std::unordered_map<std::string, vk::ShaderModule> m_shaderModules;
+    std::unordered_map<std::string, VulkanShaderReflection> m_reflections;
+
+    std::uint64_t m_requests = 0;
+};
+
+#endif //VULKANPIPELINEREGISTRY_H
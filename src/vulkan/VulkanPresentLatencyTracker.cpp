@@ -0,0 +1,159 @@
+#include "VulkanPresentLatencyTracker.h"
+
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+#include "VulkanContext.h"
+
+void VulkanPresentLatencyTracker::init()
+{
+    m_enabled = VulkanContext::GetDevice().isPresentWaitEnabled();
+    if (!m_enabled)
+    {
+        spdlog::info("VK_KHR_present_wait is not available, present latency won't be measured");
+        return;
+    }
+
+    m_device = VulkanContext::GetLogicalDevice();
+    m_dispatch = &VulkanContext::GetDispatch();
+
+    m_stopRequested = false;
+    m_thread = std::thread(&VulkanPresentLatencyTracker::threadLoop, this);
+}
+
+void VulkanPresentLatencyTracker::destroy() noexcept
+{
+    if (!m_enabled)
+        return;
+
+    {
+        std::lock_guard lock(m_queueMutex);
+        m_stopRequested = true;
+        m_pending.clear();
+    }
+    m_queueCondition.notify_one();
+    m_thread.join();
+}
+
+bool VulkanPresentLatencyTracker::isEnabled() const
+{
+    return m_enabled;
+}
+
+std::uint64_t VulkanPresentLatencyTracker::nextPresentId()
+{
+    return ++m_lastPresentId;
+}
+
+void VulkanPresentLatencyTracker::onPresented(vk::SwapchainKHR swapchain, std::uint64_t presentId,
+                                              Clock::time_point submitTime)
+{
+    if (!m_enabled)
+        return;
+
+    {
+        std::lock_guard lock(m_queueMutex);
+        m_pending.push_back({swapchain, presentId, submitTime});
+    }
+    m_queueCondition.notify_one();
+}
+
+void VulkanPresentLatencyTracker::onSwapchainRetired(vk::SwapchainKHR swapchain)
+{
+    if (!m_enabled)
+        return;
+
+    // holding swapchain mutex guarantees the thread is not waiting on it right now
+    std::lock_guard swapchainLock(m_swapchainMutex);
+    std::lock_guard queueLock(m_queueMutex);
+    std::erase_if(m_pending, [swapchain](const PendingPresent& present) {
+        return present.swapchain == swapchain;
+    });
+}
+
+std::unique_lock<std::mutex> VulkanPresentLatencyTracker::lockSwapchain()
+{
+    return std::unique_lock(m_swapchainMutex);
+}
+
+VulkanPresentLatencyTracker::Stats VulkanPresentLatencyTracker::getStats()
+{
+    std::lock_guard lock(m_statsMutex);
+    return m_stats;
+}
+
+void VulkanPresentLatencyTracker::threadLoop()
+{
+    while (true)
+    {
+        PendingPresent present;
+        {
+            std::unique_lock lock(m_queueMutex);
+            m_queueCondition.wait(lock, [this]() { return m_stopRequested || !m_pending.empty(); });
+            if (m_stopRequested)
+                return;
+
+            present = m_pending.front();
+        }
+
+        VkResult result;
+        {
+            std::lock_guard swapchainLock(m_swapchainMutex);
+
+            // swapchain could have been retired while the lock was released
+            {
+                std::lock_guard queueLock(m_queueMutex);
+                if (m_pending.empty() || m_pending.front().presentId != present.presentId)
+                    continue;
+            }
+
+            // zero timeout only checks, presenting thread never waits for the lock longer than that
+            result = m_dispatch->vkWaitForPresentKHR(m_device, present.swapchain, present.presentId, 0);
+        }
+
+        const Clock::time_point now = Clock::now();
+        if (result == VK_TIMEOUT && now - present.submitTime < s_giveUpTimeout)
+        {
+            // not shown yet, sleeps without the swapchain lock until the next check
+            std::unique_lock lock(m_queueMutex);
+            m_queueCondition.wait_for(lock, s_pollInterval, [this]() { return m_stopRequested; });
+            continue;
+        }
+
+        if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR)
+        {
+            recordLatency(std::chrono::duration<double, std::milli>(now - present.submitTime).count());
+        }
+
+        std::lock_guard lock(m_queueMutex);
+        if (!m_pending.empty() && m_pending.front().presentId == present.presentId)
+        {
+            m_pending.pop_front();
+        }
+    }
+}
+
+void VulkanPresentLatencyTracker::recordLatency(double latencyMs)
+{
+    std::lock_guard lock(m_statsMutex);
+
+    if (m_stats.presentedFrames == 0)
+    {
+        m_stats.minMs = latencyMs;
+        m_stats.maxMs = latencyMs;
+    }
+
+    ++m_stats.presentedFrames;
+    m_totalMs += latencyMs;
+    m_stats.lastMs = latencyMs;
+    m_stats.minMs = std::min(m_stats.minMs, latencyMs);
+    m_stats.maxMs = std::max(m_stats.maxMs, latencyMs);
+    m_stats.averageMs = m_totalMs / static_cast<double>(m_stats.presentedFrames);
+
+    if (m_stats.presentedFrames % s_reportInterval == 0)
+    {
+        spdlog::info("Present latency over {} frames: avg {:.2f} ms, min {:.2f} ms, max {:.2f} ms, last {:.2f} ms",
+            m_stats.presentedFrames, m_stats.averageMs, m_stats.minMs, m_stats.maxMs, m_stats.lastMs);
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef VULKANPRESENTLATENCYTRACKER_H
+#define VULKANPRESENTLATENCYTRACKER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include <vulkan/vulkan.hpp>
+
+#include "utility/NonCopyable.h"
+#include "utility/NonMovable.h"
+#include "utility/Utility.h"
+
+// Measures time between queue submit of a frame and the moment it's actually shown.
+// Uses VK_KHR_present_id to tag presents and VK_KHR_present_wait on a background thread
+// to find out when they hit the screen. The thread polls the wait with zero timeout under
+// the swapchain lock, so presenting is never held up by it. Disabled if extensions are not available.
+class VulkanPresentLatencyTracker : NonCopyable, NonMovable
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Stats
+    {
+        std::uint64_t presentedFrames = 0;
+        double lastMs = 0.0;
+        double averageMs = 0.0;
+        double minMs = 0.0;
+        double maxMs = 0.0;
+    };
+
+public:
+    VulkanPresentLatencyTracker() = default;
+
+    void init();
+    void destroy() noexcept;
+
+    NODISCARD bool isEnabled() const;
+
+    // id to be attached to the next present with vk::PresentIdKHR
+    NODISCARD std::uint64_t nextPresentId();
+
+    void onPresented(vk::SwapchainKHR swapchain, std::uint64_t presentId, Clock::time_point submitTime);
+
+    // must be called before swapchain is destroyed or passed as oldSwapchain, drops its pending presents
+    void onSwapchainRetired(vk::SwapchainKHR swapchain);
+
+    // vkQueuePresentKHR and vkWaitForPresentKHR need external synchronization of the swapchain
+    NODISCARD std::unique_lock<std::mutex> lockSwapchain();
+
+    NODISCARD Stats getStats();
+
+private:
+    struct PendingPresent
+    {
+        vk::SwapchainKHR swapchain;
+        std::uint64_t presentId;
+        Clock::time_point submitTime;
+    };
+
+    void threadLoop();
+    void recordLatency(double latencyMs);
+
+private:
+    // present wait doesn't block under the swapchain lock, it's polled with this interval instead
+    static constexpr auto s_pollInterval = std::chrono::microseconds(500);
+    // presents not shown within this time (e.g. occluded window) are not measured
+    static constexpr auto s_giveUpTimeout = std::chrono::seconds(1);
+    static constexpr std::uint64_t s_reportInterval = 600;
+
+    bool m_enabled = false;
+    vk::Device m_device = VK_NULL_HANDLE;
+    const vk::DispatchLoaderDynamic* m_dispatch = nullptr;
+
+    std::mutex m_swapchainMutex;
+
+    std::mutex m_queueMutex;
+    std::condition_variable m_queueCondition;
+    std::deque<PendingPresent> m_pending;
+    bool m_stopRequested = false;
+    std::thread m_thread;
+
+    std::uint64_t m_lastPresentId = 0;
+
+    std::mutex m_statsMutex;
+    Stats m_stats;
+    double m_totalMs = 0.0;
+};
+
+#endif //VULKANPRESENTLATENCYTRACKER_H
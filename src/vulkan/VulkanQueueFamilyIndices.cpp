@@ -2,38 +2,65 @@
 
 bool VulkanQueueFamilyIndices::isComplete() const
 {
-    return graphicsFamily.has_value() && presentFamily.has_value();
+    return graphicsFamily.has_value() && (presentFamily.has_value() || !presentRequired);
 }
 
 std::set<std::uint32_t> VulkanQueueFamilyIndices::getUniqueIndices() const
 {
-    return {
-        graphicsFamily.value(),
-        presentFamily.value()
+    std::set<std::uint32_t> indices = {
+        graphicsFamily.value()
     };
+
+    if (presentFamily.has_value())
+    {
+        indices.insert(presentFamily.value());
+    }
+
+    if (transferFamily.has_value())
+    {
+        indices.insert(transferFamily.value());
+    }
+
+    return indices;
 }
 
 VulkanQueueFamilyIndices VulkanQueueFamilyIndices::FindQueueFamilies(const vk::PhysicalDevice& device,
                                                          const vk::SurfaceKHR& surface)
 {
     VulkanQueueFamilyIndices indices;
+    indices.presentRequired = static_cast<bool>(surface);
+
+    // every family is looked at, transfer family is only known after all of them are seen
+    bool transferFamilyHasCompute = false;
     std::uint32_t i = 0;
     for (const auto family : device.getQueueFamilyProperties())
     {
-        if (indices.isComplete()) break;
+        const bool hasGraphics = static_cast<bool>(family.queueFlags & vk::QueueFlagBits::eGraphics);
+        const bool hasCompute = static_cast<bool>(family.queueFlags & vk::QueueFlagBits::eCompute);
 
-        if (family.queueFlags & vk::QueueFlagBits::eGraphics)
+        if (hasGraphics && !indices.graphicsFamily.has_value())
         {
             indices.graphicsFamily = i;
         }
 
-        vk::Bool32 presentSupport = false;
-        const vk::Result result = device.getSurfaceSupportKHR(i, surface, &presentSupport);
-        vk::detail::resultCheck(result, "Failed to check physical device present support!");
+        // graphics and compute families support transfers implicitly
+        const bool hasTransfer = static_cast<bool>(family.queueFlags & vk::QueueFlagBits::eTransfer) || hasCompute;
+        if (!hasGraphics && hasTransfer && (!indices.transferFamily.has_value() || (transferFamilyHasCompute && !hasCompute)))
+        {
+            indices.transferFamily = i;
+            transferFamilyHasCompute = hasCompute;
+        }
 
-        if (presentSupport)
+        if (indices.presentRequired && !indices.presentFamily.has_value())
         {
-            indices.presentFamily = i;
+            vk::Bool32 presentSupport = false;
+            const vk::Result result = device.getSurfaceSupportKHR(i, surface, &presentSupport);
+            vk::detail::resultCheck(result, "Failed to check physical device present support!");
+
+            if (presentSupport)
+            {
+                indices.presentFamily = i;
+            }
         }
 
         ++i;
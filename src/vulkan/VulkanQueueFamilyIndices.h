@@ -10,11 +10,18 @@ struct VulkanQueueFamilyIndices {
 public:
     std::optional<std::uint32_t> graphicsFamily;
     std::optional<std::uint32_t> presentFamily;
+    // family for uploads that is not the graphics one, preferably without compute too (DMA engine).
+    // Empty if there is none, uploads go to graphics queue then
+    std::optional<std::uint32_t> transferFamily;
+
+    // false when searching without surface, e.g. for headless rendering
+    bool presentRequired = true;
 
 public:
     [[nodiscard]] bool isComplete() const;
     [[nodiscard]] std::set<std::uint32_t> getUniqueIndices() const;
 
+    // present family is not searched for if surface is VK_NULL_HANDLE
     static VulkanQueueFamilyIndices FindQueueFamilies(const vk::PhysicalDevice& device, const vk::SurfaceKHR& surface);
 };
 
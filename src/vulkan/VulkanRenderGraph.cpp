@@ -0,0 +1,595 @@
+#include "VulkanRenderGraph.h"
+
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+#include "VulkanContext.h"
+
+// ------------ PassBuilder ------------
+
+VulkanRenderGraph::PassBuilder::PassBuilder(VulkanRenderGraph& graph, std::uint32_t passIndex)
+    : m_graph(graph), m_passIndex(passIndex)
+{
+}
+
+VulkanRenderGraph::PassBuilder& VulkanRenderGraph::PassBuilder::read(ResourceHandle resource, ImageUsage usage)
+{
+    m_graph.addAccess(m_passIndex, resource, usage, false);
+    return *this;
+}
+
+VulkanRenderGraph::PassBuilder& VulkanRenderGraph::PassBuilder::write(ResourceHandle resource, ImageUsage usage)
+{
+    m_graph.addAccess(m_passIndex, resource, usage, true);
+    return *this;
+}
+
+VulkanRenderGraph::PassBuilder& VulkanRenderGraph::PassBuilder::sideEffects()
+{
+    m_graph.m_passes[m_passIndex].sideEffects = true;
+    return *this;
+}
+
+// ------------ VulkanRenderGraph ------------
+
+void VulkanRenderGraph::destroy() noexcept
+{
+    for (ResourceSet& resourceSet : m_resourceSets)
+    {
+        RetireResourceSet(resourceSet);
+    }
+    m_resourceSets.clear();
+    reset();
+}
+
+void VulkanRenderGraph::reset()
+{
+    m_passes.clear();
+    m_resources.clear();
+    m_states.clear();
+    m_currentSet = nullptr;
+}
+
+VulkanRenderGraph::ResourceHandle VulkanRenderGraph::importImage(std::string name, vk::Image image,
+                                                                 vk::ImageView imageView,
+                                                                 vk::ImageAspectFlags aspectMask,
+                                                                 const ExternalImageState& initialState,
+                                                                 vk::ImageLayout finalLayout)
+{
+    Resource resource;
+    resource.name = std::move(name);
+    resource.imported = true;
+    resource.aspectMask = aspectMask;
+    resource.image = image;
+    resource.imageView = imageView;
+    resource.initialState = initialState;
+    resource.finalLayout = finalLayout;
+
+    m_resources.push_back(std::move(resource));
+    return static_cast<ResourceHandle>(m_resources.size() - 1);
+}
+
+VulkanRenderGraph::ResourceHandle VulkanRenderGraph::createImage(std::string name, const TransientImageDesc& desc)
+{
+    Resource resource;
+    resource.name = std::move(name);
+    resource.imported = false;
+    resource.aspectMask = GetAspectMask(desc.format);
+    resource.desc = desc;
+
+    m_resources.push_back(std::move(resource));
+    return static_cast<ResourceHandle>(m_resources.size() - 1);
+}
+
+VulkanRenderGraph::PassBuilder VulkanRenderGraph::addPass(std::string name, ExecuteFunction execute)
+{
+    m_passes.push_back({
+        .name = std::move(name),
+        .execute = std::move(execute),
+        .accesses = {},
+        .sideEffects = false,
+        .culled = false
+    });
+
+    return PassBuilder(*this, static_cast<std::uint32_t>(m_passes.size() - 1));
+}
+
+void VulkanRenderGraph::addAccess(std::uint32_t passIndex, ResourceHandle resource, ImageUsage usage, bool write)
+{
+    ASSERT(resource < m_resources.size() && "Unknown render graph resource!");
+    ASSERT(!(usage == ImageUsage::Sampled && write) && "Sampled images can't be written!");
+
+    Pass& pass = m_passes[passIndex];
+    for (const ResourceAccess& access : pass.accesses)
+    {
+        ASSERT(access.resource != resource && "Resource is declared twice in the same pass!");
+    }
+
+    pass.accesses.push_back({
+        .resource = resource,
+        .usage = usage,
+        .write = write
+    });
+}
+
+VulkanRenderGraph::UsageState VulkanRenderGraph::GetUsageState(ImageUsage usage, bool write)
+{
+    using Stage = vk::PipelineStageFlagBits2;
+    using Access = vk::AccessFlagBits2;
+    using Usage = vk::ImageUsageFlagBits;
+
+    switch (usage)
+    {
+        case ImageUsage::ColorAttachment:
+            return {
+                .stageMask = Stage::eColorAttachmentOutput,
+                .accessMask = write ? Access::eColorAttachmentWrite | Access::eColorAttachmentRead
+                                    : vk::AccessFlags2(Access::eColorAttachmentRead),
+                .layout = vk::ImageLayout::eColorAttachmentOptimal,
+                .usageFlags = Usage::eColorAttachment
+            };
+        case ImageUsage::DepthStencilAttachment:
+            return {
+                .stageMask = Stage::eEarlyFragmentTests | Stage::eLateFragmentTests,
+                .accessMask = write ? Access::eDepthStencilAttachmentWrite | Access::eDepthStencilAttachmentRead
+                                    : vk::AccessFlags2(Access::eDepthStencilAttachmentRead),
+                .layout = write ? vk::ImageLayout::eDepthStencilAttachmentOptimal
+                                : vk::ImageLayout::eDepthStencilReadOnlyOptimal,
+                .usageFlags = Usage::eDepthStencilAttachment
+            };
+        case ImageUsage::Sampled:
+            return {
+                .stageMask = Stage::eFragmentShader | Stage::eComputeShader,
+                .accessMask = Access::eShaderSampledRead,
+                .layout = vk::ImageLayout::eShaderReadOnlyOptimal,
+                .usageFlags = Usage::eSampled
+            };
+        case ImageUsage::Storage:
+            return {
+                .stageMask = Stage::eFragmentShader | Stage::eComputeShader,
+                .accessMask = write ? Access::eShaderStorageWrite | Access::eShaderStorageRead
+                                    : vk::AccessFlags2(Access::eShaderStorageRead),
+                .layout = vk::ImageLayout::eGeneral,
+                .usageFlags = Usage::eStorage
+            };
+        case ImageUsage::Transfer:
+            return {
+                .stageMask = Stage::eTransfer,
+                .accessMask = write ? Access::eTransferWrite : Access::eTransferRead,
+                .layout = write ? vk::ImageLayout::eTransferDstOptimal : vk::ImageLayout::eTransferSrcOptimal,
+                .usageFlags = write ? Usage::eTransferDst : Usage::eTransferSrc
+            };
+    }
+
+    throw std::runtime_error("Unknown render graph image usage!");
+}
+
+vk::ImageAspectFlags VulkanRenderGraph::GetAspectMask(vk::Format format)
+{
+    switch (format)
+    {
+        case vk::Format::eD16Unorm:
+        case vk::Format::eD32Sfloat:
+        case vk::Format::eX8D24UnormPack32:
+            return vk::ImageAspectFlagBits::eDepth;
+        case vk::Format::eD16UnormS8Uint:
+        case vk::Format::eD24UnormS8Uint:
+        case vk::Format::eD32SfloatS8Uint:
+            return vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
+        case vk::Format::eS8Uint:
+            return vk::ImageAspectFlagBits::eStencil;
+        default:
+            return vk::ImageAspectFlagBits::eColor;
+    }
+}
+
+void VulkanRenderGraph::cullPasses()
+{
+    // walk backwards from imported images: a pass is alive if it writes something
+    // that is still needed, and everything it reads becomes needed too
+    std::vector<bool> needed(m_resources.size(), false);
+    for (std::size_t i = 0; i < m_resources.size(); ++i)
+    {
+        needed[i] = m_resources[i].imported;
+    }
+
+    for (auto pass = m_passes.rbegin(); pass != m_passes.rend(); ++pass)
+    {
+        bool alive = pass->sideEffects;
+        for (const ResourceAccess& access : pass->accesses)
+        {
+            alive = alive || (access.write && needed[access.resource]);
+        }
+
+        pass->culled = !alive;
+        if (!alive)
+        {
+            spdlog::debug("Render graph: culled pass {}", pass->name);
+            continue;
+        }
+
+        for (const ResourceAccess& access : pass->accesses)
+        {
+            if (!access.write)
+                needed[access.resource] = true;
+        }
+    }
+}
+
+void VulkanRenderGraph::computeLifetimes()
+{
+    for (std::uint32_t passIndex = 0; passIndex < m_passes.size(); ++passIndex)
+    {
+        const Pass& pass = m_passes[passIndex];
+        if (pass.culled)
+            continue;
+
+        for (const ResourceAccess& access : pass.accesses)
+        {
+            Resource& resource = m_resources[access.resource];
+            if (resource.firstPass == s_unused)
+                resource.firstPass = passIndex;
+            resource.lastPass = passIndex;
+            resource.usageFlags |= GetUsageState(access.usage, access.write).usageFlags;
+        }
+    }
+}
+
+void VulkanRenderGraph::realizeTransients(ResourceSet& resourceSet)
+{
+    std::vector<TransientImage> wanted(m_resources.size());
+    std::vector<ResourceHandle> transients;
+    for (ResourceHandle handle = 0; handle < m_resources.size(); ++handle)
+    {
+        const Resource& resource = m_resources[handle];
+        if (resource.imported || resource.firstPass == s_unused)
+            continue;
+
+        wanted[handle] = {
+            .extent = resource.desc.extent,
+            .format = resource.desc.format,
+            .usageFlags = resource.usageFlags,
+            .firstPass = resource.firstPass,
+            .lastPass = resource.lastPass
+        };
+        transients.push_back(handle);
+    }
+
+    // graph usually has the same shape every frame
+    if (wanted == resourceSet.images)
+        return;
+
+    RetireResourceSet(resourceSet);
+    resourceSet.images = std::move(wanted);
+
+    const vk::Device device = VulkanContext::GetLogicalDevice();
+    const vk::DispatchLoaderDynamic& dispatch = VulkanContext::GetDispatch();
+    std::vector<vk::MemoryRequirements> requirements;
+    for (ResourceHandle handle : transients)
+    {
+        TransientImage& image = resourceSet.images[handle];
+
+        vk::ImageCreateInfo imageCreateInfo = {
+            .sType = vk::StructureType::eImageCreateInfo,
+            .pNext = nullptr,
+            .flags = vk::ImageCreateFlags(),
+            .imageType = vk::ImageType::e2D,
+            .format = image.format,
+            .extent = {image.extent.width, image.extent.height, 1},
+            .mipLevels = 1,
+            .arrayLayers = 1,
+            .samples = vk::SampleCountFlagBits::e1,
+            .tiling = vk::ImageTiling::eOptimal,
+            .usage = image.usageFlags,
+            .sharingMode = vk::SharingMode::eExclusive,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices = nullptr,
+            .initialLayout = vk::ImageLayout::eUndefined
+        };
+
+        image.image = device.createImage(imageCreateInfo, nullptr, dispatch);
+        requirements.push_back(device.getImageMemoryRequirements(image.image, dispatch));
+    }
+
+    assignMemory(resourceSet, transients, requirements);
+
+    for (ResourceHandle handle : transients)
+    {
+        TransientImage& image = resourceSet.images[handle];
+
+        vk::ImageViewCreateInfo viewCreateInfo = {
+            .sType = vk::StructureType::eImageViewCreateInfo,
+            .pNext = nullptr,
+            .flags = vk::ImageViewCreateFlags(),
+            .image = image.image,
+            .viewType = vk::ImageViewType::e2D,
+            .format = image.format,
+            .components = {},
+            .subresourceRange = vk::ImageSubresourceRange(m_resources[handle].aspectMask, 0, 1, 0, 1)
+        };
+
+        image.imageView = device.createImageView(viewCreateInfo, nullptr, dispatch);
+    }
+
+    spdlog::debug("Render graph: created {} transient images in {} allocations",
+                  transients.size(), resourceSet.allocations.size());
+}
+
+void VulkanRenderGraph::assignMemory(ResourceSet& resourceSet, const std::vector<ResourceHandle>& transients,
+                                     const std::vector<vk::MemoryRequirements>& requirements)
+{
+    struct MemorySlot
+    {
+        vk::MemoryRequirements requirements;
+        std::uint32_t lastPass;
+        ResourceHandle occupant;
+        std::vector<ResourceHandle> images;
+    };
+
+    // greedy interval packing: image goes to the first slot that is free by the time it's needed
+    std::vector<std::size_t> order(transients.size());
+    for (std::size_t i = 0; i < order.size(); ++i)
+    {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+        return resourceSet.images[transients[a]].firstPass < resourceSet.images[transients[b]].firstPass;
+    });
+
+    std::vector<MemorySlot> slots;
+    for (const std::size_t i : order)
+    {
+        const ResourceHandle handle = transients[i];
+        TransientImage& image = resourceSet.images[handle];
+        const vk::MemoryRequirements& imageRequirements = requirements[i];
+
+        auto slot = std::find_if(slots.begin(), slots.end(), [&](const MemorySlot& slot) {
+            return slot.lastPass < image.firstPass &&
+                   (slot.requirements.memoryTypeBits & imageRequirements.memoryTypeBits) != 0;
+        });
+
+        if (slot == slots.end())
+        {
+            slots.push_back({
+                .requirements = imageRequirements,
+                .lastPass = image.lastPass,
+                .occupant = handle,
+                .images = {handle}
+            });
+            continue;
+        }
+
+        image.aliasedAfter = slot->occupant;
+        slot->requirements.size = std::max(slot->requirements.size, imageRequirements.size);
+        slot->requirements.alignment = std::max(slot->requirements.alignment, imageRequirements.alignment);
+        slot->requirements.memoryTypeBits &= imageRequirements.memoryTypeBits;
+        slot->lastPass = image.lastPass;
+        slot->occupant = handle;
+        slot->images.push_back(handle);
+    }
+
+    const VmaAllocator allocator = VulkanContext::GetDevice().getVmaAllocator();
+    for (const MemorySlot& slot : slots)
+    {
+        VmaAllocationCreateInfo allocationCreateInfo = {};
+        allocationCreateInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+        const VkMemoryRequirements memoryRequirements = slot.requirements;
+        VmaAllocation allocation;
+        VkResult result = vmaAllocateMemory(allocator, &memoryRequirements, &allocationCreateInfo, &allocation, nullptr);
+        if (result != VK_SUCCESS)
+            throw std::runtime_error("Failed to allocate render graph transient memory!");
+
+        resourceSet.allocations.push_back(allocation);
+
+        for (ResourceHandle handle : slot.images)
+        {
+            result = vmaBindImageMemory(allocator, allocation, resourceSet.images[handle].image);
+            if (result != VK_SUCCESS)
+                throw std::runtime_error("Failed to bind render graph transient image memory!");
+        }
+    }
+}
+
+void VulkanRenderGraph::RetireResourceSet(ResourceSet& resourceSet)
+{
+    if (resourceSet.allocations.empty())
+    {
+        resourceSet.images.clear();
+        return;
+    }
+
+    // set may have been recorded into any submission so far
+    const std::uint64_t lastUse = VulkanContext::GetDevice().getGraphicsTimeline().getLastSignaledValue();
+    VulkanContext::GetDevice().getDeletionQueue().push(lastUse,
+        [images = std::move(resourceSet.images), allocations = std::move(resourceSet.allocations)]() {
+            const vk::Device device = VulkanContext::GetLogicalDevice();
+            const vk::DispatchLoaderDynamic& dispatch = VulkanContext::GetDispatch();
+            for (const TransientImage& image : images)
+            {
+                device.destroyImageView(image.imageView, nullptr, dispatch);
+                device.destroyImage(image.image, nullptr, dispatch);
+            }
+            for (const VmaAllocation allocation : allocations)
+            {
+                vmaFreeMemory(VulkanContext::GetDevice().getVmaAllocator(), allocation);
+            }
+        });
+
+    resourceSet.images.clear();
+    resourceSet.allocations.clear();
+}
+
+void VulkanRenderGraph::addBarrier(std::vector<vk::ImageMemoryBarrier2>& barriers, ResourceHandle resource,
+                                   const UsageState& usage, bool write)
+{
+    ResourceState& state = m_states[resource];
+
+    const bool layoutChange = state.layout != usage.layout;
+    const bool hiddenWrite = state.written && (usage.stageMask & ~state.visibleStages);
+
+    // read after read in the same layout needs nothing
+    if (write || layoutChange || hiddenWrite)
+    {
+        barriers.push_back({
+            .sType = vk::StructureType::eImageMemoryBarrier2,
+            .pNext = nullptr,
+            // write has to wait for earlier reads as well, and so does layout transition
+            .srcStageMask = state.writeStages | state.readStages,
+            .srcAccessMask = state.writeAccess,
+            .dstStageMask = usage.stageMask,
+            .dstAccessMask = usage.accessMask,
+            .oldLayout = state.layout,
+            .newLayout = usage.layout,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = getImage(resource),
+            .subresourceRange = vk::ImageSubresourceRange(m_resources[resource].aspectMask, 0, 1, 0, 1)
+        });
+    }
+
+    if (write)
+    {
+        state.writeStages = usage.stageMask;
+        state.writeAccess = usage.accessMask;
+        state.readStages = vk::PipelineStageFlags2();
+        state.visibleStages = usage.stageMask;
+        state.written = true;
+    }
+    else
+    {
+        state.readStages |= usage.stageMask;
+        state.visibleStages |= usage.stageMask;
+        // layout transition is a write of its own
+        state.written = state.written || layoutChange;
+    }
+    state.layout = usage.layout;
+}
+
+void VulkanRenderGraph::RecordBarriers(vk::CommandBuffer commandBuffer,
+                                       const std::vector<vk::ImageMemoryBarrier2>& barriers,
+                                       const vk::DispatchLoaderDynamic& dispatch)
+{
+    if (barriers.empty())
+        return;
+
+    // whole pass boundary in a single call
+    const vk::DependencyInfo dependencyInfo = {
+        .sType = vk::StructureType::eDependencyInfo,
+        .pNext = nullptr,
+        .dependencyFlags = vk::DependencyFlags(),
+        .memoryBarrierCount = 0,
+        .pMemoryBarriers = nullptr,
+        .bufferMemoryBarrierCount = 0,
+        .pBufferMemoryBarriers = nullptr,
+        .imageMemoryBarrierCount = static_cast<std::uint32_t>(barriers.size()),
+        .pImageMemoryBarriers = barriers.data()
+    };
+    commandBuffer.pipelineBarrier2(dependencyInfo, dispatch);
+}
+
+void VulkanRenderGraph::execute(vk::CommandBuffer commandBuffer, std::uint32_t resourceSet,
+                                const vk::DispatchLoaderDynamic& dispatch)
+{
+    cullPasses();
+    computeLifetimes();
+
+    if (m_resourceSets.size() <= resourceSet)
+    {
+        m_resourceSets.resize(resourceSet + 1);
+    }
+    realizeTransients(m_resourceSets[resourceSet]);
+    m_currentSet = &m_resourceSets[resourceSet];
+
+    m_states.assign(m_resources.size(), {});
+    for (ResourceHandle handle = 0; handle < m_resources.size(); ++handle)
+    {
+        const Resource& resource = m_resources[handle];
+        if (!resource.imported)
+            continue;
+
+        ResourceState& state = m_states[handle];
+        state.layout = resource.initialState.layout;
+        state.writeStages = resource.initialState.stageMask;
+        state.writeAccess = resource.initialState.accessMask;
+        state.written = resource.initialState.stageMask != vk::PipelineStageFlags2();
+    }
+
+    std::vector<vk::ImageMemoryBarrier2> barriers;
+    for (std::uint32_t passIndex = 0; passIndex < m_passes.size(); ++passIndex)
+    {
+        const Pass& pass = m_passes[passIndex];
+        if (pass.culled)
+            continue;
+
+        barriers.clear();
+        for (const ResourceAccess& access : pass.accesses)
+        {
+            const Resource& resource = m_resources[access.resource];
+            const TransientImage* transient = resource.imported ? nullptr : &m_currentSet->images[access.resource];
+            if (transient && passIndex == resource.firstPass && transient->aliasedAfter != s_unused)
+            {
+                // memory still holds the previous image, contents are discarded but its last use must finish
+                const ResourceState& previous = m_states[transient->aliasedAfter];
+                ResourceState& state = m_states[access.resource];
+                state.writeStages = previous.writeStages | previous.readStages;
+                state.writeAccess = previous.writeAccess;
+                state.written = true;
+            }
+
+            addBarrier(barriers, access.resource, GetUsageState(access.usage, access.write), access.write);
+        }
+
+        // barriers are inside of the scope, waiting on earlier passes is part of the pass cost
+        VulkanGpuProfiler::Scope passScope(VulkanContext::GetGpuProfiler(), commandBuffer, pass.name.c_str());
+        RecordBarriers(commandBuffer, barriers, dispatch);
+        pass.execute(commandBuffer);
+    }
+
+    // hand imported images over in the layout their next user expects
+    barriers.clear();
+    for (ResourceHandle handle = 0; handle < m_resources.size(); ++handle)
+    {
+        const Resource& resource = m_resources[handle];
+        const ResourceState& state = m_states[handle];
+        if (!resource.imported || resource.firstPass == s_unused || state.layout == resource.finalLayout)
+            continue;
+
+        // next user synchronizes with a semaphore or another barrier, nothing to wait for here
+        barriers.push_back({
+            .sType = vk::StructureType::eImageMemoryBarrier2,
+            .pNext = nullptr,
+            .srcStageMask = state.writeStages | state.readStages,
+            .srcAccessMask = state.writeAccess,
+            .dstStageMask = vk::PipelineStageFlagBits2::eNone,
+            .dstAccessMask = vk::AccessFlagBits2::eNone,
+            .oldLayout = state.layout,
+            .newLayout = resource.finalLayout,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = resource.image,
+            .subresourceRange = vk::ImageSubresourceRange(resource.aspectMask, 0, 1, 0, 1)
+        });
+    }
+
+    RecordBarriers(commandBuffer, barriers, dispatch);
+}
+
+vk::ImageView VulkanRenderGraph::getImageView(ResourceHandle resource) const
+{
+    if (m_resources[resource].imported)
+        return m_resources[resource].imageView;
+
+    ASSERT(m_currentSet != nullptr && "Transient images only exist while graph is executed!");
+    return m_currentSet->images[resource].imageView;
+}
+
+vk::Image VulkanRenderGraph::getImage(ResourceHandle resource) const
+{
+    if (m_resources[resource].imported)
+        return m_resources[resource].image;
+
+    ASSERT(m_currentSet != nullptr && "Transient images only exist while graph is executed!");
+    return m_currentSet->images[resource].image;
+}
@@ -0,0 +1,207 @@
+#ifndef VULKANRENDERGRAPH_H
+#define VULKANRENDERGRAPH_H
+
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan.hpp>
+
+#include "utility/NonCopyable.h"
+#include "utility/NonMovable.h"
+#include "utility/Utility.h"
+
+// Frame graph, rebuilt every frame. Passes declare images they read and write, then the graph
+// culls passes whose results are never used, infers synchronization2 barriers between the rest
+// (one batched vkCmdPipelineBarrier2 per pass boundary) and places transient images with
+// non overlapping lifetimes into the same VMA allocation.
+class VulkanRenderGraph : NonCopyable, NonMovable
+{
+public:
+    using ResourceHandle = std::uint32_t;
+    using ExecuteFunction = std::function<void(vk::CommandBuffer commandBuffer)>;
+
+    // layout, stages and access of an image are derived from usage and read / write
+    enum class ImageUsage
+    {
+        ColorAttachment,
+        DepthStencilAttachment,
+        Sampled,            // read only
+        Storage,
+        Transfer            // read is transfer source, write is transfer destination
+    };
+
+    struct TransientImageDesc
+    {
+        vk::Extent2D extent;
+        vk::Format format = vk::Format::eUndefined;
+    };
+
+    // what happened to an imported image before the graph, first barrier waits for it
+    struct ExternalImageState
+    {
+        vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+        vk::PipelineStageFlags2 stageMask = vk::PipelineStageFlagBits2::eNone;
+        vk::AccessFlags2 accessMask = vk::AccessFlagBits2::eNone;
+    };
+
+    class PassBuilder
+    {
+    public:
+        PassBuilder& read(ResourceHandle resource, ImageUsage usage);
+        PassBuilder& write(ResourceHandle resource, ImageUsage usage);
+
+        // pass is never culled, e.g. it writes something graph doesn't know about
+        PassBuilder& sideEffects();
+
+    private:
+        friend class VulkanRenderGraph;
+        PassBuilder(VulkanRenderGraph& graph, std::uint32_t passIndex);
+
+        VulkanRenderGraph& m_graph;
+        std::uint32_t m_passIndex;
+    };
+
+public:
+    VulkanRenderGraph() = default;
+
+    void destroy() noexcept;
+
+    // starts a new frame, physical transient images are kept for reuse
+    void reset();
+
+    // image is transitioned to finalLayout after the last pass using it
+    ResourceHandle importImage(std::string name, vk::Image image, vk::ImageView imageView,
+                               vk::ImageAspectFlags aspectMask, const ExternalImageState& initialState,
+                               vk::ImageLayout finalLayout);
+    ResourceHandle createImage(std::string name, const TransientImageDesc& desc);
+
+    PassBuilder addPass(std::string name, ExecuteFunction execute);
+
+    // Records all passes that contribute to imported images. resourceSet picks physical transient
+    // images, GPU must be done with everything previously recorded with the same set
+    void execute(vk::CommandBuffer commandBuffer, std::uint32_t resourceSet, const vk::DispatchLoaderDynamic& dispatch);
+
+    // only valid inside of pass execute functions
+    NODISCARD vk::ImageView getImageView(ResourceHandle resource) const;
+    NODISCARD vk::Image getImage(ResourceHandle resource) const;
+
+private:
+    static constexpr std::uint32_t s_unused = std::numeric_limits<std::uint32_t>::max();
+
+    struct ResourceAccess
+    {
+        ResourceHandle resource;
+        ImageUsage usage;
+        bool write;
+    };
+
+    struct Pass
+    {
+        std::string name;
+        ExecuteFunction execute;
+        std::vector<ResourceAccess> accesses;
+        bool sideEffects = false;
+        bool culled = false;
+    };
+
+    struct Resource
+    {
+        std::string name;
+        bool imported = false;
+        vk::ImageAspectFlags aspectMask;
+
+        // imported only
+        vk::Image image = VK_NULL_HANDLE;
+        vk::ImageView imageView = VK_NULL_HANDLE;
+        ExternalImageState initialState;
+        vk::ImageLayout finalLayout = vk::ImageLayout::eUndefined;
+
+        // transient only
+        TransientImageDesc desc;
+        vk::ImageUsageFlags usageFlags;
+
+        // lifetime in live passes
+        std::uint32_t firstPass = s_unused;
+        std::uint32_t lastPass = s_unused;
+    };
+
+    // physical transient image together with what it was created for
+    struct TransientImage
+    {
+        vk::Extent2D extent;
+        vk::Format format = vk::Format::eUndefined;
+        vk::ImageUsageFlags usageFlags;
+        std::uint32_t firstPass = s_unused;
+        std::uint32_t lastPass = s_unused;
+
+        vk::Image image = VK_NULL_HANDLE;
+        vk::ImageView imageView = VK_NULL_HANDLE;
+        // previous image placed into the same memory, its last use must finish before the first use of this one
+        ResourceHandle aliasedAfter = s_unused;
+
+        bool operator==(const TransientImage& other) const
+        {
+            return extent == other.extent && format == other.format && usageFlags == other.usageFlags &&
+                   firstPass == other.firstPass && lastPass == other.lastPass;
+        }
+    };
+
+    struct ResourceSet
+    {
+        // indexed by resource handle, empty for imported and unused resources
+        std::vector<TransientImage> images;
+        std::vector<VmaAllocation> allocations;
+    };
+
+    // synchronization state of an image while passes are recorded
+    struct ResourceState
+    {
+        vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+        vk::PipelineStageFlags2 writeStages;
+        vk::AccessFlags2 writeAccess;
+        vk::PipelineStageFlags2 readStages;
+        // stages that already see the last write or layout transition
+        vk::PipelineStageFlags2 visibleStages;
+        bool written = false;
+    };
+
+    struct UsageState
+    {
+        vk::PipelineStageFlags2 stageMask;
+        vk::AccessFlags2 accessMask;
+        vk::ImageLayout layout;
+        vk::ImageUsageFlags usageFlags;
+    };
+
+    static UsageState GetUsageState(ImageUsage usage, bool write);
+    static vk::ImageAspectFlags GetAspectMask(vk::Format format);
+
+    void addAccess(std::uint32_t passIndex, ResourceHandle resource, ImageUsage usage, bool write);
+
+    void cullPasses();
+    void computeLifetimes();
+
+    // creates physical images of the set unless ones from a previous frame still fit
+    void realizeTransients(ResourceSet& resourceSet);
+    void assignMemory(ResourceSet& resourceSet, const std::vector<ResourceHandle>& transients,
+                      const std::vector<vk::MemoryRequirements>& requirements);
+    static void RetireResourceSet(ResourceSet& resourceSet);
+
+    static void RecordBarriers(vk::CommandBuffer commandBuffer, const std::vector<vk::ImageMemoryBarrier2>& barriers,
+                               const vk::DispatchLoaderDynamic& dispatch);
+    void addBarrier(std::vector<vk::ImageMemoryBarrier2>& barriers, ResourceHandle resource,
+                    const UsageState& usage, bool write);
+
+private:
+    std::vector<Pass> m_passes;
+    std::vector<Resource> m_resources;
+
+    std::vector<ResourceSet> m_resourceSets;
+    std::vector<ResourceState> m_states;
+    const ResourceSet* m_currentSet = nullptr;
+};
+
+#endif //VULKANRENDERGRAPH_H
@@ -1,311 +1,496 @@
 #include "VulkanRenderPipeline.h"
 
-#include <fstream>
+#include <algorithm>
+#include <chrono>
 #include <ios>
 #include <vulkan/vulkan_enums.hpp>
 
+#include <spdlog/spdlog.h>
+
+#include "VulkanConfig.h"
 #include "VulkanContext.h"
 #include "VulkanBuffers.h"
+#include "glfw/GLFWContext.h"
+#include "utility/CpuProfiler.h"
 
-void VulkanRenderPipeline::createPipeline()
+namespace
 {
-    vk::ShaderModule vertexShaderModule = createShaderModule(readFile("shaders/triangle.vert.spv"));
-    vk::ShaderModule fragmentShaderModule = createShaderModule(readFile("shaders/triangle.frag.spv"));
-
-    vk::PipelineShaderStageCreateInfo vertexShaderStageCreateInfo = {
-        .sType = vk::StructureType::ePipelineShaderStageCreateInfo,
-        .pNext = nullptr,
-        .flags = vk::PipelineShaderStageCreateFlags(),
-        .stage = vk::ShaderStageFlagBits::eVertex,
-        .module = vertexShaderModule,
-        .pName = "main",
-        .pSpecializationInfo = nullptr
-    };
-
-    vk::PipelineShaderStageCreateInfo fragmentShaderStageCreateInfo = {
-        .sType = vk::StructureType::ePipelineShaderStageCreateInfo,
-        .pNext = nullptr,
-        .flags = vk::PipelineShaderStageCreateFlags(),
-        .stage = vk::ShaderStageFlagBits::eFragment,
-        .module = fragmentShaderModule,
-        .pName = "main",
-        .pSpecializationInfo = nullptr
-    };
-
-    vk::PipelineShaderStageCreateInfo shaderStages[] = {
-        vertexShaderStageCreateInfo,
-        fragmentShaderStageCreateInfo
-    };
-
-    std::vector dynamicStates = {
-        vk::DynamicState::eScissor,
-        vk::DynamicState::eViewport
+    // matches constant_id declarations in triangle.vert
+    struct TriangleVertexConstants
+    {
+        vk::Bool32 useVertexColor = VK_TRUE;
     };
+}
 
-    vk::PipelineDynamicStateCreateInfo dynamicStateInfo = {
-        .sType = vk::StructureType::ePipelineDynamicStateCreateInfo,
-        .pNext = nullptr,
-        .flags = vk::PipelineDynamicStateCreateFlags(),
-        .dynamicStateCount = static_cast<std::uint32_t>(dynamicStates.size()),
-        .pDynamicStates = dynamicStates.data()
+void VulkanRenderPipeline::createPipeline()
+{
+    VulkanGraphicsPipelineDesc desc = {
+        .vertexShader = "triangle.vert",
+        .fragmentShader = "triangle.frag",
+        .vertexSpecialization = VulkanSpecialization::From(TriangleVertexConstants{}),
+        .colorFormats = {VulkanContext::GetRenderTarget().getFormat()},
+        .colorBlendAttachments = {VulkanGraphicsPipelineDesc::AlphaBlendAttachment()}
     };
 
-    auto bindingDescription = VulkanVertex::GetBindingDescription();
-    auto attributeDescriptions = VulkanVertex::GetAttributeDescriptions();
+    VulkanPipelineRegistry& registry = VulkanContext::GetPipelineRegistry();
+    registry.applyReflection(desc);
 
-    vk::PipelineVertexInputStateCreateInfo vertexInputInfo = {
-        .sType = vk::StructureType::ePipelineVertexInputStateCreateInfo,
-        .pNext = nullptr,
-        .flags = vk::PipelineVertexInputStateCreateFlags(),
-        .vertexBindingDescriptionCount = 1,
-        .pVertexBindingDescriptions = &bindingDescription,
-        .vertexAttributeDescriptionCount = attributeDescriptions.size(),
-        .pVertexAttributeDescriptions = attributeDescriptions.data()
-    };
+    // vertex buffer layout is not in the shader, reflection assumes tightly packed attributes
+    ASSERT(desc.vertexBindings.size() == 1 && desc.vertexBindings.front().stride == sizeof(VulkanVertex) &&
+           "VulkanVertex doesn't match inputs of triangle.vert!");
 
-    vk::PipelineInputAssemblyStateCreateInfo inputAssemblyInfo = {
-        .sType = vk::StructureType::ePipelineInputAssemblyStateCreateInfo,
-        .pNext = nullptr,
-        .flags = vk::PipelineInputAssemblyStateCreateFlags(),
-        .topology = vk::PrimitiveTopology::eTriangleList,
-        .primitiveRestartEnable = VK_FALSE
-    };
+    m_pipelineLayout = registry.getPipelineLayout(desc.layout);
+    m_trianglePipeline = registry.getPipeline(desc);
+}
 
-    vk::PipelineViewportStateCreateInfo viewportInfo = {
-        .sType = vk::StructureType::ePipelineViewportStateCreateInfo,
-        .pNext = nullptr,
-        .flags = vk::PipelineViewportStateCreateFlags(),
-        .viewportCount = 1,
-        .pViewports = nullptr, // not specifying it here because of dynamic state
-        .scissorCount = 1,
-        .pScissors = nullptr
-    };
+void VulkanRenderPipeline::init(std::uint32_t framesInFlight)
+{
+    createPipeline();
+    createScene();
+    createFrameContexts(framesInFlight);
+    createRenderFinishedSemaphores();
+    createCommandCache();
+}
 
-    vk::PipelineRasterizationStateCreateInfo rasterizationInfo = {
-        .sType = vk::StructureType::ePipelineRasterizationStateCreateInfo,
-        .pNext = nullptr,
-        .flags = vk::PipelineRasterizationStateCreateFlags(),
-        .depthClampEnable = VK_FALSE,
-        .rasterizerDiscardEnable = VK_FALSE,
-        .polygonMode = vk::PolygonMode::eFill,
-        .cullMode = vk::CullModeFlagBits::eBack,
-        .frontFace = vk::FrontFace::eClockwise,
-        .depthBiasEnable = VK_FALSE,
-        .depthBiasConstantFactor = 0.0f,
-        .depthBiasClamp = 0.0f,
-        .depthBiasSlopeFactor = 0.0f,
-        .lineWidth = 1.0f
+void VulkanRenderPipeline::createScene()
+{
+    const std::vector<VulkanVertex> vertices = {
+        {{-0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}},
+        {{0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}},
+        {{0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}},
+        {{-0.5f, 0.5f}, {1.0f, 1.0f, 1.0f}}
     };
 
-    vk::PipelineMultisampleStateCreateInfo multisamplingInfo = {
-        .sType = vk::StructureType::ePipelineMultisampleStateCreateInfo,
-        .pNext = nullptr,
-        .flags = vk::PipelineMultisampleStateCreateFlags(),
-        .rasterizationSamples = vk::SampleCountFlagBits::e1,
-        .sampleShadingEnable = VK_FALSE,
-        .minSampleShading = 1.0f,
-        .pSampleMask = nullptr,
-        .alphaToCoverageEnable = VK_FALSE,
-        .alphaToOneEnable = VK_FALSE
+    const std::vector<VulkanGeometryArena::IndexType> indices = {
+        0, 1, 2, 2, 3, 0
     };
 
-    vk::PipelineColorBlendAttachmentState pipelineColorBlendAttachmentState = {
-        .blendEnable = VK_TRUE,
-        .srcColorBlendFactor = vk::BlendFactor::eSrcAlpha,
-        .dstColorBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha,
-        .colorBlendOp = vk::BlendOp::eAdd,
-        .srcAlphaBlendFactor = vk::BlendFactor::eOne,
-        .dstAlphaBlendFactor = vk::BlendFactor::eZero,
-        .alphaBlendOp = vk::BlendOp::eAdd,
-        .colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
-                          vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA
-    };
+    // whole scene is uploaded with one submission, vertices and indices must outlive it
+    VulkanUploader::Batch uploadBatch;
+    m_quadMesh = VulkanContext::GetGeometryArena().addMesh(uploadBatch, vertices, indices);
+    VulkanContext::GetUploader().submit(uploadBatch);
 
-    vk::PipelineColorBlendStateCreateInfo colorBlendInfo = {
-        .sType = vk::StructureType::ePipelineColorBlendStateCreateInfo,
-        .pNext = nullptr,
-        .flags = vk::PipelineColorBlendStateCreateFlags(),
-        .logicOpEnable = VK_FALSE,
-        .logicOp = vk::LogicOp::eCopy,
-        .attachmentCount = 1,
-        .pAttachments = &pipelineColorBlendAttachmentState,
-        .blendConstants = vk::ArrayWrapper1D<float, 4>{}
-    };
+    buildDrawCommands();
+}
 
-    vk::PipelineLayoutCreateInfo layoutInfo = {
-        .sType = vk::StructureType::ePipelineLayoutCreateInfo,
-        .pNext = nullptr,
-        .flags = vk::PipelineLayoutCreateFlags(),
-        .setLayoutCount = 0,
-        .pSetLayouts = nullptr,
-        .pushConstantRangeCount = 0,
-        .pPushConstantRanges = nullptr
-    };
+void VulkanRenderPipeline::buildDrawCommands()
+{
+    const VulkanGeometryArena& geometryArena = VulkanContext::GetGeometryArena();
+    const VulkanGeometryArena::DrawRange quadRange = geometryArena.getDrawRange(m_quadMesh);
 
-    m_pipelineLayout = VulkanContext::GetLogicalDevice().createPipelineLayout(layoutInfo);
-
-    vk::Format swapchainFormat = VulkanContext::GetSwapchain().getFormat();
-
-    vk::PipelineRenderingCreateInfo pipelineRenderingCreateInfo{};
-    pipelineRenderingCreateInfo.setColorAttachmentCount(1);
-    pipelineRenderingCreateInfo.setPColorAttachmentFormats(&swapchainFormat);
-
-    vk::GraphicsPipelineCreateInfo pipelineCreateInfo = {
-        .sType = vk::StructureType::eGraphicsPipelineCreateInfo,
-        .pNext = &pipelineRenderingCreateInfo,
-        .flags = vk::PipelineCreateFlags(),
-        .stageCount = 2,
-        .pStages = shaderStages,
-        .pVertexInputState = &vertexInputInfo,
-        .pInputAssemblyState = &inputAssemblyInfo,
-        .pTessellationState = nullptr,
-        .pViewportState = &viewportInfo,
-        .pRasterizationState = &rasterizationInfo,
-        .pMultisampleState = &multisamplingInfo,
-        .pDepthStencilState = nullptr,
-        .pColorBlendState = &colorBlendInfo,
-        .pDynamicState = &dynamicStateInfo,
-        .layout = m_pipelineLayout,
-        .renderPass = VK_NULL_HANDLE, // render pass is not required cause we're using dynamic rendering
-        .subpass = 0,
-        .basePipelineHandle = VK_NULL_HANDLE,
-        .basePipelineIndex = -1
+    m_drawCommands = {
+        {
+            .vertexBuffer = geometryArena.getVertexBuffer(),
+            .indexBuffer = geometryArena.getIndexBuffer(),
+            .indexType = geometryArena.getIndexType(),
+            .firstIndex = quadRange.firstIndex,
+            .vertexOffset = quadRange.vertexOffset,
+            .indexCount = quadRange.indexCount,
+            .pipeline = m_trianglePipeline,
+            .upload = geometryArena.getUploadToken(m_quadMesh)
+        }
     };
+    m_sceneGeneration = geometryArena.getGeneration();
 
-
-    m_graphicsPipeline = VulkanContext::GetLogicalDevice().createGraphicsPipeline(VK_NULL_HANDLE, pipelineCreateInfo).
-            value;
-
-    VulkanContext::GetLogicalDevice().destroyShaderModule(vertexShaderModule);
-    VulkanContext::GetLogicalDevice().destroyShaderModule(fragmentShaderModule);
-}
-
-void VulkanRenderPipeline::init()
-{
-    createPipeline();
-    createCommandBuffer();
-    createSyncObjects();
+    invalidateCommandCache();
 }
 
 void VulkanRenderPipeline::destroy() noexcept
 {
     const vk::Device device = VulkanContext::GetLogicalDevice();
+    const vk::DispatchLoaderDynamic& dispatch = VulkanContext::GetDispatch();
 
     // wait until operations on gpu finish
-    device.waitIdle();
+    device.waitIdle(dispatch);
+    // presents are not covered by that and may still wait on render finished semaphores
+    if (!VulkanContext::IsHeadless())
+    {
+        VulkanContext::GetSwapchain().waitForPresents();
+    }
 
-    device.destroySemaphore(m_imageAvailableSemaphore);
-    device.destroySemaphore(m_renderFinishedSemaphore);
-    device.destroyFence(m_inFlightFence);
-    device.destroyPipeline(m_graphicsPipeline);
-    device.destroyPipelineLayout(m_pipelineLayout);
+    m_renderGraph.destroy();
+    destroyCommandCache();
+    destroyRenderFinishedSemaphores();
+    destroyFrameContexts();
+    m_drawCommands.clear();
+    // scene meshes are released together with the geometry arena
+    // pipeline and its layout belong to the registry
+    m_trianglePipeline = {};
+    m_pipelineLayout = VK_NULL_HANDLE;
 }
 
 void VulkanRenderPipeline::drawFrame()
 {
+    CPU_PROFILE_ZONE("drawFrame");
+
     const vk::Device device = VulkanContext::GetLogicalDevice();
-    VulkanSwapchain& swapchain = VulkanContext::GetSwapchain();
+    VulkanTimeline& timeline = VulkanContext::GetDevice().getGraphicsTimeline();
+    FrameContext& frame = m_frames[m_currentFrame];
+
+    {
+        CPU_PROFILE_ZONE("wait frame slot");
+        // only waits for the frame that used this slot framesInFlight frames ago
+        timeline.wait(frame.timelineValue);
+        VulkanContext::GetDevice().getDeletionQueue().collect(timeline.getCompletedValue());
+    }
+
+    // finished uploads become visible to this frame's submission
+    VulkanContext::GetUploader().update();
+    if (VulkanContext::GetGeometryArena().getGeneration() != m_sceneGeneration)
+    {
+        buildDrawCommands();
+    }
+
+    std::uint32_t imageIndex;
+    if (VulkanContext::IsHeadless())
+    {
+        // offscreen target has an image per frame slot, so it's already free
+        imageIndex = m_currentFrame;
+    }
+    else if (!acquireSwapchainImage(frame, imageIndex))
+    {
+        return;
+    }
+
+    // frame is going to be recorded and submitted for sure, its previous timestamps are ready
+    VulkanContext::GetGpuProfiler().beginFrame(m_currentFrame);
+    VulkanContext::GetFrameAllocator().beginFrame(m_currentFrame);
+
+    vk::CommandBuffer commandBuffer;
+    if (VulkanContext::GetConfig().cacheCommandBuffers)
+    {
+        commandBuffer = getCachedCommandBuffer(imageIndex);
+    }
+    else
+    {
+        CPU_PROFILE_ZONE("record");
+        device.resetCommandPool(frame.commandPool, vk::CommandPoolResetFlags(), VulkanContext::GetDispatch());
+        recordCommandBuffer(frame.commandBuffer, imageIndex, m_currentFrame);
+        commandBuffer = frame.commandBuffer;
+    }
+
+    VulkanContext::GetFrameAllocator().flush();
+
+    const auto submitTime = VulkanPresentLatencyTracker::Clock::now();
+    submitFrame(frame, imageIndex, commandBuffer);
+
+    if (VulkanContext::GetConfig().cacheCommandBuffers)
+    {
+        m_commandCache[imageIndex].timelineValue = frame.timelineValue;
+    }
+
+    if (!VulkanContext::IsHeadless())
+    {
+        presentFrame(imageIndex, submitTime);
+    }
 
-    vk::Result result = device.waitForFences(1, &m_inFlightFence, VK_TRUE, std::numeric_limits<uint64_t>::max());
-    ASSERT(result == vk::Result::eSuccess && "waitForFences finished with non success result!")
+    m_currentFrame = (m_currentFrame + 1) % static_cast<std::uint32_t>(m_frames.size());
+}
 
-    result = device.resetFences(1, &m_inFlightFence);
-    ASSERT(result == vk::Result::eSuccess && "resetFences finished with non success result!")
+bool VulkanRenderPipeline::acquireSwapchainImage(const FrameContext& frame, std::uint32_t& imageIndex)
+{
+    CPU_PROFILE_ZONE("acquire");
+
+    if (m_swapchainOutdated && !recreateSwapchain())
+    {
+        // surface has zero extent, nothing to render to
+        return false;
+    }
 
     std::uint64_t timeout = std::numeric_limits<std::uint64_t>::max();
-    std::uint32_t imageIndex = swapchain.acquireNextImage(timeout, m_imageAvailableSemaphore, VK_NULL_HANDLE);
+    vk::Result acquireResult = VulkanContext::GetSwapchain().acquireNextImage(
+        timeout, frame.imageAvailableSemaphore, VK_NULL_HANDLE, imageIndex);
+
+    if (acquireResult == vk::Result::eErrorOutOfDateKHR)
+    {
+        // semaphore is left unsignaled, so the frame can be retried with a new swapchain
+        m_swapchainOutdated = true;
+        return false;
+    }
 
-    m_commandBuffer.reset(vk::CommandBufferResetFlags());
-    recordCommandBuffer(m_commandBuffer, imageIndex);
+    // suboptimal image is still rendered and presented, swapchain is rebuilt on the next frame
+    if (acquireResult == vk::Result::eSuboptimalKHR)
+    {
+        m_swapchainOutdated = true;
+    }
+
+    return true;
+}
+
+void VulkanRenderPipeline::submitFrame(FrameContext& frame, std::uint32_t imageIndex, vk::CommandBuffer commandBuffer)
+{
+    CPU_PROFILE_ZONE("submit");
+
+    VulkanTimeline& timeline = VulkanContext::GetDevice().getGraphicsTimeline();
+    const bool presenting = !VulkanContext::IsHeadless();
 
     vk::Semaphore waitSemaphores[] = {
-        m_imageAvailableSemaphore
+        frame.imageAvailableSemaphore
     };
 
     vk::PipelineStageFlags waitStages[] = {
         vk::PipelineStageFlagBits::eColorAttachmentOutput
     };
 
+    frame.timelineValue = timeline.nextSignalValue();
+
+    // render finished semaphore is only needed to present
+    std::vector<vk::Semaphore> signalSemaphores = {
+        timeline.getHandle()
+    };
+
+    std::vector<std::uint64_t> signalValues = {
+        frame.timelineValue
+    };
+
+    if (presenting)
+    {
+        signalSemaphores.push_back(m_renderFinishedSemaphores[imageIndex]);
+        // value for binary semaphore is ignored
+        signalValues.push_back(0);
+    }
+
+    vk::TimelineSemaphoreSubmitInfo timelineSubmitInfo = {
+        .sType = vk::StructureType::eTimelineSemaphoreSubmitInfo,
+        .pNext = nullptr,
+        .waitSemaphoreValueCount = 0,
+        .pWaitSemaphoreValues = nullptr,
+        .signalSemaphoreValueCount = static_cast<std::uint32_t>(signalValues.size()),
+        .pSignalSemaphoreValues = signalValues.data()
+    };
+
     vk::SubmitInfo submitInfo = {
         .sType = vk::StructureType::eSubmitInfo,
-        .pNext = nullptr,
-        .waitSemaphoreCount = 1,
+        .pNext = &timelineSubmitInfo,
+        .waitSemaphoreCount = presenting ? 1u : 0u,
         .pWaitSemaphores = waitSemaphores,
         .pWaitDstStageMask = waitStages,
         .commandBufferCount = 1,
-        .pCommandBuffers = &m_commandBuffer,
-        .signalSemaphoreCount = 1,
-        .pSignalSemaphores = &m_renderFinishedSemaphore
+        .pCommandBuffers = &commandBuffer,
+        .signalSemaphoreCount = static_cast<std::uint32_t>(signalSemaphores.size()),
+        .pSignalSemaphores = signalSemaphores.data()
     };
 
-    VulkanContext::GetDevice().getQueues().graphicsQueue.submit(submitInfo, m_inFlightFence);
+    VulkanContext::GetDevice().getQueues().graphicsQueue.submit(submitInfo, VK_NULL_HANDLE, VulkanContext::GetDispatch());
+}
+
+void VulkanRenderPipeline::presentFrame(std::uint32_t imageIndex, VulkanPresentLatencyTracker::Clock::time_point submitTime)
+{
+    CPU_PROFILE_ZONE("present");
+
+    VulkanSwapchain& swapchain = VulkanContext::GetSwapchain();
+    vk::Semaphore renderFinishedSemaphore = m_renderFinishedSemaphores[imageIndex];
 
     vk::SwapchainKHR swapchains[] = {
-        VulkanContext::GetSwapchain().getHandle()
+        swapchain.getHandle()
+    };
+
+    VulkanPresentLatencyTracker& latencyTracker = swapchain.getPresentLatencyTracker();
+
+    const std::uint64_t presentId = latencyTracker.isEnabled() ? latencyTracker.nextPresentId() : 0;
+    vk::PresentIdKHR presentIdInfo = {
+        .sType = vk::StructureType::ePresentIdKHR,
+        .pNext = nullptr,
+        .swapchainCount = 1,
+        .pPresentIds = &presentId
+    };
+
+    // tells when the present is done with the semaphore and the swapchain, see retireAfterPresents()
+    const vk::Fence presentFence = swapchain.nextPresentFence();
+    vk::SwapchainPresentFenceInfoEXT presentFenceInfo = {
+        .sType = vk::StructureType::eSwapchainPresentFenceInfoEXT,
+        .pNext = latencyTracker.isEnabled() ? &presentIdInfo : nullptr,
+        .swapchainCount = 1,
+        .pFences = &presentFence
     };
 
     vk::PresentInfoKHR presentInfo = {
         .sType = vk::StructureType::ePresentInfoKHR,
-        .pNext = nullptr,
+        .pNext = presentFence ? static_cast<const void *>(&presentFenceInfo) : presentFenceInfo.pNext,
         .waitSemaphoreCount = 1,
-        .pWaitSemaphores = &m_renderFinishedSemaphore,
+        .pWaitSemaphores = &renderFinishedSemaphore,
         .swapchainCount = 1,
         .pSwapchains = swapchains,
         .pImageIndices = &imageIndex,
         .pResults = nullptr
     };
 
-    result = VulkanContext::GetDevice().getQueues().presentQueue.presentKHR(presentInfo);
-    ASSERT(result == vk::Result::eSuccess && "Frame present finished with non success result!");
+    // pointer overload doesn't throw on eErrorOutOfDateKHR
+    vk::Result result;
+    {
+        auto swapchainLock = latencyTracker.lockSwapchain();
+        result = VulkanContext::GetDevice().getQueues().presentQueue.presentKHR(&presentInfo, VulkanContext::GetDispatch());
+    }
+    latencyTracker.onPresented(swapchains[0], presentId, submitTime);
+    ASSERT((result == vk::Result::eSuccess ||
+            result == vk::Result::eSuboptimalKHR ||
+            result == vk::Result::eErrorOutOfDateKHR) && "Frame present finished with unexpected result!");
+
+    if (result != vk::Result::eSuccess || GLFWContext::Get().consumeFramebufferResized())
+    {
+        m_swapchainOutdated = true;
+    }
 }
 
-std::vector<char> VulkanRenderPipeline::readFile(const std::string& filename)
+void VulkanRenderPipeline::requestSwapchainRecreation()
 {
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
+    m_swapchainOutdated = true;
+}
 
-    if (!file.is_open())
+bool VulkanRenderPipeline::recreateSwapchain()
+{
+    if (!VulkanContext::GetSwapchain().recreate())
+        return false;
+
+    // presents of old swapchain images may still wait on these semaphores,
+    // retire them together with the old swapchain
+    VulkanContext::GetSwapchain().retireAfterPresents([semaphores = std::move(m_renderFinishedSemaphores)]() {
+        for (const vk::Semaphore semaphore : semaphores)
+        {
+            VulkanContext::GetLogicalDevice().destroySemaphore(semaphore, nullptr, VulkanContext::GetDispatch());
+        }
+    });
+    m_renderFinishedSemaphores.clear();
+
+    createRenderFinishedSemaphores();
+    resizeCommandCache();
+    invalidateCommandCache();
+
+    m_swapchainOutdated = false;
+    return true;
+}
+
+void VulkanRenderPipeline::setFramesInFlight(std::uint32_t framesInFlight)
+{
+    if (framesInFlight == m_frames.size())
+        return;
+
+    waitForFramesInFlight();
+    destroyFrameContexts();
+    createFrameContexts(framesInFlight);
+
+    // query pools and transient data are per frame slot as well
+    VulkanContext::GetGpuProfiler().destroy();
+    VulkanContext::GetGpuProfiler().init(framesInFlight);
+    VulkanContext::GetFrameAllocator().destroy();
+    VulkanContext::GetFrameAllocator().init(VulkanContext::GetConfig().frameAllocatorSize, framesInFlight);
+
+    if (VulkanContext::IsHeadless())
     {
-        throw std::runtime_error("Failed to open file " + filename);
+        VulkanContext::GetOffscreenTarget().setImageCount(framesInFlight);
+        resizeCommandCache();
+        invalidateCommandCache();
     }
+}
 
-    std::size_t fileSize = file.tellg();
-    std::vector<char> buffer(fileSize);
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-    file.close();
+std::uint32_t VulkanRenderPipeline::getFramesInFlight() const
+{
+    return static_cast<std::uint32_t>(m_frames.size());
+}
+
+void VulkanRenderPipeline::createFrameContexts(std::uint32_t count)
+{
+    if (count < VulkanConfig::MinFramesInFlight || count > VulkanConfig::MaxFramesInFlight)
+    {
+        throw std::runtime_error(fmt::format("Frames in flight count must be in range [{}, {}], got {}",
+            VulkanConfig::MinFramesInFlight, VulkanConfig::MaxFramesInFlight, count));
+    }
+
+    const vk::Device device = VulkanContext::GetLogicalDevice();
+    const vk::DispatchLoaderDynamic& dispatch = VulkanContext::GetDispatch();
+    const std::uint32_t graphicsFamily = VulkanContext::GetDevice().getQueueFamilyIndices().graphicsFamily.value();
 
-    return buffer;
+    m_frames.resize(count);
+    for (FrameContext& frame : m_frames)
+    {
+        vk::CommandPoolCreateInfo commandPoolCreateInfo = {
+            .sType = vk::StructureType::eCommandPoolCreateInfo,
+            .pNext = nullptr,
+            .flags = vk::CommandPoolCreateFlagBits::eTransient,
+            .queueFamilyIndex = graphicsFamily
+        };
+        frame.commandPool = device.createCommandPool(commandPoolCreateInfo, nullptr, dispatch);
+
+        vk::CommandBufferAllocateInfo commandBufferAllocateInfo = {
+            .sType = vk::StructureType::eCommandBufferAllocateInfo,
+            .pNext = nullptr,
+            .commandPool = frame.commandPool,
+            .level = vk::CommandBufferLevel::ePrimary,
+            .commandBufferCount = 1
+        };
+        frame.commandBuffer = device.allocateCommandBuffers(commandBufferAllocateInfo, dispatch).front();
+
+        frame.imageAvailableSemaphore = device.createSemaphore(vk::SemaphoreCreateInfo(), nullptr, dispatch);
+
+        // zero value is always reached, so first wait for the frame doesn't block
+        frame.timelineValue = 0;
+    }
+
+    m_currentFrame = 0;
+    spdlog::info("Using {} frames in flight", count);
+
+    // worker pools are per frame in flight as well
+    m_parallelRecorder.init(VulkanContext::GetConfig().recordingThreads, count);
 }
 
-void VulkanRenderPipeline::createCommandBuffer()
+void VulkanRenderPipeline::destroyFrameContexts() noexcept
 {
-    vk::CommandBufferAllocateInfo commandBufferAllocateInfo = {
-        .sType = vk::StructureType::eCommandBufferAllocateInfo,
-        .pNext = nullptr,
-        .commandPool = VulkanContext::GetDevice().getCommandPool(),
-        .level = vk::CommandBufferLevel::ePrimary,
-        .commandBufferCount = 1
-    };
+    const vk::Device device = VulkanContext::GetLogicalDevice();
+    const vk::DispatchLoaderDynamic& dispatch = VulkanContext::GetDispatch();
+
+    m_parallelRecorder.destroy();
 
-    m_commandBuffer = VulkanContext::GetLogicalDevice().allocateCommandBuffers(commandBufferAllocateInfo).front();
+    for (const FrameContext& frame : m_frames)
+    {
+        device.destroySemaphore(frame.imageAvailableSemaphore, nullptr, dispatch);
+        // command buffer is freed together with its pool
+        device.destroyCommandPool(frame.commandPool, nullptr, dispatch);
+    }
+    m_frames.clear();
 }
 
-void VulkanRenderPipeline::createSyncObjects()
+void VulkanRenderPipeline::createRenderFinishedSemaphores()
 {
-    m_imageAvailableSemaphore = VulkanContext::GetLogicalDevice().createSemaphore(vk::SemaphoreCreateInfo());
-    m_renderFinishedSemaphore = VulkanContext::GetLogicalDevice().createSemaphore(vk::SemaphoreCreateInfo());
+    // nothing is presented in headless mode
+    if (VulkanContext::IsHeadless())
+        return;
 
-    // need to create the fence in signaled state to avoid endless blocking
-    // when waiting for it for the first time (when no payload is sent to GPU)
-    vk::FenceCreateInfo inFlightFenceCreateInfo = {
-        .sType = vk::StructureType::eFenceCreateInfo,
-        .pNext = nullptr,
-        .flags = vk::FenceCreateFlagBits::eSignaled
-    };
-    m_inFlightFence = VulkanContext::GetLogicalDevice().createFence(inFlightFenceCreateInfo);
+    const vk::Device device = VulkanContext::GetLogicalDevice();
+    const vk::DispatchLoaderDynamic& dispatch = VulkanContext::GetDispatch();
+
+    m_renderFinishedSemaphores.resize(VulkanContext::GetSwapchain().getImageCount());
+    for (vk::Semaphore& semaphore : m_renderFinishedSemaphores)
+    {
+        semaphore = device.createSemaphore(vk::SemaphoreCreateInfo(), nullptr, dispatch);
+    }
+}
+
+void VulkanRenderPipeline::destroyRenderFinishedSemaphores() noexcept
+{
+    const vk::Device device = VulkanContext::GetLogicalDevice();
+    const vk::DispatchLoaderDynamic& dispatch = VulkanContext::GetDispatch();
+
+    for (const vk::Semaphore semaphore : m_renderFinishedSemaphores)
+    {
+        device.destroySemaphore(semaphore, nullptr, dispatch);
+    }
+    m_renderFinishedSemaphores.clear();
 }
 
-void VulkanRenderPipeline::recordCommandBuffer(vk::CommandBuffer commandBuffer, std::uint32_t imageIndex)
+void VulkanRenderPipeline::waitForFramesInFlight()
+{
+    std::uint64_t lastFrameValue = 0;
+    for (const FrameContext& frame : m_frames)
+    {
+        lastFrameValue = std::max(lastFrameValue, frame.timelineValue);
+    }
+
+    // single host wait covers every frame in the ring
+    VulkanContext::GetDevice().getGraphicsTimeline().wait(lastFrameValue);
+}
+
+void VulkanRenderPipeline::recordCommandBuffer(vk::CommandBuffer commandBuffer, std::uint32_t imageIndex,
+                                               std::uint32_t frameIndex)
 {
     vk::CommandBufferBeginInfo beginInfo = {
         .sType = vk::StructureType::eCommandBufferBeginInfo,
@@ -314,31 +499,54 @@ void VulkanRenderPipeline::recordCommandBuffer(vk::CommandBuffer commandBuffer,
         .pInheritanceInfo = nullptr
     };
 
-    commandBuffer.begin(beginInfo);
+    const vk::DispatchLoaderDynamic& dispatch = VulkanContext::GetDispatch();
 
-    vk::ImageMemoryBarrier colorAttachmentBarrier = {
-        .sType = vk::StructureType::eImageMemoryBarrier,
-        .pNext = nullptr,
-        .srcAccessMask = vk::AccessFlags(),
-        .dstAccessMask = vk::AccessFlagBits::eColorAttachmentWrite,
-        .oldLayout = vk::ImageLayout::eUndefined,
-        .newLayout = vk::ImageLayout::eColorAttachmentOptimal,
-        .image = VulkanContext::GetSwapchain().getImage(imageIndex),
-        .subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)
-    };
+    commandBuffer.begin(beginInfo, dispatch);
+
+    const VulkanRenderTarget& renderTarget = VulkanContext::GetRenderTarget();
 
-    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput,
-                                  vk::PipelineStageFlagBits::eColorAttachmentOutput,
-                                  vk::DependencyFlags(),
-                                  {},
-                                  {},
-                                  {colorAttachmentBarrier}
-    );
+    m_renderGraph.reset();
+
+    // previous contents are not needed, and acquire semaphore is waited on at color attachment output,
+    // so the first barrier has to start from that stage
+    const VulkanRenderGraph::ResourceHandle target = m_renderGraph.importImage(
+        "render target",
+        renderTarget.getImage(imageIndex),
+        renderTarget.getImageView(imageIndex),
+        vk::ImageAspectFlagBits::eColor,
+        {
+            .layout = vk::ImageLayout::eUndefined,
+            .stageMask = vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+            .accessMask = vk::AccessFlagBits2::eNone
+        },
+        renderTarget.getFinalLayout());
+
+    m_renderGraph.addPass("scene", [this, target, frameIndex](vk::CommandBuffer passCommandBuffer) {
+            recordScenePass(passCommandBuffer, m_renderGraph.getImageView(target), frameIndex);
+        })
+        .write(target, VulkanRenderGraph::ImageUsage::ColorAttachment);
+
+    // every cached command buffer is only resubmitted after its previous submission is done,
+    // so it may own a set of transient images just as a frame slot does
+    const std::uint32_t resourceSet = VulkanContext::GetConfig().cacheCommandBuffers ? imageIndex : frameIndex;
+    {
+        VulkanGpuProfiler::Scope frameScope(VulkanContext::GetGpuProfiler(), commandBuffer, "frame");
+        m_renderGraph.execute(commandBuffer, resourceSet, dispatch);
+    }
+
+    commandBuffer.end(dispatch);
+}
+
+void VulkanRenderPipeline::recordScenePass(vk::CommandBuffer commandBuffer, vk::ImageView targetView,
+                                           std::uint32_t frameIndex)
+{
+    const vk::DispatchLoaderDynamic& dispatch = VulkanContext::GetDispatch();
+    const VulkanRenderTarget& renderTarget = VulkanContext::GetRenderTarget();
 
     vk::RenderingAttachmentInfo colorAttachmentInfo = {
         .sType = vk::StructureType::eRenderingAttachmentInfo,
         .pNext = nullptr,
-        .imageView = VulkanContext::GetSwapchain().getImageView(imageIndex),
+        .imageView = targetView,
         .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
         .resolveMode = vk::ResolveModeFlagBits::eNone,
         .resolveImageView = VK_NULL_HANDLE,
@@ -348,13 +556,17 @@ void VulkanRenderPipeline::recordCommandBuffer(vk::CommandBuffer commandBuffer,
         .clearValue = { vk::ClearColorValue(std::array{0.0f, 0.0f, 0.0f, 0.0f}) }
     };
 
-    const vk::Extent2D swapchainExtent = VulkanContext::GetSwapchain().getExtent();
+    const vk::Extent2D targetExtent = renderTarget.getExtent();
+    // secondaries live in per-frame pools that are reset every frame, so cached
+    // command buffers can't reference them. Recording them is rare anyway
+    const bool recordInParallel = m_parallelRecorder.isEnabled() && !VulkanContext::GetConfig().cacheCommandBuffers;
 
     vk::RenderingInfo renderingInfo = {
         .sType = vk::StructureType::eRenderingInfo,
         .pNext = nullptr,
-        .flags = vk::RenderingFlags(),
-        .renderArea = {0, 0, swapchainExtent.width, swapchainExtent.height},
+        .flags = recordInParallel ? vk::RenderingFlags(vk::RenderingFlagBits::eContentsSecondaryCommandBuffers)
+                                  : vk::RenderingFlags(),
+        .renderArea = {0, 0, targetExtent.width, targetExtent.height},
         .layerCount = 1,
         .viewMask = 0,
         .colorAttachmentCount = 1,
@@ -363,81 +575,312 @@ void VulkanRenderPipeline::recordCommandBuffer(vk::CommandBuffer commandBuffer,
         .pStencilAttachment = nullptr
     };
 
-    const vk::DispatchLoaderDynamic dldi(VulkanContext::GetVulkanInstance(), vkGetInstanceProcAddr);
+    commandBuffer.beginRendering(renderingInfo, dispatch);
 
-    commandBuffer.beginRendering(renderingInfo, dldi);
-    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_graphicsPipeline);
+    const auto drawCount = static_cast<std::uint32_t>(m_drawCommands.size());
+    if (recordInParallel)
+    {
+        const vk::Format colorFormat = renderTarget.getFormat();
+
+        // must match the rendering begun above
+        const vk::CommandBufferInheritanceRenderingInfo inheritanceRenderingInfo = {
+            .sType = vk::StructureType::eCommandBufferInheritanceRenderingInfo,
+            .pNext = nullptr,
+            .flags = vk::RenderingFlags(),
+            .viewMask = 0,
+            .colorAttachmentCount = 1,
+            .pColorAttachmentFormats = &colorFormat,
+            .depthAttachmentFormat = vk::Format::eUndefined,
+            .stencilAttachmentFormat = vk::Format::eUndefined,
+            .rasterizationSamples = vk::SampleCountFlagBits::e1
+        };
+
+        std::vector<vk::CommandBuffer> secondaryCommandBuffers = m_parallelRecorder.record(
+            frameIndex, inheritanceRenderingInfo, drawCount,
+            [this, &dispatch](vk::CommandBuffer secondary, std::uint32_t first, std::uint32_t last) {
+                recordDraws(secondary, std::span(m_drawCommands).subspan(first, last - first), dispatch);
+            });
+
+        commandBuffer.executeCommands(secondaryCommandBuffers, dispatch);
+    }
+    else
+    {
+        recordDraws(commandBuffer, m_drawCommands, dispatch);
+    }
 
+    commandBuffer.endRendering(dispatch);
+}
 
+void VulkanRenderPipeline::invalidateCommandCache()
+{
+    for (CachedCommandBuffer& cached : m_commandCache)
+    {
+        cached.valid = false;
+    }
+}
+
+void VulkanRenderPipeline::createCommandCache()
+{
+    if (!VulkanContext::GetConfig().cacheCommandBuffers)
+        return;
+
+    vk::CommandPoolCreateInfo commandPoolCreateInfo = {
+        .sType = vk::StructureType::eCommandPoolCreateInfo,
+        .pNext = nullptr,
+        .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+        .queueFamilyIndex = VulkanContext::GetDevice().getQueueFamilyIndices().graphicsFamily.value()
+    };
+
+    m_commandCachePool = VulkanContext::GetLogicalDevice().createCommandPool(
+        commandPoolCreateInfo, nullptr, VulkanContext::GetDispatch());
+    resizeCommandCache();
+}
+
+void VulkanRenderPipeline::destroyCommandCache() noexcept
+{
+    // command buffers are freed together with the pool
+    VulkanContext::GetLogicalDevice().destroyCommandPool(m_commandCachePool, nullptr, VulkanContext::GetDispatch());
+    m_commandCachePool = VK_NULL_HANDLE;
+    m_commandCache.clear();
+}
+
+void VulkanRenderPipeline::resizeCommandCache()
+{
+    if (!m_commandCachePool)
+        return;
+
+    const vk::Device device = VulkanContext::GetLogicalDevice();
+    const vk::DispatchLoaderDynamic& dispatch = VulkanContext::GetDispatch();
+    const std::uint32_t imageCount = VulkanContext::GetRenderTarget().getImageCount();
+
+    if (imageCount < m_commandCache.size())
+    {
+        // Extra buffers may still be pending. They are freed right away instead of through the deletion
+        // queue, which could run after the pool is destroyed. Image count only shrinks on swapchain
+        // recreation, so the wait is rare and almost always already satisfied
+        std::vector<vk::CommandBuffer> extraCommandBuffers;
+        std::uint64_t lastUse = 0;
+        for (std::size_t i = imageCount; i < m_commandCache.size(); ++i)
+        {
+            extraCommandBuffers.push_back(m_commandCache[i].commandBuffer);
+            lastUse = std::max(lastUse, m_commandCache[i].timelineValue);
+        }
+
+        VulkanContext::GetDevice().getGraphicsTimeline().wait(lastUse);
+        device.freeCommandBuffers(m_commandCachePool, extraCommandBuffers, dispatch);
+
+        m_commandCache.resize(imageCount);
+    }
+
+    while (m_commandCache.size() < imageCount)
+    {
+        vk::CommandBufferAllocateInfo commandBufferAllocateInfo = {
+            .sType = vk::StructureType::eCommandBufferAllocateInfo,
+            .pNext = nullptr,
+            .commandPool = m_commandCachePool,
+            .level = vk::CommandBufferLevel::ePrimary,
+            .commandBufferCount = 1
+        };
+
+        m_commandCache.push_back({
+            .commandBuffer = device.allocateCommandBuffers(commandBufferAllocateInfo, dispatch).front(),
+            .timelineValue = 0,
+            .valid = false
+        });
+    }
+}
+
+vk::CommandBuffer VulkanRenderPipeline::getCachedCommandBuffer(std::uint32_t imageIndex)
+{
+    CachedCommandBuffer& cached = m_commandCache[imageIndex];
+
+    // Image is not re-acquired before its previous frame is done rendering, but command buffer
+    // must not be pending at resubmission either. Almost always the value is already reached
+    VulkanContext::GetDevice().getGraphicsTimeline().wait(cached.timelineValue);
+
+    if (!cached.valid)
+    {
+        CPU_PROFILE_ZONE("record cached");
+        cached.commandBuffer.reset(vk::CommandBufferResetFlags(), VulkanContext::GetDispatch());
+        m_skippedPendingDraws = false;
+        recordCommandBuffer(cached.commandBuffer, imageIndex, m_currentFrame);
+        // recorded without pipelines that are still compiling, record again once they are ready
+        cached.valid = !m_skippedPendingDraws;
+    }
+
+    return cached.commandBuffer;
+}
+
+template <typename Dispatch>
+void VulkanRenderPipeline::recordDraws(vk::CommandBuffer commandBuffer, std::span<const DrawCommand> draws,
+                                       const Dispatch& dispatch) const
+{
+    const vk::Extent2D targetExtent = VulkanContext::GetRenderTarget().getExtent();
+
+    // dynamic state is not inherited by secondary command buffers, so every command buffer sets it on its own
     const vk::Viewport viewport = {
         .x = 0,
         .y = 0,
-        .width = static_cast<float>(swapchainExtent.width),
-        .height = static_cast<float>(swapchainExtent.height),
+        .width = static_cast<float>(targetExtent.width),
+        .height = static_cast<float>(targetExtent.height),
         .minDepth = 0.0f,
         .maxDepth = 1.0f
     };
 
-    commandBuffer.setViewport(0, 1, &viewport);
+    commandBuffer.setViewport(0, 1, &viewport, dispatch);
 
     const vk::Rect2D scissor = {
         .offset = {0, 0},
-        .extent = swapchainExtent
+        .extent = targetExtent
     };
 
-    commandBuffer.setScissor(0, 1, &scissor);
+    commandBuffer.setScissor(0, 1, &scissor, dispatch);
 
-    static VulkanVertexBuffer vertexBuffer = {
+    // nor is bound pipeline, so the first draw of every command buffer binds it. Meshes share
+    // geometry buffers, so those are only rebound when they change too
+    vk::Pipeline boundPipeline = VK_NULL_HANDLE;
+    vk::Buffer boundVertexBuffer = VK_NULL_HANDLE;
+    vk::Buffer boundIndexBuffer = VK_NULL_HANDLE;
+    for (const DrawCommand& draw : draws)
+    {
+        // pipeline that is still compiling and has no fallback is skipped instead of waited for,
+        // and so is geometry that is still being uploaded
+        const vk::Pipeline pipeline = draw.pipeline.get();
+        if (!pipeline || !draw.upload.isReady())
         {
-            {{-0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}},
-            {{0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}},
-            {{0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}},
-            {{-0.5f, 0.5f}, {1.0f, 1.0f, 1.0f}}
+            m_skippedPendingDraws.store(true, std::memory_order_relaxed);
+            continue;
         }
-    };
 
-    static VulkanIndexBuffer indexBuffer = {
-        {0, 1, 2, 2, 3, 0}
+        if (pipeline != boundPipeline)
+        {
+            commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline, dispatch);
+            boundPipeline = pipeline;
+        }
+
+        if (draw.vertexBuffer != boundVertexBuffer)
+        {
+            const vk::DeviceSize offset = 0;
+            commandBuffer.bindVertexBuffers(0, 1, &draw.vertexBuffer, &offset, dispatch);
+            boundVertexBuffer = draw.vertexBuffer;
+        }
+        if (draw.indexBuffer != boundIndexBuffer)
+        {
+            commandBuffer.bindIndexBuffer(draw.indexBuffer, 0, draw.indexType, dispatch);
+            boundIndexBuffer = draw.indexBuffer;
+        }
+
+        commandBuffer.drawIndexed(draw.indexCount, 1, draw.firstIndex, draw.vertexOffset, 0, dispatch);
+    }
+}
+
+void VulkanRenderPipeline::benchmarkDispatch(std::uint32_t drawCount)
+{
+    constexpr int iterations = 20;
+
+    const vk::Device device = VulkanContext::GetLogicalDevice();
+    const VulkanRenderTarget& renderTarget = VulkanContext::GetRenderTarget();
+
+    // the same quad over and over, recording cost doesn't depend on what is drawn
+    const std::vector<DrawCommand> draws(drawCount, m_drawCommands.front());
+    // pending pipeline or geometry would skip every draw and measure nothing
+    m_trianglePipeline.wait();
+    draws.front().upload.wait();
+
+    vk::CommandPoolCreateInfo commandPoolCreateInfo = {
+        .sType = vk::StructureType::eCommandPoolCreateInfo,
+        .pNext = nullptr,
+        .flags = vk::CommandPoolCreateFlagBits::eTransient,
+        .queueFamilyIndex = VulkanContext::GetDevice().getQueueFamilyIndices().graphicsFamily.value()
     };
-    
-    commandBuffer.bindVertexBuffers(0, {vertexBuffer.getHandle()}, {0});
-    commandBuffer.bindIndexBuffer(indexBuffer.getHandle(), 0, indexBuffer.getIndexType());
-    commandBuffer.drawIndexed(indexBuffer.getIndexCount(), 1, 0, 0, 0);
 
-    commandBuffer.endRendering();
+    const vk::CommandPool commandPool = device.createCommandPool(
+        commandPoolCreateInfo, nullptr, VulkanContext::GetDispatch());
 
-    // prepare image for presentation
-    vk::ImageMemoryBarrier presentationBarier = {
-        .sType = vk::StructureType::eImageMemoryBarrier,
+    vk::CommandBufferAllocateInfo commandBufferAllocateInfo = {
+        .sType = vk::StructureType::eCommandBufferAllocateInfo,
         .pNext = nullptr,
-        .srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite,
-        .dstAccessMask = vk::AccessFlags(),
-        .oldLayout = vk::ImageLayout::eColorAttachmentOptimal,
-        .newLayout = vk::ImageLayout::ePresentSrcKHR,
-        .image = VulkanContext::GetSwapchain().getImage(imageIndex),
-        .subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)
+        .commandPool = commandPool,
+        .level = vk::CommandBufferLevel::ePrimary,
+        .commandBufferCount = 1
     };
 
-    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput,
-                                  vk::PipelineStageFlagBits::eBottomOfPipe,
-                                  vk::DependencyFlags(),
-                                  {},
-                                  {},
-                                  {presentationBarier}
-    );
+    const vk::CommandBuffer commandBuffer = device.allocateCommandBuffers(
+        commandBufferAllocateInfo, VulkanContext::GetDispatch()).front();
 
-    commandBuffer.end();
-}
+    const vk::CommandBufferBeginInfo beginInfo = {
+        .sType = vk::StructureType::eCommandBufferBeginInfo,
+        .pNext = nullptr,
+        .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+        .pInheritanceInfo = nullptr
+    };
 
-vk::ShaderModule VulkanRenderPipeline::createShaderModule(const std::vector<char>& code)
-{
-    const vk::ShaderModuleCreateInfo createInfo = {
-        .sType = vk::StructureType::eShaderModuleCreateInfo,
+    const vk::RenderingAttachmentInfo colorAttachmentInfo = {
+        .sType = vk::StructureType::eRenderingAttachmentInfo,
         .pNext = nullptr,
-        .flags = {},
-        .codeSize = code.size(),
-        .pCode = reinterpret_cast<const std::uint32_t *>(code.data())
+        .imageView = renderTarget.getImageView(0),
+        .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
+        .resolveMode = vk::ResolveModeFlagBits::eNone,
+        .resolveImageView = VK_NULL_HANDLE,
+        .resolveImageLayout = vk::ImageLayout::eUndefined,
+        .loadOp = vk::AttachmentLoadOp::eDontCare,
+        .storeOp = vk::AttachmentStoreOp::eDontCare,
+        .clearValue = {}
+    };
+
+    const vk::Extent2D targetExtent = renderTarget.getExtent();
+    const vk::RenderingInfo renderingInfo = {
+        .sType = vk::StructureType::eRenderingInfo,
+        .pNext = nullptr,
+        .flags = vk::RenderingFlags(),
+        .renderArea = {0, 0, targetExtent.width, targetExtent.height},
+        .layerCount = 1,
+        .viewMask = 0,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &colorAttachmentInfo,
+        .pDepthAttachment = nullptr,
+        .pStencilAttachment = nullptr
+    };
+
+    // command buffer is never submitted, so only CPU side of recording is measured.
+    // Best of several runs filters out page faults of the first recording
+    auto measure = [&](const auto& recordFrame) {
+        double bestNsPerDraw = std::numeric_limits<double>::max();
+        for (int i = 0; i < iterations; ++i)
+        {
+            device.resetCommandPool(commandPool, vk::CommandPoolResetFlags(), VulkanContext::GetDispatch());
+
+            const auto start = std::chrono::steady_clock::now();
+            recordFrame();
+            const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+            bestNsPerDraw = std::min(bestNsPerDraw, elapsed.count() / static_cast<double>(drawCount));
+        }
+        return bestNsPerDraw;
     };
 
-    return VulkanContext::GetLogicalDevice().createShaderModule(createInfo);
+    // previous recording path: loader trampolines and a dispatcher built every frame for beginRendering
+    const double trampolineNs = measure([&]() {
+        const vk::DispatchLoaderDynamic dldi(VulkanContext::GetVulkanInstance(), vkGetInstanceProcAddr);
+        commandBuffer.begin(beginInfo);
+        commandBuffer.beginRendering(renderingInfo, dldi);
+        recordDraws(commandBuffer, draws, VULKAN_HPP_DEFAULT_DISPATCHER);
+        commandBuffer.endRendering();
+        commandBuffer.end();
+    });
+
+    const double deviceTableNs = measure([&]() {
+        const vk::DispatchLoaderDynamic& dispatch = VulkanContext::GetDispatch();
+        commandBuffer.begin(beginInfo, dispatch);
+        commandBuffer.beginRendering(renderingInfo, dispatch);
+        recordDraws(commandBuffer, draws, dispatch);
+        commandBuffer.endRendering(dispatch);
+        commandBuffer.end(dispatch);
+    });
+
+    device.destroyCommandPool(commandPool, nullptr, VulkanContext::GetDispatch());
+
+    spdlog::info("Dispatch benchmark, {} draws: loader trampolines {:.1f} ns per draw, "
+                 "device dispatch table {:.1f} ns per draw ({:.2f}x)",
+                 drawCount, trampolineNs, deviceTableNs, trampolineNs / deviceTableNs);
 }
@@ -1,44 +1,145 @@
 #ifndef VULKANRENDERPIPELINE_H
 #define VULKANRENDERPIPELINE_H
+#include <atomic>
+#include <memory>
+#include <span>
 #include <string>
 #include <vector>
 #include <utility/Utility.h>
 
 #include <vulkan/vulkan.hpp>
 
+#include "VulkanBuffers.h"
+#include "VulkanGeometryArena.h"
+#include "VulkanParallelRecorder.h"
+#include "VulkanPipelineCompiler.h"
+#include "VulkanPresentLatencyTracker.h"
+#include "VulkanRenderGraph.h"
+#include "VulkanUploader.h"
+
 
 class VulkanRenderPipeline {
 public:
+    // everything CPU needs to record one frame while GPU is still busy with the previous ones
+    struct FrameContext
+    {
+        // per-frame scratch pool, reset as a whole once the frame has retired
+        vk::CommandPool commandPool = VK_NULL_HANDLE;
+        vk::CommandBuffer commandBuffer = VK_NULL_HANDLE;
+
+        vk::Semaphore imageAvailableSemaphore = VK_NULL_HANDLE;
+
+        // graphics timeline value signaled by the last submission of this frame
+        std::uint64_t timelineValue = 0;
+    };
+
+    struct CachedCommandBuffer
+    {
+        vk::CommandBuffer commandBuffer = VK_NULL_HANDLE;
+        // graphics timeline value of the last submission that used the buffer
+        std::uint64_t timelineValue = 0;
+        bool valid = false;
+    };
+
+    struct DrawCommand
+    {
+        vk::Buffer vertexBuffer = VK_NULL_HANDLE;
+        vk::Buffer indexBuffer = VK_NULL_HANDLE;
+        vk::IndexType indexType = vk::IndexType::eUint16;
+        // range of the mesh in shared geometry buffers
+        std::uint32_t firstIndex = 0;
+        std::int32_t vertexOffset = 0;
+        std::uint32_t indexCount = 0;
+        // draw is skipped while the pipeline is compiling, unless it has a fallback
+        VulkanPipelineCompiler::Handle pipeline;
+        // and while its geometry is being uploaded
+        VulkanUploader::Token upload;
+    };
 
-    void init();
+public:
+    void init(std::uint32_t framesInFlight);
     void destroy() noexcept;
 
     void drawFrame();
 
+    // waits for frames that are still in flight, then rebuilds the frame ring
+    void setFramesInFlight(std::uint32_t framesInFlight);
+    NODISCARD std::uint32_t getFramesInFlight() const;
+
+    // swapchain is rebuilt at the beginning of the next frame, e.g. after present policy change
+    void requestSwapchainRecreation();
+
+    // cached command buffers are re-recorded before their next use, e.g. after scene change
+    void invalidateCommandCache();
+
+    // records the scene repeated drawCount times without submitting it, logs CPU time per draw
+    void benchmarkDispatch(std::uint32_t drawCount);
+
     // TODO: use different command pools for different purposes
     NODISCARD vk::CommandPool getCommandPool() const;
 
 private:
-    std::vector<char> readFile(const std::string& filename);
-
     void createPipeline();
-    void createCommandBuffer();
-    void createSyncObjects();
-
-    void recordCommandBuffer(vk::CommandBuffer commandBuffer, std::uint32_t imageIndex);
-
-    vk::ShaderModule createShaderModule(const std::vector<char>& code);
+    void createScene();
+    // draw ranges move when geometry arena is defragmented
+    void buildDrawCommands();
+    void createFrameContexts(std::uint32_t count);
+    void destroyFrameContexts() noexcept;
+    void createRenderFinishedSemaphores();
+    void destroyRenderFinishedSemaphores() noexcept;
+    void waitForFramesInFlight();
+
+    // returns false if swapchain can't be recreated right now
+    bool recreateSwapchain();
+
+    // returns false if the frame should be skipped
+    bool acquireSwapchainImage(const FrameContext& frame, std::uint32_t& imageIndex);
+    void submitFrame(FrameContext& frame, std::uint32_t imageIndex, vk::CommandBuffer commandBuffer);
+    void presentFrame(std::uint32_t imageIndex, VulkanPresentLatencyTracker::Clock::time_point submitTime);
+
+    void recordCommandBuffer(vk::CommandBuffer commandBuffer, std::uint32_t imageIndex, std::uint32_t frameIndex);
+    void recordScenePass(vk::CommandBuffer commandBuffer, vk::ImageView targetView, std::uint32_t frameIndex);
+
+    void createCommandCache();
+    void destroyCommandCache() noexcept;
+    // matches cache size to render target image count
+    void resizeCommandCache();
+    // returns command buffer for the image, re-recording it only if it was invalidated
+    vk::CommandBuffer getCachedCommandBuffer(std::uint32_t imageIndex);
+
+    // records draw commands inside of already begun rendering
+    template <typename Dispatch>
+    void recordDraws(vk::CommandBuffer commandBuffer, std::span<const DrawCommand> draws, const Dispatch& dispatch) const;
 
 private:
+    // owned by pipeline registry
     vk::PipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
-    vk::Pipeline m_graphicsPipeline = VK_NULL_HANDLE;
+    VulkanPipelineCompiler::Handle m_trianglePipeline;
+
+    std::vector<FrameContext> m_frames;
+    std::uint32_t m_currentFrame = 0;
+
+    VulkanParallelRecorder m_parallelRecorder;
+
+    // rebuilt by every recording, keeps transient images between frames
+    VulkanRenderGraph m_renderGraph;
+
+    // pre-recorded command buffers indexed by render target image
+    vk::CommandPool m_commandCachePool = VK_NULL_HANDLE;
+    std::vector<CachedCommandBuffer> m_commandCache;
+
+    VulkanGeometryArena::MeshId m_quadMesh = 0;
+    // geometry arena generation draw commands were built for
+    std::uint64_t m_sceneGeneration = 0;
+    std::vector<DrawCommand> m_drawCommands;
+    // set by recordDraws when a draw had no pipeline or geometry to use yet, may be set from recording threads
+    mutable std::atomic<bool> m_skippedPendingDraws = false;
 
-    vk::CommandBuffer  m_commandBuffer;
+    // one per swapchain image: semaphore can't be reused until the present that waits on it
+    // is done, and that is only guaranteed once the same image is acquired again
+    std::vector<vk::Semaphore> m_renderFinishedSemaphores;
 
-    // syncronization
-    vk::Semaphore m_imageAvailableSemaphore;
-    vk::Semaphore m_renderFinishedSemaphore;
-    vk::Fence m_inFlightFence;
+    bool m_swapchainOutdated = false;
 };
 
 
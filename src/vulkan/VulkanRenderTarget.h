@@ -0,0 +1,26 @@
+#ifndef VULKANRENDERTARGET_H
+#define VULKANRENDERTARGET_H
+
+#include <cstdint>
+
+#include <vulkan/vulkan.hpp>
+
+#include "utility/Utility.h"
+
+// Set of color images frames are rendered into, either swapchain images or offscreen ones
+class VulkanRenderTarget
+{
+public:
+    virtual ~VulkanRenderTarget() = default;
+
+    NODISCARD virtual vk::Extent2D getExtent() const = 0;
+    NODISCARD virtual vk::Format getFormat() const = 0;
+    NODISCARD virtual vk::ImageView getImageView(std::uint32_t index) const = 0;
+    NODISCARD virtual vk::Image getImage(std::uint32_t index) const = 0;
+    NODISCARD virtual std::uint32_t getImageCount() const = 0;
+
+    // layout the image is left in at the end of a frame
+    NODISCARD virtual vk::ImageLayout getFinalLayout() const = 0;
+};
+
+#endif //VULKANRENDERTARGET_H
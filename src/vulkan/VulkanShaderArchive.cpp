@@ -0,0 +1,143 @@
+#include "VulkanShaderArchive.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include "utility/Hash.h"
+
+#ifdef EMBED_SHADER_ARCHIVE
+// generated by ShaderPacker embed
+extern const std::uint8_t EmbeddedShaderArchive[];
+extern const std::size_t EmbeddedShaderArchiveSize;
+#endif
+
+namespace
+{
+    constexpr char Magic[4] = {'S', 'P', 'V', 'A'};
+    constexpr std::uint32_t Version = 2;
+    constexpr std::size_t HeaderSize = 4 * sizeof(std::uint32_t);
+    constexpr std::size_t IndexEntrySize = 6 * sizeof(std::uint32_t);
+    constexpr std::uint32_t SpirvMagic = 0x07230203;
+
+    static_assert(std::endian::native == std::endian::little, "Shader archive is read in place, host must be little-endian");
+
+    std::uint32_t ReadU32(std::span<const std::byte> data, std::size_t offset)
+    {
+        std::uint32_t value;
+        std::memcpy(&value, data.data() + offset, sizeof(value));
+        return value;
+    }
+
+    // same as the packer computes, bytes of the key without its length
+    std::uint64_t HashKey(std::string_view key)
+    {
+        Hasher hasher;
+        hasher.addBytes(key.data(), key.size());
+        return hasher.get();
+    }
+}
+
+void VulkanShaderArchive::init(const std::string& filename)
+{
+#ifdef EMBED_SHADER_ARCHIVE
+    parse({reinterpret_cast<const std::byte *>(EmbeddedShaderArchive), EmbeddedShaderArchiveSize}, "embedded archive");
+#else
+    m_file = MappedFile(filename);
+    parse(m_file.getData(), filename);
+#endif
+
+    spdlog::info("Shader archive: {} shader variants", m_entries.size());
+}
+
+void VulkanShaderArchive::destroy() noexcept
+{
+    m_entries.clear();
+    m_file = MappedFile();
+}
+
+std::span<const std::uint32_t> VulkanShaderArchive::getCode(std::string_view key) const
+{
+    const std::uint64_t hash = HashKey(key);
+    const auto it = std::lower_bound(m_entries.begin(), m_entries.end(), hash,
+                                     [](const Entry& entry, std::uint64_t value) { return entry.hash < value; });
+
+    // packer rejects colliding keys, so comparing the key only guards against asking for a missing one
+    if (it == m_entries.end() || it->hash != hash || it->key != key)
+    {
+        throw std::runtime_error(fmt::format("Shader {} is not in the archive", key));
+    }
+
+    return it->code;
+}
+
+std::string VulkanShaderArchive::VariantKey(std::string_view name,
+                                            std::vector<std::pair<std::string, std::string>> defines)
+{
+    std::sort(defines.begin(), defines.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    std::string key(name);
+    for (const auto& [define, value] : defines)
+    {
+        key += '|';
+        key += define;
+        key += '=';
+        key += value;
+    }
+    return key;
+}
+
+void VulkanShaderArchive::parse(std::span<const std::byte> data, const std::string& source)
+{
+    auto fail = [&source](const char* reason) {
+        return std::runtime_error(fmt::format("Invalid shader archive {}: {}", source, reason));
+    };
+
+    if (data.size() < HeaderSize || std::memcmp(data.data(), Magic, sizeof(Magic)) != 0)
+        throw fail("bad magic");
+    if (ReadU32(data, 4) != Version)
+        throw fail("unsupported version");
+
+    const std::uint32_t entryCount = ReadU32(data, 8);
+    if (HeaderSize + static_cast<std::size_t>(entryCount) * IndexEntrySize > data.size())
+        throw fail("index is out of bounds");
+
+    m_entries.clear();
+    m_entries.reserve(entryCount);
+    for (std::uint32_t i = 0; i < entryCount; ++i)
+    {
+        const std::size_t entryOffset = HeaderSize + i * IndexEntrySize;
+        const std::uint64_t hash = ReadU32(data, entryOffset + 0) |
+                                   static_cast<std::uint64_t>(ReadU32(data, entryOffset + 4)) << 32;
+        const std::size_t keyOffset = ReadU32(data, entryOffset + 8);
+        const std::size_t keyLength = ReadU32(data, entryOffset + 12);
+        const std::size_t dataOffset = ReadU32(data, entryOffset + 16);
+        const std::size_t dataSize = ReadU32(data, entryOffset + 20);
+
+        if (keyOffset + keyLength > data.size() || dataOffset + dataSize > data.size())
+            throw fail("entry is out of bounds");
+
+        // base is page aligned when mapped and 16 byte aligned when embedded, so words are read in place
+        const std::byte* code = data.data() + dataOffset;
+        if (reinterpret_cast<std::uintptr_t>(code) % alignof(std::uint32_t) != 0 || dataSize % sizeof(std::uint32_t) != 0)
+            throw fail("misaligned shader code");
+
+        const Entry entry = {
+            .hash = hash,
+            .key = {reinterpret_cast<const char *>(data.data() + keyOffset), keyLength},
+            .code = {reinterpret_cast<const std::uint32_t *>(code), dataSize / sizeof(std::uint32_t)}
+        };
+
+        if (entry.code.empty() || entry.code.front() != SpirvMagic)
+            throw fail("entry is not SPIR-V");
+        if (HashKey(entry.key) != entry.hash)
+            throw fail("key hash mismatch");
+        if (!m_entries.empty() && !(m_entries.back().hash < entry.hash))
+            throw fail("index is not sorted");
+
+        m_entries.push_back(entry);
+    }
+}
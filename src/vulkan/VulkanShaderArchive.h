@@ -0,0 +1,63 @@
+#ifndef VULKANSHADERARCHIVE_H
+#define VULKANSHADERARCHIVE_H
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "utility/MappedFile.h"
+#include "utility/NonCopyable.h"
+#include "utility/NonMovable.h"
+#include "utility/Utility.h"
+
+// All SPIR-V of the application in one file, packed by shaders/packer at build time.
+// Archive is memory mapped or compiled into the executable, and shader code is handed out
+// as word spans pointing straight into it.
+//
+// Every permutation of a shader is a separate entry, looked up by its variant key: source file
+// name followed by the defines it was compiled with, e.g. "triangle.frag|LIGHT_COUNT=4|USE_FOG=1".
+// Shaders without variant axes are stored under their file name alone.
+//
+// Layout, all integers are little-endian u32:
+//   header   magic "SPVA", version, entry count, reserved
+//   index    entry count times {key hash low, key hash high, key offset, key length, data offset, data size},
+//            sorted by the 64-bit FNV-1a hash of the key
+//   keys     not null terminated
+//   data     SPIR-V blobs, each starting at a 16 byte aligned offset
+class VulkanShaderArchive : NonCopyable, NonMovable
+{
+public:
+    VulkanShaderArchive() = default;
+
+    // uses the archive embedded into the executable if there is one, otherwise maps the file
+    void init(const std::string& filename);
+    void destroy() noexcept;
+
+    // throws std::runtime_error if there is no such shader. Key is made by VariantKey, or is just
+    // the source file name for shaders without variants, e.g. triangle.vert
+    NODISCARD std::span<const std::uint32_t> getCode(std::string_view key) const;
+
+    // key of the permutation of a shader compiled with given defines, in any order
+    NODISCARD static std::string VariantKey(std::string_view name,
+                                            std::vector<std::pair<std::string, std::string>> defines);
+
+private:
+    struct Entry
+    {
+        std::uint64_t hash;
+        std::string_view key;
+        std::span<const std::uint32_t> code;
+    };
+
+    void parse(std::span<const std::byte> data, const std::string& source);
+
+private:
+    MappedFile m_file;
+    // sorted by key hash, points into archive data
+    std::vector<Entry> m_entries;
+};
+
+#endif //VULKANSHADERARCHIVE_H
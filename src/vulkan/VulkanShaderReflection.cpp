@@ -0,0 +1,438 @@
+#include "VulkanShaderReflection.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <spdlog/spdlog.h>
+
+namespace
+{
+    constexpr std::uint32_t SpirvMagic = 0x07230203;
+    constexpr std::size_t HeaderWords = 5;
+
+    // subset of the SPIR-V specification that reflection needs
+    enum Op : std::uint32_t
+    {
+        OpEntryPoint = 15,
+        OpTypeBool = 20,
+        OpTypeInt = 21,
+        OpTypeFloat = 22,
+        OpTypeVector = 23,
+        OpTypeMatrix = 24,
+        OpTypeImage = 25,
+        OpTypeSampler = 26,
+        OpTypeSampledImage = 27,
+        OpTypeArray = 28,
+        OpTypeRuntimeArray = 29,
+        OpTypeStruct = 30,
+        OpTypePointer = 32,
+        OpConstant = 43,
+        OpVariable = 59,
+        OpDecorate = 71,
+        OpMemberDecorate = 72,
+        OpTypeAccelerationStructureKHR = 5341
+    };
+
+    enum Decoration : std::uint32_t
+    {
+        DecorationBlock = 2,
+        DecorationBufferBlock = 3,
+        DecorationArrayStride = 6,
+        DecorationMatrixStride = 7,
+        DecorationBuiltIn = 11,
+        DecorationLocation = 30,
+        DecorationBinding = 33,
+        DecorationDescriptorSet = 34,
+        DecorationOffset = 35
+    };
+
+    enum StorageClass : std::uint32_t
+    {
+        StorageClassUniformConstant = 0,
+        StorageClassInput = 1,
+        StorageClassUniform = 2,
+        StorageClassPushConstant = 9,
+        StorageClassStorageBuffer = 12
+    };
+
+    enum ImageDim : std::uint32_t
+    {
+        DimBuffer = 5,
+        DimSubpassData = 6
+    };
+
+    struct Type
+    {
+        std::uint32_t opcode = 0;
+        // operands after the result id
+        std::vector<std::uint32_t> operands;
+    };
+
+    struct Decorations
+    {
+        std::optional<std::uint32_t> location;
+        std::optional<std::uint32_t> binding;
+        std::optional<std::uint32_t> set;
+        std::optional<std::uint32_t> arrayStride;
+        bool block = false;
+        bool bufferBlock = false;
+        bool builtIn = false;
+    };
+
+    struct MemberDecorations
+    {
+        std::uint32_t offset = 0;
+        std::uint32_t matrixStride = 0;
+        bool builtIn = false;
+    };
+
+    struct Variable
+    {
+        std::uint32_t id;
+        std::uint32_t pointerType;
+        std::uint32_t storageClass;
+    };
+
+    class Parser
+    {
+    public:
+        explicit Parser(std::span<const std::uint32_t> code)
+        {
+            if (code.size() < HeaderWords || code[0] != SpirvMagic)
+                throw std::runtime_error("Not a SPIR-V module");
+
+            for (std::size_t i = HeaderWords; i < code.size();)
+            {
+                const std::uint32_t wordCount = code[i] >> 16;
+                const std::uint32_t opcode = code[i] & 0xffff;
+                if (wordCount == 0 || i + wordCount > code.size())
+                    throw std::runtime_error("Truncated SPIR-V instruction");
+
+                parseInstruction(opcode, code.subspan(i + 1, wordCount - 1));
+                i += wordCount;
+            }
+        }
+
+        VulkanShaderReflection reflect() const
+        {
+            VulkanShaderReflection reflection;
+            reflection.stage = m_stage;
+
+            std::uint32_t pushConstantBegin = std::numeric_limits<std::uint32_t>::max();
+            std::uint32_t pushConstantEnd = 0;
+
+            for (const Variable& variable : m_variables)
+            {
+                const std::uint32_t typeId = getType(variable.pointerType).operands.at(1);
+                const Decorations& decorations = getDecorations(variable.id);
+
+                switch (variable.storageClass)
+                {
+                case StorageClassInput:
+                    if (m_stage == vk::ShaderStageFlagBits::eVertex && !decorations.builtIn && !hasBuiltInMember(typeId))
+                    {
+                        reflection.vertexInputs.push_back(reflectVertexInput(typeId, decorations));
+                    }
+                    break;
+                case StorageClassUniformConstant:
+                case StorageClassUniform:
+                case StorageClassStorageBuffer:
+                    reflection.descriptorSets[decorations.set.value_or(0)].push_back(
+                        reflectBinding(typeId, variable.storageClass, decorations));
+                    break;
+                case StorageClassPushConstant:
+                    for (std::uint32_t member = 0; member < getType(typeId).operands.size(); ++member)
+                    {
+                        const MemberDecorations& memberDecorations = getMemberDecorations(typeId, member);
+                        pushConstantBegin = std::min(pushConstantBegin, memberDecorations.offset);
+                        pushConstantEnd = std::max(pushConstantEnd, memberDecorations.offset +
+                            getSize(getType(typeId).operands[member], memberDecorations.matrixStride));
+                    }
+                    break;
+                default:
+                    break;
+                }
+            }
+
+            std::sort(reflection.vertexInputs.begin(), reflection.vertexInputs.end(),
+                      [](const auto& a, const auto& b) { return a.location < b.location; });
+
+            for (auto& [set, bindings] : reflection.descriptorSets)
+            {
+                std::sort(bindings.begin(), bindings.end(), [](const auto& a, const auto& b) { return a.binding < b.binding; });
+            }
+
+            if (pushConstantEnd > 0)
+            {
+                reflection.pushConstants = vk::PushConstantRange{
+                    .stageFlags = m_stage,
+                    .offset = pushConstantBegin,
+                    .size = pushConstantEnd - pushConstantBegin
+                };
+            }
+
+            return reflection;
+        }
+
+    private:
+        void parseInstruction(std::uint32_t opcode, std::span<const std::uint32_t> operands)
+        {
+            switch (opcode)
+            {
+            case OpEntryPoint:
+                m_stage = ToStage(operands[0]);
+                break;
+            case OpDecorate:
+                decorate(m_decorations[operands[0]], operands[1], operands.subspan(2));
+                break;
+            case OpMemberDecorate:
+                decorateMember(m_memberDecorations[operands[0]][operands[1]], operands[2], operands.subspan(3));
+                break;
+            case OpConstant:
+                // only 32-bit constants matter, they size arrays
+                m_constants[operands[1]] = operands[2];
+                break;
+            case OpVariable:
+                m_variables.push_back({.id = operands[1], .pointerType = operands[0], .storageClass = operands[2]});
+                break;
+            case OpTypeBool:
+            case OpTypeInt:
+            case OpTypeFloat:
+            case OpTypeVector:
+            case OpTypeMatrix:
+            case OpTypeImage:
+            case OpTypeSampler:
+            case OpTypeSampledImage:
+            case OpTypeArray:
+            case OpTypeRuntimeArray:
+            case OpTypeStruct:
+            case OpTypePointer:
+            case OpTypeAccelerationStructureKHR:
+                m_types[operands[0]] = {.opcode = opcode, .operands = {operands.begin() + 1, operands.end()}};
+                break;
+            default:
+                break;
+            }
+        }
+
+        static void decorate(Decorations& decorations, std::uint32_t decoration, std::span<const std::uint32_t> literals)
+        {
+            switch (decoration)
+            {
+            case DecorationBlock: decorations.block = true; break;
+            case DecorationBufferBlock: decorations.bufferBlock = true; break;
+            case DecorationBuiltIn: decorations.builtIn = true; break;
+            case DecorationArrayStride: decorations.arrayStride = literals[0]; break;
+            case DecorationLocation: decorations.location = literals[0]; break;
+            case DecorationBinding: decorations.binding = literals[0]; break;
+            case DecorationDescriptorSet: decorations.set = literals[0]; break;
+            default: break;
+            }
+        }
+
+        static void decorateMember(MemberDecorations& decorations, std::uint32_t decoration,
+                                   std::span<const std::uint32_t> literals)
+        {
+            switch (decoration)
+            {
+            case DecorationOffset: decorations.offset = literals[0]; break;
+            case DecorationMatrixStride: decorations.matrixStride = literals[0]; break;
+            case DecorationBuiltIn: decorations.builtIn = true; break;
+            default: break;
+            }
+        }
+
+        static vk::ShaderStageFlagBits ToStage(std::uint32_t executionModel)
+        {
+            switch (executionModel)
+            {
+            case 0: return vk::ShaderStageFlagBits::eVertex;
+            case 1: return vk::ShaderStageFlagBits::eTessellationControl;
+            case 2: return vk::ShaderStageFlagBits::eTessellationEvaluation;
+            case 3: return vk::ShaderStageFlagBits::eGeometry;
+            case 4: return vk::ShaderStageFlagBits::eFragment;
+            case 5: return vk::ShaderStageFlagBits::eCompute;
+            default: throw std::runtime_error(fmt::format("Unsupported execution model {}", executionModel));
+            }
+        }
+
+        const Type& getType(std::uint32_t id) const
+        {
+            const auto it = m_types.find(id);
+            if (it == m_types.end())
+                throw std::runtime_error(fmt::format("Unknown SPIR-V type %{}", id));
+            return it->second;
+        }
+
+        const Decorations& getDecorations(std::uint32_t id) const
+        {
+            static const Decorations empty;
+            const auto it = m_decorations.find(id);
+            return it != m_decorations.end() ? it->second : empty;
+        }
+
+        const MemberDecorations& getMemberDecorations(std::uint32_t structId, std::uint32_t member) const
+        {
+            static const MemberDecorations empty;
+            const auto structIt = m_memberDecorations.find(structId);
+            if (structIt == m_memberDecorations.end())
+                return empty;
+            const auto memberIt = structIt->second.find(member);
+            return memberIt != structIt->second.end() ? memberIt->second : empty;
+        }
+
+        bool hasBuiltInMember(std::uint32_t typeId) const
+        {
+            const auto it = m_memberDecorations.find(typeId);
+            return it != m_memberDecorations.end() &&
+                   std::any_of(it->second.begin(), it->second.end(), [](const auto& member) { return member.second.builtIn; });
+        }
+
+        std::uint32_t getConstant(std::uint32_t id) const
+        {
+            const auto it = m_constants.find(id);
+            if (it == m_constants.end())
+                throw std::runtime_error("Array length is not a constant");
+            return it->second;
+        }
+
+        // byte size with explicit layout, matrixStride comes from the struct member holding the matrix
+        std::uint32_t getSize(std::uint32_t typeId, std::uint32_t matrixStride = 0) const
+        {
+            const Type& type = getType(typeId);
+            switch (type.opcode)
+            {
+            case OpTypeBool:
+                return 4;
+            case OpTypeInt:
+            case OpTypeFloat:
+                return type.operands[0] / 8;
+            case OpTypeVector:
+                return getSize(type.operands[0]) * type.operands[1];
+            case OpTypeMatrix:
+                return (matrixStride != 0 ? matrixStride : getSize(type.operands[0])) * type.operands[1];
+            case OpTypeArray:
+            {
+                const std::uint32_t stride = getDecorations(typeId).arrayStride.value_or(getSize(type.operands[0]));
+                return stride * getConstant(type.operands[1]);
+            }
+            case OpTypeStruct:
+            {
+                std::uint32_t size = 0;
+                for (std::uint32_t member = 0; member < type.operands.size(); ++member)
+                {
+                    const MemberDecorations& decorations = getMemberDecorations(typeId, member);
+                    size = std::max(size, decorations.offset + getSize(type.operands[member], decorations.matrixStride));
+                }
+                return size;
+            }
+            default:
+                throw std::runtime_error(fmt::format("Can't compute size of SPIR-V type with opcode {}", type.opcode));
+            }
+        }
+
+        VulkanShaderReflection::VertexInput reflectVertexInput(std::uint32_t typeId, const Decorations& decorations) const
+        {
+            if (!decorations.location)
+                throw std::runtime_error("Vertex input without location");
+
+            const Type& type = getType(typeId);
+            const Type& component = type.opcode == OpTypeVector ? getType(type.operands[0]) : type;
+            const std::uint32_t count = type.opcode == OpTypeVector ? type.operands[1] : 1;
+
+            if ((component.opcode != OpTypeFloat && component.opcode != OpTypeInt) || component.operands[0] != 32)
+                throw std::runtime_error(fmt::format("Vertex input at location {} is not a 32-bit scalar or vector",
+                                                     *decorations.location));
+
+            constexpr vk::Format floatFormats[] = {vk::Format::eR32Sfloat, vk::Format::eR32G32Sfloat,
+                                                   vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32B32A32Sfloat};
+            constexpr vk::Format intFormats[] = {vk::Format::eR32Sint, vk::Format::eR32G32Sint,
+                                                 vk::Format::eR32G32B32Sint, vk::Format::eR32G32B32A32Sint};
+            constexpr vk::Format uintFormats[] = {vk::Format::eR32Uint, vk::Format::eR32G32Uint,
+                                                  vk::Format::eR32G32B32Uint, vk::Format::eR32G32B32A32Uint};
+
+            const vk::Format* formats = component.opcode == OpTypeFloat ? floatFormats
+                                        : component.operands[1] != 0 ? intFormats : uintFormats;
+
+            return {
+                .location = *decorations.location,
+                .format = formats[count - 1],
+                .size = 4 * count
+            };
+        }
+
+        vk::DescriptorSetLayoutBinding reflectBinding(std::uint32_t typeId, std::uint32_t storageClass,
+                                                      const Decorations& decorations) const
+        {
+            std::uint32_t count = 1;
+            const Type* type = &getType(typeId);
+            if (type->opcode == OpTypeRuntimeArray)
+                throw std::runtime_error("Runtime descriptor arrays are not supported");
+            if (type->opcode == OpTypeArray)
+            {
+                count = getConstant(type->operands[1]);
+                typeId = type->operands[0];
+                type = &getType(typeId);
+            }
+
+            return {
+                .binding = decorations.binding.value_or(0),
+                .descriptorType = getDescriptorType(typeId, storageClass),
+                .descriptorCount = count,
+                .stageFlags = m_stage,
+                .pImmutableSamplers = nullptr
+            };
+        }
+
+        vk::DescriptorType getDescriptorType(std::uint32_t typeId, std::uint32_t storageClass) const
+        {
+            const Type& type = getType(typeId);
+
+            if (storageClass == StorageClassStorageBuffer)
+                return vk::DescriptorType::eStorageBuffer;
+            if (storageClass == StorageClassUniform)
+                return getDecorations(typeId).bufferBlock ? vk::DescriptorType::eStorageBuffer
+                                                          : vk::DescriptorType::eUniformBuffer;
+
+            switch (type.opcode)
+            {
+            case OpTypeSampler:
+                return vk::DescriptorType::eSampler;
+            case OpTypeSampledImage:
+                return getType(type.operands[0]).operands[1] == DimBuffer ? vk::DescriptorType::eUniformTexelBuffer
+                                                                          : vk::DescriptorType::eCombinedImageSampler;
+            case OpTypeImage:
+            {
+                // operands: sampled type, dim, depth, arrayed, multisampled, sampled
+                const std::uint32_t dim = type.operands[1];
+                const bool storage = type.operands[5] == 2;
+                if (dim == DimSubpassData)
+                    return vk::DescriptorType::eInputAttachment;
+                if (dim == DimBuffer)
+                    return storage ? vk::DescriptorType::eStorageTexelBuffer : vk::DescriptorType::eUniformTexelBuffer;
+                return storage ? vk::DescriptorType::eStorageImage : vk::DescriptorType::eSampledImage;
+            }
+            case OpTypeAccelerationStructureKHR:
+                return vk::DescriptorType::eAccelerationStructureKHR;
+            default:
+                throw std::runtime_error(fmt::format("Unsupported descriptor type with opcode {}", type.opcode));
+            }
+        }
+
+    private:
+        vk::ShaderStageFlagBits m_stage = vk::ShaderStageFlagBits::eVertex;
+
+        std::unordered_map<std::uint32_t, Type> m_types;
+        std::unordered_map<std::uint32_t, std::uint32_t> m_constants;
+        std::unordered_map<std::uint32_t, Decorations> m_decorations;
+        std::unordered_map<std::uint32_t, std::unordered_map<std::uint32_t, MemberDecorations>> m_memberDecorations;
+        std::vector<Variable> m_variables;
+    };
+}
+
+VulkanShaderReflection VulkanShaderReflection::Reflect(std::span<const std::uint32_t> code)
+{
+    return Parser(code).reflect();
+}
@@ -0,0 +1,39 @@
+#ifndef VULKANSHADERREFLECTION_H
+#define VULKANSHADERREFLECTION_H
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "utility/Utility.h"
+
+// Interface of a SPIR-V module: vertex inputs, descriptor bindings and push constants.
+// Parsed straight from the instruction stream, only what pipeline creation needs is looked at
+struct VulkanShaderReflection
+{
+    struct VertexInput
+    {
+        std::uint32_t location = 0;
+        vk::Format format = vk::Format::eUndefined;
+        std::uint32_t size = 0;
+    };
+
+    vk::ShaderStageFlagBits stage = vk::ShaderStageFlagBits::eVertex;
+
+    // sorted by location, only filled for vertex shaders
+    std::vector<VertexInput> vertexInputs;
+
+    // bindings by set index, sorted by binding
+    std::map<std::uint32_t, std::vector<vk::DescriptorSetLayoutBinding>> descriptorSets;
+
+    std::optional<vk::PushConstantRange> pushConstants;
+
+    // throws std::runtime_error on malformed code or on interface that can't be described
+    NODISCARD static VulkanShaderReflection Reflect(std::span<const std::uint32_t> code);
+};
+
+#endif //VULKANSHADERREFLECTION_H
@@ -0,0 +1,148 @@
+#ifndef VULKANSPECIALIZATION_H
+#define VULKANSPECIALIZATION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "utility/Utility.h"
+
+namespace VulkanSpecializationDetail
+{
+    // converts to any member type, so it can count members of an aggregate by brace initialization
+    struct AnyMember
+    {
+        template <typename T>
+        operator T() const;
+    };
+
+    template <typename T, typename... Members>
+    constexpr std::size_t MemberCount()
+    {
+        if constexpr (requires { T{Members{}..., AnyMember{}}; })
+            return MemberCount<T, Members..., AnyMember>();
+        else
+            return sizeof...(Members);
+    }
+
+    template <typename T, typename Function>
+    void ForEachMember(const T& value, Function&& function)
+    {
+        constexpr std::size_t count = MemberCount<T>();
+        static_assert(count <= 8, "Add more cases to ForEachMember");
+
+        if constexpr (count == 1)
+        {
+            const auto& [a] = value;
+            function(a);
+        }
+        else if constexpr (count == 2)
+        {
+            const auto& [a, b] = value;
+            function(a), function(b);
+        }
+        else if constexpr (count == 3)
+        {
+            const auto& [a, b, c] = value;
+            function(a), function(b), function(c);
+        }
+        else if constexpr (count == 4)
+        {
+            const auto& [a, b, c, d] = value;
+            function(a), function(b), function(c), function(d);
+        }
+        else if constexpr (count == 5)
+        {
+            const auto& [a, b, c, d, e] = value;
+            function(a), function(b), function(c), function(d), function(e);
+        }
+        else if constexpr (count == 6)
+        {
+            const auto& [a, b, c, d, e, f] = value;
+            function(a), function(b), function(c), function(d), function(e), function(f);
+        }
+        else if constexpr (count == 7)
+        {
+            const auto& [a, b, c, d, e, f, g] = value;
+            function(a), function(b), function(c), function(d), function(e), function(f), function(g);
+        }
+        else if constexpr (count == 8)
+        {
+            const auto& [a, b, c, d, e, f, g, h] = value;
+            function(a), function(b), function(c), function(d), function(e), function(f), function(g), function(h);
+        }
+    }
+}
+
+// Specialization constants of one shader stage, held by value so they can be part of a pipeline
+// description. Built from a plain struct whose members map to constant_id 0, 1, 2... in declaration
+// order. Booleans must be vk::Bool32, since that is what SPIR-V expects:
+//
+//   struct Constants { vk::Bool32 useVertexColor; std::uint32_t lightCount; };
+//   desc.fragmentSpecialization = VulkanSpecialization::From(Constants{VK_TRUE, 4});
+struct VulkanSpecialization
+{
+    std::vector<vk::SpecializationMapEntry> entries;
+    std::vector<std::byte> data;
+
+    bool operator==(const VulkanSpecialization&) const = default;
+
+    NODISCARD bool empty() const { return entries.empty(); }
+
+    // points into this object, must not outlive it
+    NODISCARD vk::SpecializationInfo getInfo() const
+    {
+        return {
+            .mapEntryCount = static_cast<std::uint32_t>(entries.size()),
+            .pMapEntries = entries.data(),
+            .dataSize = data.size(),
+            .pData = data.data()
+        };
+    }
+
+    template <typename T>
+    NODISCARD static VulkanSpecialization From(const T& constants)
+    {
+        static_assert(std::is_aggregate_v<T> && std::is_trivially_copyable_v<T>,
+                      "Specialization constants must be a plain struct");
+
+        VulkanSpecialization specialization;
+        specialization.data.resize(sizeof(T));
+        std::memcpy(specialization.data.data(), &constants, sizeof(T));
+
+        const auto* base = reinterpret_cast<const std::byte *>(&constants);
+        VulkanSpecializationDetail::ForEachMember(constants, [&](const auto& member) {
+            using Member = std::remove_cvref_t<decltype(member)>;
+            static_assert(std::is_arithmetic_v<Member> && !std::is_same_v<Member, bool>,
+                          "Specialization constant must be a scalar, use vk::Bool32 for booleans");
+
+            specialization.entries.push_back({
+                .constantID = static_cast<std::uint32_t>(specialization.entries.size()),
+                .offset = static_cast<std::uint32_t>(reinterpret_cast<const std::byte *>(&member) - base),
+                .size = sizeof(Member)
+            });
+        });
+
+        // padding bytes are not part of any constant, but they are hashed and compared
+        for (std::size_t i = 0; i < specialization.data.size(); ++i)
+        {
+            bool covered = false;
+            for (const vk::SpecializationMapEntry& entry : specialization.entries)
+            {
+                covered |= i >= entry.offset && i < entry.offset + entry.size;
+            }
+            if (!covered)
+            {
+                specialization.data[i] = std::byte{0};
+            }
+        }
+
+        return specialization;
+    }
+};
+
+#endif //VULKANSPECIALIZATION_H
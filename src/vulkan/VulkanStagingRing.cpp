@@ -0,0 +1,172 @@
+#include "VulkanStagingRing.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include "VulkanContext.h"
+
+namespace
+{
+    // every alignment a copy may ask for divides this, so aligned positions stay aligned after wrapping
+    constexpr vk::DeviceSize MaxAlignment = 256;
+
+    std::uint64_t AlignUp(std::uint64_t value, std::uint64_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+void VulkanStagingRing::init(vk::DeviceSize capacity)
+{
+    m_capacity = AlignUp(capacity, MaxAlignment);
+
+    vk::BufferCreateInfo bufferCreateInfo = {
+        .sType = vk::StructureType::eBufferCreateInfo,
+        .pNext = nullptr,
+        .flags = vk::BufferCreateFlags(),
+        .size = m_capacity,
+        .usage = vk::BufferUsageFlagBits::eTransferSrc,
+        .sharingMode = vk::SharingMode::eExclusive,
+        .queueFamilyIndexCount = 0,
+        .pQueueFamilyIndices = nullptr
+    };
+
+    VmaAllocationCreateInfo allocationCreateInfo = {};
+    allocationCreateInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+                                 VMA_ALLOCATION_CREATE_MAPPED_BIT;
+    allocationCreateInfo.usage = VMA_MEMORY_USAGE_AUTO;
+
+    VmaAllocationInfo allocationInfo;
+    VkResult result = vmaCreateBuffer(VulkanContext::GetDevice().getVmaAllocator(),
+                                      (VkBufferCreateInfo *) &bufferCreateInfo,
+                                      &allocationCreateInfo,
+                                      (VkBuffer *) &m_buffer,
+                                      &m_allocation,
+                                      &allocationInfo);
+
+    if (result != VK_SUCCESS)
+        throw std::runtime_error("Failed to create staging ring buffer!");
+
+    m_mappedData = static_cast<std::byte *>(allocationInfo.pMappedData);
+    m_head = 0;
+    m_tail = 0;
+
+    spdlog::info("Staging ring: {} KiB", m_capacity / 1024);
+}
+
+void VulkanStagingRing::destroy() noexcept
+{
+    if (m_buffer)
+    {
+        vmaDestroyBuffer(VulkanContext::GetDevice().getVmaAllocator(), m_buffer, m_allocation);
+    }
+
+    m_buffer = VK_NULL_HANDLE;
+    m_allocation = VK_NULL_HANDLE;
+    m_mappedData = nullptr;
+    m_pending.clear();
+}
+
+VulkanStagingRing::Region VulkanStagingRing::allocate(vk::DeviceSize size, vk::DeviceSize alignment)
+{
+    ASSERT(size > 0 && size <= getMaxAllocationSize() && "Staging allocation must be split into smaller chunks");
+    ASSERT(alignment > 0 && MaxAlignment % alignment == 0 && "Unsupported staging alignment");
+
+    std::unique_lock lock(m_mutex);
+
+    std::uint64_t position;
+    while (true)
+    {
+        position = AlignUp(m_head, alignment);
+
+        // region must be contiguous, the rest of the buffer is skipped if it doesn't fit before the end
+        if (position % m_capacity + size > m_capacity)
+        {
+            position = AlignUp(position, m_capacity);
+        }
+
+        if (position + size - m_tail <= m_capacity)
+            break;
+
+        ASSERT(!m_pending.empty() && "Staging ring is full without pending regions!");
+        if (m_pending.front().timeline == nullptr)
+        {
+            if (m_pending.front().owner == std::this_thread::get_id())
+            {
+                throw std::runtime_error("Staging ring is full of regions that were never submitted");
+            }
+
+            // another thread is still filling the oldest region
+            const std::uint64_t frontEnd = m_pending.front().end;
+            m_submittedCondition.wait(lock, [this, frontEnd]() {
+                return m_pending.empty() || m_pending.front().end != frontEnd || m_pending.front().timeline != nullptr;
+            });
+            continue;
+        }
+        reclaim(true);
+    }
+
+    m_head = position + size;
+    m_pending.push_back({m_head, nullptr, 0, std::this_thread::get_id()});
+    reclaim(false);
+
+    const vk::DeviceSize offset = position % m_capacity;
+    return {
+        .buffer = m_buffer,
+        .offset = offset,
+        .size = size,
+        .mappedData = m_mappedData + offset,
+        .ringEnd = m_head
+    };
+}
+
+void VulkanStagingRing::flush(const Region& region)
+{
+    vmaFlushAllocation(VulkanContext::GetDevice().getVmaAllocator(), m_allocation, region.offset, region.size);
+}
+
+void VulkanStagingRing::submitted(const Region& region, VulkanTimeline& timeline, std::uint64_t timelineValue)
+{
+    {
+        std::lock_guard lock(m_mutex);
+
+        // usually the most recent region
+        const auto pending = std::find_if(m_pending.rbegin(), m_pending.rend(), [&region](const PendingRegion& pending) {
+            return pending.end == region.ringEnd;
+        });
+        ASSERT(pending != m_pending.rend() && pending->timeline == nullptr && "Region is not pending submission!");
+
+        pending->timeline = &timeline;
+        pending->timelineValue = timelineValue;
+    }
+    m_submittedCondition.notify_all();
+}
+
+vk::DeviceSize VulkanStagingRing::getMaxAllocationSize() const
+{
+    return m_capacity / 2;
+}
+
+void VulkanStagingRing::reclaim(bool wait)
+{
+    // Waits for the oldest region at most, anything after it is only released if already done.
+    // Regions not submitted yet stop reclaiming, space after them is still in use by their owner
+    bool mayWait = wait;
+    while (!m_pending.empty() && m_pending.front().timeline != nullptr)
+    {
+        const PendingRegion& region = m_pending.front();
+        if (!region.timeline->isReached(region.timelineValue))
+        {
+            if (!mayWait)
+                break;
+
+            region.timeline->wait(region.timelineValue);
+            mayWait = false;
+        }
+
+        m_tail = region.end;
+        m_pending.pop_front();
+    }
+}
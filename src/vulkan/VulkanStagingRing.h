@@ -0,0 +1,97 @@
+#ifndef VULKANSTAGINGRING_H
+#define VULKANSTAGINGRING_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan.hpp>
+
+#include "VulkanTimeline.h"
+#include "utility/NonCopyable.h"
+#include "utility/NonMovable.h"
+#include "utility/Utility.h"
+
+// One persistently mapped host buffer all uploads are staged through. Regions are handed out
+// in ring order and become reusable once the timeline value of the submission reading them
+// is reached, so staging costs a pointer bump and a memcpy instead of an allocation.
+//
+//   Region region = ring.allocate(size);
+//   std::memcpy(region.mappedData, data, size);
+//   ring.flush(region);
+//   ... record copy from region.buffer at region.offset, submit with timeline value N ...
+//   ring.submitted(region, timeline, N);
+//
+// Several threads may stage through the ring, each region is retired by its own submission.
+// Space is reclaimed in ring order, so a full ring waits for other threads to submit their
+// regions first. A region that is never submitted blocks the ring.
+class VulkanStagingRing : NonCopyable, NonMovable
+{
+public:
+    struct Region
+    {
+        vk::Buffer buffer = VK_NULL_HANDLE;
+        vk::DeviceSize offset = 0;
+        vk::DeviceSize size = 0;
+        std::byte* mappedData = nullptr;
+        // ring position right after the region, identifies it in submitted()
+        std::uint64_t ringEnd = 0;
+    };
+
+public:
+    VulkanStagingRing() = default;
+
+    void init(vk::DeviceSize capacity);
+    // GPU must be done with all regions
+    void destroy() noexcept;
+
+    // Waits for older regions to be submitted by other threads and released by GPU when the ring is full.
+    // Size must not exceed getMaxAllocationSize(), larger uploads are split into chunks by the caller.
+    // Throws std::runtime_error when the oldest region belongs to the calling thread and was never
+    // submitted, so waiting can't free anything
+    NODISCARD Region allocate(vk::DeviceSize size, vk::DeviceSize alignment = 16);
+
+    // makes host writes visible to GPU, no-op on coherent memory
+    void flush(const Region& region);
+
+    // region is read by the submission signaling this value, each region is submitted exactly once
+    void submitted(const Region& region, VulkanTimeline& timeline, std::uint64_t timelineValue);
+
+    // half of the ring, so one chunk can be filled while the previous one is being copied
+    NODISCARD vk::DeviceSize getMaxAllocationSize() const;
+
+private:
+    struct PendingRegion
+    {
+        std::uint64_t end;
+        // null until the region is submitted
+        VulkanTimeline* timeline;
+        std::uint64_t timelineValue;
+        // thread that allocated the region and is expected to submit it
+        std::thread::id owner;
+    };
+
+    // expects m_mutex to be locked
+    void reclaim(bool wait);
+
+private:
+    vk::Buffer m_buffer = VK_NULL_HANDLE;
+    VmaAllocation m_allocation = VK_NULL_HANDLE;
+    std::byte* m_mappedData = nullptr;
+    vk::DeviceSize m_capacity = 0;
+
+    std::mutex m_mutex;
+    // notified by submitted(), allocate() waits on it when the oldest region is still being filled
+    std::condition_variable m_submittedCondition;
+    // monotonic positions, buffer offset is position modulo capacity
+    std::uint64_t m_head = 0;
+    std::uint64_t m_tail = 0;
+    // regions GPU may not be done with yet, in ring order
+    std::deque<PendingRegion> m_pending;
+};
+
+#endif //VULKANSTAGINGRING_H
@@ -1,24 +1,200 @@
 #include "VulkanSwapchain.h"
 
+#include <algorithm>
+#include <limits>
+
+#include <spdlog/spdlog.h>
+
 #include "VulkanQueueFamilyIndices.h"
 #include "VulkanSwapchainSupportDetails.h"
 #include "VulkanContext.h"
 
 void VulkanSwapchain::init()
 {
-    createSwapChain();
+    m_presentFencesEnabled = VulkanContext::GetDevice().isSwapchainMaintenanceEnabled();
+    m_presentSerial = 0;
+    m_completedPresentSerial = 0;
+
+    createSwapChain(VK_NULL_HANDLE);
+    createImageViews();
+    m_presentLatencyTracker.init();
+}
+
+bool VulkanSwapchain::recreate()
+{
+    auto swapChainSupportDetails = VulkanSwapchainSupportDetails::QuerySwapChainSupport(
+        VulkanContext::GetPhysicalDevice(),
+        VulkanContext::GetSurface()
+    );
+
+    const vk::Extent2D extent = swapChainSupportDetails.chooseExtent();
+    if (extent.width == 0 || extent.height == 0)
+    {
+        return false;
+    }
+
+    const vk::Format oldFormat = m_swapChainImageFormat;
+    const vk::SwapchainKHR oldSwapchain = m_swapChain;
+    std::vector<vk::ImageView> oldImageViews = std::move(m_swapChainImageViews);
+    m_swapChainImageViews.clear();
+
+    // creating the new swapchain uses the old one, latency thread must be done with it before
+    m_presentLatencyTracker.onSwapchainRetired(oldSwapchain);
+
+    // passing old swapchain lets presentation engine reuse its resources
+    // and keep showing already queued images while the new one is being built
+    createSwapChain(oldSwapchain);
     createImageViews();
+
+    // pipeline is built against swapchain format, so it must not change
+    ASSERT(m_swapChainImageFormat == oldFormat && "Swapchain format changed on recreation!")
+
+    // frames in flight may still render into old images and presentation engine may still show them
+    retireAfterPresents([oldSwapchain, oldImageViews = std::move(oldImageViews)]() {
+        const vk::Device logicalDevice = VulkanContext::GetLogicalDevice();
+        const vk::DispatchLoaderDynamic& dispatch = VulkanContext::GetDispatch();
+        for (const auto& imageView : oldImageViews)
+        {
+            logicalDevice.destroyImageView(imageView, nullptr, dispatch);
+        }
+        logicalDevice.destroySwapchainKHR(oldSwapchain, nullptr, dispatch);
+    });
+
+    spdlog::info("Swapchain recreated with extent {}x{}", m_swapChainExtent.width, m_swapChainExtent.height);
+    return true;
 }
 
 void VulkanSwapchain::destroy() noexcept
 {
     const vk::Device logicalDevice = VulkanContext::GetLogicalDevice();
+    const vk::DispatchLoaderDynamic& dispatch = VulkanContext::GetDispatch();
+
+    m_presentLatencyTracker.destroy();
+
+    // current swapchain must not be destroyed while its presents are pending either
+    try
+    {
+        waitForPresents();
+    }
+    catch (const vk::SystemError& e)
+    {
+        spdlog::error("Failed to wait for pending presents: {}", e.what());
+    }
+    for (const vk::Fence fence : m_freePresentFences)
+    {
+        logicalDevice.destroyFence(fence, nullptr, dispatch);
+    }
+    m_freePresentFences.clear();
 
     for (const auto& imageView : m_swapChainImageViews)
     {
-        logicalDevice.destroyImageView(imageView);
+        logicalDevice.destroyImageView(imageView, nullptr, dispatch);
+    }
+    logicalDevice.destroySwapchainKHR(m_swapChain, nullptr, dispatch);
+}
+
+vk::Fence VulkanSwapchain::nextPresentFence()
+{
+    if (!m_presentFencesEnabled)
+    {
+        // presents are still counted, retirements are released a number of presents later
+        ++m_presentSerial;
+        collectPresents(false);
+        return VK_NULL_HANDLE;
+    }
+
+    collectPresents(false);
+
+    vk::Fence fence;
+    if (m_freePresentFences.empty())
+    {
+        const vk::FenceCreateInfo fenceCreateInfo = {
+            .sType = vk::StructureType::eFenceCreateInfo,
+            .pNext = nullptr,
+            .flags = vk::FenceCreateFlags()
+        };
+        fence = VulkanContext::GetLogicalDevice().createFence(fenceCreateInfo, nullptr, VulkanContext::GetDispatch());
+    }
+    else
+    {
+        fence = m_freePresentFences.back();
+        m_freePresentFences.pop_back();
+    }
+
+    m_pendingPresents.push_back({fence, ++m_presentSerial});
+    return fence;
+}
+
+void VulkanSwapchain::retireAfterPresents(std::function<void()> destroy)
+{
+    const std::uint64_t lastUse = VulkanContext::GetDevice().getGraphicsTimeline().getLastSignaledValue();
+    m_retirements.push_back({m_presentSerial, lastUse, std::move(destroy)});
+    collectPresents(false);
+}
+
+void VulkanSwapchain::waitForPresents()
+{
+    collectPresents(true);
+}
+
+void VulkanSwapchain::collectPresents(bool wait)
+{
+    VulkanDevice& device = VulkanContext::GetDevice();
+    const vk::Device logicalDevice = VulkanContext::GetLogicalDevice();
+    const vk::DispatchLoaderDynamic& dispatch = VulkanContext::GetDispatch();
+
+    // graphics timeline value objects are handed to the deletion queue with, besides their own last use
+    std::uint64_t releaseValue = 0;
+    if (!m_presentFencesEnabled)
+    {
+        if (wait)
+        {
+            // only on shutdown, drains the present queue
+            device.getQueues().presentQueue.waitIdle(dispatch);
+            m_completedPresentSerial = m_presentSerial;
+        }
+        else
+        {
+            // Nothing tells when a present is done. A frame acquires an image only after the presentation
+            // engine released it, so once frames queued that many presents later have finished on the
+            // graphics queue, every image was cycled and the earlier presents are done too
+            const std::uint64_t presentLag = m_swapChainImages.size() + VulkanContext::GetConfig().framesInFlight;
+            if (m_presentSerial >= presentLag)
+            {
+                m_completedPresentSerial = m_presentSerial - presentLag;
+            }
+            releaseValue = device.getGraphicsTimeline().getLastSignaledValue();
+        }
+    }
+
+    while (!m_pendingPresents.empty())
+    {
+        const PendingPresent& present = m_pendingPresents.front();
+        if (wait)
+        {
+            const vk::Result result = logicalDevice.waitForFences(
+                present.fence, VK_TRUE, std::numeric_limits<std::uint64_t>::max(), dispatch);
+            ASSERT(result == vk::Result::eSuccess && "Waiting for present fence failed!");
+        }
+        else if (logicalDevice.getFenceStatus(present.fence, dispatch) != vk::Result::eSuccess)
+        {
+            break;
+        }
+
+        logicalDevice.resetFences(present.fence, dispatch);
+        m_freePresentFences.push_back(present.fence);
+        m_completedPresentSerial = present.serial;
+        m_pendingPresents.pop_front();
+    }
+
+    // presents are done, GPU work that used the objects is handled by the deletion queue
+    VulkanDeletionQueue& deletionQueue = device.getDeletionQueue();
+    while (!m_retirements.empty() && m_retirements.front().presentSerial <= m_completedPresentSerial)
+    {
+        const std::uint64_t lastUse = std::max(m_retirements.front().lastUse, releaseValue);
+        deletionQueue.push(lastUse, std::move(m_retirements.front().destroy));
+        m_retirements.pop_front();
     }
-    logicalDevice.destroySwapchainKHR(m_swapChain);
 }
 
 vk::Extent2D VulkanSwapchain::getExtent() const
@@ -46,27 +222,47 @@ vk::SwapchainKHR VulkanSwapchain::getHandle() const
     return m_swapChain;
 }
 
-std::uint32_t VulkanSwapchain::acquireNextImage(std::uint64_t timeout, vk::Semaphore semaphore, vk::Fence fence)
+std::uint32_t VulkanSwapchain::getImageCount() const
 {
-    std::uint32_t imageIndex;
-    vk::Result result = VulkanContext::GetLogicalDevice().acquireNextImageKHR(m_swapChain, timeout, semaphore, fence, &imageIndex);
-    ASSERT(result == vk::Result::eSuccess && "Acquiring image finished with not success result!")
-    return imageIndex;
+    return static_cast<std::uint32_t>(m_swapChainImages.size());
 }
 
-void VulkanSwapchain::createSwapChain()
+vk::ImageLayout VulkanSwapchain::getFinalLayout() const
+{
+    return vk::ImageLayout::ePresentSrcKHR;
+}
+
+VulkanPresentLatencyTracker& VulkanSwapchain::getPresentLatencyTracker()
+{
+    return m_presentLatencyTracker;
+}
+
+vk::Result VulkanSwapchain::acquireNextImage(std::uint64_t timeout, vk::Semaphore semaphore, vk::Fence fence,
+                                             std::uint32_t& imageIndex)
+{
+    vk::Result result = VulkanContext::GetLogicalDevice().acquireNextImageKHR(m_swapChain, timeout, semaphore, fence, &imageIndex,
+                                                                               VulkanContext::GetDispatch());
+    ASSERT((result == vk::Result::eSuccess ||
+            result == vk::Result::eSuboptimalKHR ||
+            result == vk::Result::eErrorOutOfDateKHR) && "Acquiring image finished with unexpected result!")
+    return result;
+}
+
+void VulkanSwapchain::createSwapChain(vk::SwapchainKHR oldSwapchain)
 {
     vk::PhysicalDevice physicalDevice = VulkanContext::GetPhysicalDevice();
     vk::SurfaceKHR surface = VulkanContext::GetSurface();
     vk::Device logicalDevice = VulkanContext::GetLogicalDevice();
+    const vk::DispatchLoaderDynamic& dispatch = VulkanContext::GetDispatch();
 
     auto swapChainSupportDetails = VulkanSwapchainSupportDetails::QuerySwapChainSupport(physicalDevice, surface);
 
     vk::SurfaceFormatKHR surfaceFormat = swapChainSupportDetails.chooseSurfaceFormat();
-    vk::PresentModeKHR presentMode = swapChainSupportDetails.choosePresentMode();
+    const VulkanConfig& config = VulkanContext::GetConfig();
+    vk::PresentModeKHR presentMode = swapChainSupportDetails.choosePresentMode(config.presentPolicy);
     vk::Extent2D extent = swapChainSupportDetails.chooseExtent();
     vk::SurfaceCapabilitiesKHR capabilities = swapChainSupportDetails.capabilities();
-    std::uint32_t imageCount = swapChainSupportDetails.chooseImageCount();
+    std::uint32_t imageCount = swapChainSupportDetails.chooseImageCount(config.swapchainImageCount);
 
     vk::SwapchainCreateInfoKHR swapChainCreateInfo = {
         .sType = vk::StructureType::eSwapchainCreateInfoKHR,
@@ -84,7 +280,7 @@ void VulkanSwapchain::createSwapChain()
         // opaque, because we don't need blending with other windows
         .presentMode = presentMode,
         .clipped = VK_TRUE,
-        .oldSwapchain = VK_NULL_HANDLE
+        .oldSwapchain = oldSwapchain
     };
 
     VulkanQueueFamilyIndices indices = VulkanQueueFamilyIndices::FindQueueFamilies(physicalDevice, surface);
@@ -105,11 +301,14 @@ void VulkanSwapchain::createSwapChain()
         swapChainCreateInfo.pQueueFamilyIndices = nullptr;
     }
 
-    m_swapChain = logicalDevice.createSwapchainKHR(swapChainCreateInfo);
+    m_swapChain = logicalDevice.createSwapchainKHR(swapChainCreateInfo, nullptr, dispatch);
 
-    m_swapChainImages = logicalDevice.getSwapchainImagesKHR(m_swapChain);
+    m_swapChainImages = logicalDevice.getSwapchainImagesKHR(m_swapChain, dispatch);
     m_swapChainImageFormat = surfaceFormat.format;
     m_swapChainExtent = extent;
+
+    spdlog::info("Swapchain: {} images, present mode {}",
+        m_swapChainImages.size(), vk::to_string(presentMode));
 }
 
 void VulkanSwapchain::createImageViews()
@@ -143,6 +342,7 @@ void VulkanSwapchain::createImageViews()
             .subresourceRange = imageSubresourceRange
         };
 
-        m_swapChainImageViews[i] = VulkanContext::GetLogicalDevice().createImageView(createInfo);
+        m_swapChainImageViews[i] = VulkanContext::GetLogicalDevice().createImageView(
+            createInfo, nullptr, VulkanContext::GetDispatch());
     }
 }
@@ -1,28 +1,75 @@
 #ifndef VULKANSWAPCHAIN_H
 #define VULKANSWAPCHAIN_H
 
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
 #include <vulkan/vulkan.hpp>
 
+#include "VulkanPresentLatencyTracker.h"
+#include "VulkanRenderTarget.h"
 #include "utility/Utility.h"
 
-class VulkanSwapchain {
+class VulkanSwapchain : public VulkanRenderTarget {
 public:
     void init();
     void destroy() noexcept;
 
-    NODISCARD vk::Extent2D getExtent() const;
-    NODISCARD vk::Format getFormat() const;
-    NODISCARD vk::ImageView getImageView(std::uint32_t index) const;
-    NODISCARD vk::Image getImage(std::uint32_t index) const;
+    // Builds new swapchain from the current one. Old swapchain and its image views are
+    // retired with retireAfterPresents(). Returns false if surface has zero extent
+    // (e.g. window is minimized) and swapchain was left untouched.
+    bool recreate();
+
+    // Fence to be signaled by the next present with vk::SwapchainPresentFenceInfoEXT, null without
+    // VK_EXT_swapchain_maintenance1. Must be called right before every present, after its frame was submitted
+    NODISCARD vk::Fence nextPresentFence();
+
+    // Destroys objects used by presents queued so far, e.g. old swapchains and semaphores presents
+    // wait on, once those presents and all GPU work submitted so far are done. Graphics timeline
+    // doesn't cover presents, so without present fences objects are kept until frames queued
+    // image count + frames in flight presents later have finished on the graphics queue
+    void retireAfterPresents(std::function<void()> destroy);
+
+    // blocks until all queued presents are done, retired objects are handed to the deletion queue.
+    // Drains the present queue without present fences, meant for shutdown
+    void waitForPresents();
+
+    NODISCARD vk::Extent2D getExtent() const override;
+    NODISCARD vk::Format getFormat() const override;
+    NODISCARD vk::ImageView getImageView(std::uint32_t index) const override;
+    NODISCARD vk::Image getImage(std::uint32_t index) const override;
+    NODISCARD std::uint32_t getImageCount() const override;
+    NODISCARD vk::ImageLayout getFinalLayout() const override;
     NODISCARD vk::SwapchainKHR getHandle() const;
+    NODISCARD VulkanPresentLatencyTracker& getPresentLatencyTracker();
 
-    std::uint32_t acquireNextImage(std::uint64_t timeout, vk::Semaphore semaphore, vk::Fence fence);
+    // returns eSuccess, eSuboptimalKHR or eErrorOutOfDateKHR
+    vk::Result acquireNextImage(std::uint64_t timeout, vk::Semaphore semaphore, vk::Fence fence, std::uint32_t& imageIndex);
 
 private:
-    void createSwapChain();
+    void createSwapChain(vk::SwapchainKHR oldSwapchain);
     void createImageViews();
+    // retires objects of presents that are done, waits for all of them if wait is set
+    void collectPresents(bool wait);
 
 private:
+    struct PendingPresent
+    {
+        vk::Fence fence;
+        std::uint64_t serial;
+    };
+
+    struct Retirement
+    {
+        // number of presents queued before the objects were retired
+        std::uint64_t presentSerial;
+        // graphics timeline value of the last submission that may have used them
+        std::uint64_t lastUse;
+        std::function<void()> destroy;
+    };
+
     vk::SwapchainKHR m_swapChain = VK_NULL_HANDLE;
 
     std::vector<vk::Image> m_swapChainImages;
@@ -30,6 +77,15 @@ private:
 
     vk::Format m_swapChainImageFormat;
     vk::Extent2D m_swapChainExtent;
+
+    VulkanPresentLatencyTracker m_presentLatencyTracker;
+
+    bool m_presentFencesEnabled = false;
+    std::uint64_t m_presentSerial = 0;
+    std::uint64_t m_completedPresentSerial = 0;
+    std::deque<PendingPresent> m_pendingPresents;
+    std::vector<vk::Fence> m_freePresentFences;
+    std::deque<Retirement> m_retirements;
 };
 
 
@@ -24,15 +24,32 @@ vk::SurfaceFormatKHR VulkanSwapchainSupportDetails::chooseSurfaceFormat() const
     return m_formats.at(0);
 }
 
-vk::PresentModeKHR VulkanSwapchainSupportDetails::choosePresentMode() const
+bool VulkanSwapchainSupportDetails::isPresentModeSupported(vk::PresentModeKHR presentMode) const
 {
-    for (const auto& availablePresentMode : m_presentModes)
+    return std::find(m_presentModes.begin(), m_presentModes.end(), presentMode) != m_presentModes.end();
+}
+
+vk::PresentModeKHR VulkanSwapchainSupportDetails::choosePresentMode(VulkanPresentPolicy policy) const
+{
+    switch (policy)
     {
-        // Mailbox mode is desired because it provides minimum latency but still without tearing
-        if (availablePresentMode == vk::PresentModeKHR::eMailbox)
-        {
-            return availablePresentMode;
-        }
+        case VulkanPresentPolicy::LowestLatency:
+            // Mailbox mode is desired because it provides minimum latency but still without tearing
+            if (isPresentModeSupported(vk::PresentModeKHR::eMailbox))
+                return vk::PresentModeKHR::eMailbox;
+            break;
+        case VulkanPresentPolicy::AllowTearing:
+            if (isPresentModeSupported(vk::PresentModeKHR::eMailbox))
+                return vk::PresentModeKHR::eMailbox;
+            if (isPresentModeSupported(vk::PresentModeKHR::eImmediate))
+                return vk::PresentModeKHR::eImmediate;
+            break;
+        case VulkanPresentPolicy::FifoRelaxed:
+            if (isPresentModeSupported(vk::PresentModeKHR::eFifoRelaxed))
+                return vk::PresentModeKHR::eFifoRelaxed;
+            break;
+        case VulkanPresentPolicy::PowerSaving:
+            break;
     }
 
     // FIFO mode is guaranteed to be available
@@ -63,12 +80,14 @@ vk::Extent2D VulkanSwapchainSupportDetails::chooseExtent() const
     return actualExtent;
 }
 
-std::uint32_t VulkanSwapchainSupportDetails::chooseImageCount() const
+std::uint32_t VulkanSwapchainSupportDetails::chooseImageCount(std::uint32_t requestedCount) const
 {
     // requesting exact minimum may sometimes cause us to wait on the driver
     // to complete internal operations before we can acquire another image to render to.
-    // So we request one more image.
-    std::uint32_t imageCount = m_capabilities.minImageCount + 1;
+    // So by default we request one more image.
+    std::uint32_t imageCount = requestedCount != 0
+                                   ? std::max(requestedCount, m_capabilities.minImageCount)
+                                   : m_capabilities.minImageCount + 1;
 
     // zero value indicates that there is no maximum
     if (m_capabilities.maxImageCount > 0 && imageCount > m_capabilities.maxImageCount)
@@ -3,6 +3,7 @@
 
 #include <vulkan/vulkan.hpp>
 
+#include "VulkanConfig.h"
 #include "utility/Utility.h"
 
 class VulkanSwapchainSupportDetails {
@@ -10,14 +11,17 @@ public:
     NODISCARD bool isAdequate() const;
 
     NODISCARD vk::SurfaceFormatKHR  chooseSurfaceFormat() const;
-    NODISCARD vk::PresentModeKHR    choosePresentMode() const;
+    NODISCARD vk::PresentModeKHR    choosePresentMode(VulkanPresentPolicy policy) const;
     NODISCARD vk::Extent2D          chooseExtent() const;
-    NODISCARD std::uint32_t         chooseImageCount() const;
+    NODISCARD std::uint32_t         chooseImageCount(std::uint32_t requestedCount) const;
 
     NODISCARD vk::SurfaceCapabilitiesKHR capabilities() const;
 
     static VulkanSwapchainSupportDetails QuerySwapChainSupport(const vk::PhysicalDevice& device, const vk::SurfaceKHR& surface);
 
+private:
+    NODISCARD bool isPresentModeSupported(vk::PresentModeKHR presentMode) const;
+
 private:
     vk::SurfaceCapabilitiesKHR m_capabilities;
     std::vector<vk::SurfaceFormatKHR> m_formats;
@@ -0,0 +1,90 @@
+#include "VulkanTimeline.h"
+
+void VulkanTimeline::init(vk::Device device, const vk::DispatchLoaderDynamic& dispatch)
+{
+    m_device = device;
+    m_dispatch = &dispatch;
+
+    vk::SemaphoreTypeCreateInfo typeCreateInfo = {
+        .sType = vk::StructureType::eSemaphoreTypeCreateInfo,
+        .pNext = nullptr,
+        .semaphoreType = vk::SemaphoreType::eTimeline,
+        .initialValue = 0
+    };
+
+    vk::SemaphoreCreateInfo createInfo = {
+        .sType = vk::StructureType::eSemaphoreCreateInfo,
+        .pNext = &typeCreateInfo,
+        .flags = vk::SemaphoreCreateFlags()
+    };
+
+    m_semaphore = m_device.createSemaphore(createInfo, nullptr, *m_dispatch);
+    m_lastSignaledValue = 0;
+    m_completedValue = 0;
+}
+
+void VulkanTimeline::destroy() noexcept
+{
+    m_device.destroySemaphore(m_semaphore, nullptr, *m_dispatch);
+    m_semaphore = VK_NULL_HANDLE;
+}
+
+vk::Semaphore VulkanTimeline::getHandle() const
+{
+    return m_semaphore;
+}
+
+std::uint64_t VulkanTimeline::nextSignalValue()
+{
+    return ++m_lastSignaledValue;
+}
+
+std::uint64_t VulkanTimeline::getLastSignaledValue() const
+{
+    return m_lastSignaledValue;
+}
+
+std::uint64_t VulkanTimeline::getCompletedValue()
+{
+    const std::uint64_t value = m_device.getSemaphoreCounterValue(m_semaphore, *m_dispatch);
+
+    // other thread may have observed a bigger value meanwhile, never move backwards
+    std::uint64_t cached = m_completedValue.load();
+    while (cached < value && !m_completedValue.compare_exchange_weak(cached, value)) {}
+
+    return std::max(cached, value);
+}
+
+bool VulkanTimeline::isReached(std::uint64_t value)
+{
+    if (value <= m_completedValue.load())
+        return true;
+
+    return value <= getCompletedValue();
+}
+
+void VulkanTimeline::wait(std::uint64_t value, std::uint64_t timeout)
+{
+    if (isReached(value))
+        return;
+
+    vk::SemaphoreWaitInfo waitInfo = {
+        .sType = vk::StructureType::eSemaphoreWaitInfo,
+        .pNext = nullptr,
+        .flags = vk::SemaphoreWaitFlags(),
+        .semaphoreCount = 1,
+        .pSemaphores = &m_semaphore,
+        .pValues = &value
+    };
+
+    const vk::Result result = m_device.waitSemaphores(waitInfo, timeout, *m_dispatch);
+    ASSERT(result == vk::Result::eSuccess && "waitSemaphores finished with non success result!")
+
+    std::uint64_t cached = m_completedValue.load();
+    while (cached < value && !m_completedValue.compare_exchange_weak(cached, value)) {}
+}
+
+void VulkanTimeline::waitIdle()
+{
+    wait(getLastSignaledValue());
+}
@@ -0,0 +1,49 @@
+#ifndef VULKANTIMELINE_H
+#define VULKANTIMELINE_H
+
+#include <atomic>
+#include <cstdint>
+
+#include <vulkan/vulkan.hpp>
+
+#include "utility/NonCopyable.h"
+#include "utility/NonMovable.h"
+#include "utility/Utility.h"
+
+// Monotonic GPU progress counter of a single queue, backed by a timeline semaphore.
+// Every submission to the queue signals the next value, so "has GPU finished the work
+// submitted at value N?" is answered by comparing N with the completed value.
+class VulkanTimeline : NonCopyable, NonMovable
+{
+public:
+    VulkanTimeline() = default;
+
+    void init(vk::Device device, const vk::DispatchLoaderDynamic& dispatch);
+    void destroy() noexcept;
+
+    NODISCARD vk::Semaphore getHandle() const;
+
+    // Reserves value to be signaled by the next submission, must be called right before submitting.
+    // Signals must reach the queue in increasing order, so with several threads submitting to it
+    // reserving and submitting have to be done under one lock, reservation alone is not enough
+    NODISCARD std::uint64_t nextSignalValue();
+    NODISCARD std::uint64_t getLastSignaledValue() const;
+
+    // last value reached by GPU, queries the semaphore on every call
+    NODISCARD std::uint64_t getCompletedValue();
+    // queries the semaphore only when the last observed completed value is not enough
+    NODISCARD bool isReached(std::uint64_t value);
+
+    void wait(std::uint64_t value, std::uint64_t timeout = std::numeric_limits<std::uint64_t>::max());
+    void waitIdle();
+
+private:
+    vk::Device m_device = VK_NULL_HANDLE;
+    const vk::DispatchLoaderDynamic* m_dispatch = nullptr;
+    vk::Semaphore m_semaphore = VK_NULL_HANDLE;
+
+    std::atomic<std::uint64_t> m_lastSignaledValue = 0;
+    std::atomic<std::uint64_t> m_completedValue = 0;
+};
+
+#endif //VULKANTIMELINE_H
@@ -0,0 +1,576 @@
+#include "VulkanUploader.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <spdlog/spdlog.h>
+
+#include "VulkanContext.h"
+#include "VulkanDebugUtils.h"
+
+namespace
+{
+    // offset of every copy in the staging region
+    constexpr vk::DeviceSize CopyAlignment = 16;
+
+    vk::DeviceSize AlignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+// ------------ Token ------------
+
+VulkanUploader::Token::Token(std::shared_ptr<State> state)
+    : m_state(std::move(state))
+{
+}
+
+bool VulkanUploader::Token::isReady() const
+{
+    return !m_state || m_state->ready.load(std::memory_order_acquire);
+}
+
+bool VulkanUploader::Token::isFailed() const
+{
+    return m_state && m_state->failed.load(std::memory_order_acquire);
+}
+
+void VulkanUploader::Token::wait() const
+{
+    if (isReady() || isFailed())
+        return;
+
+    ASSERT(m_state->transferValue != 0 && "Waiting for upload batch that was not submitted!");
+
+    VulkanContext::GetDevice().getTransferTimeline().wait(m_state->transferValue);
+    // acquires are submitted in upload order, this one is among the finished ones now
+    VulkanContext::GetUploader().update();
+
+    ASSERT(isReady() && "Upload is finished, but its acquire was not submitted!");
+}
+
+// ------------ Batch ------------
+
+VulkanUploader::Batch::Batch()
+    : m_state(std::make_shared<Token::State>())
+{
+}
+
+VulkanUploader::Batch::~Batch()
+{
+    // e.g. dropped by an exception between addBuffer() and submit(), waiting for these tokens would never end
+    if (!m_copies.empty())
+    {
+        spdlog::error("Upload batch of {} buffers destroyed without being submitted", m_copies.size());
+        m_state->failed.store(true, std::memory_order_release);
+    }
+}
+
+VulkanUploader::Token VulkanUploader::Batch::addBuffer(vk::Buffer dst, vk::DeviceSize dstOffset, const void* data,
+                                                       vk::DeviceSize size, vk::PipelineStageFlags2 dstStage,
+                                                       vk::AccessFlags2 dstAccess, vk::SharingMode sharingMode)
+{
+    ASSERT(size > 0 && "Empty upload!");
+
+    m_copies.push_back({
+        .dst = dst,
+        .dstOffset = dstOffset,
+        .data = static_cast<const std::byte *>(data),
+        .size = size,
+        .dstStage = dstStage,
+        .dstAccess = dstAccess,
+        .sharingMode = sharingMode
+    });
+    m_totalSize += size;
+
+    return Token(m_state);
+}
+
+bool VulkanUploader::Batch::empty() const
+{
+    return m_copies.empty();
+}
+
+vk::DeviceSize VulkanUploader::Batch::getTotalSize() const
+{
+    return m_totalSize;
+}
+
+// ------------ VulkanUploader ------------
+
+void VulkanUploader::init()
+{
+    VulkanDevice& device = VulkanContext::GetDevice();
+    const VulkanQueueFamilyIndices& indices = device.getQueueFamilyIndices();
+
+    m_dedicated = device.hasDedicatedTransferQueue();
+    m_graphicsFamily = indices.graphicsFamily.value();
+    m_transferFamily = m_dedicated ? indices.transferFamily.value() : m_graphicsFamily;
+
+    CreateRing(m_transferCommands, m_transferFamily, device.getTransferTimeline());
+    CreateRing(m_graphicsCommands, m_graphicsFamily, device.getGraphicsTimeline());
+}
+
+void VulkanUploader::destroy() noexcept
+{
+    const Stats stats = getStats();
+    spdlog::info("Uploader: {} ranges staged ({} KiB), {} written directly ({} KiB)",
+                 stats.stagedRanges, stats.stagedBytes / 1024, stats.directRanges, stats.directBytes / 1024);
+
+    DestroyRing(m_transferCommands);
+    DestroyRing(m_graphicsCommands);
+    m_pendingAcquires.clear();
+}
+
+VulkanUploader::Token VulkanUploader::uploadBuffer(vk::Buffer dst, vk::DeviceSize dstOffset, const void* data,
+                                                   vk::DeviceSize size, vk::PipelineStageFlags2 dstStage,
+                                                   vk::AccessFlags2 dstAccess, vk::SharingMode sharingMode)
+{
+    Batch batch;
+    Token token = batch.addBuffer(dst, dstOffset, data, size, dstStage, dstAccess, sharingMode);
+    submit(batch);
+    return token;
+}
+
+VulkanUploader::Token VulkanUploader::submit(Batch& batch)
+{
+    Token token(std::move(batch.m_state));
+    std::vector<Batch::Copy> copies = std::move(batch.m_copies);
+
+    batch.m_copies.clear();
+    batch.m_totalSize = 0;
+    batch.m_state = std::make_shared<Token::State>();
+
+    if (copies.empty())
+    {
+        token.m_state->ready.store(true, std::memory_order_release);
+        return token;
+    }
+
+    std::lock_guard lock(m_mutex);
+
+    m_stats.stagedRanges += copies.size();
+    for (const Batch::Copy& copy : copies)
+    {
+        m_stats.stagedBytes += copy.size;
+    }
+
+    VulkanDevice& device = VulkanContext::GetDevice();
+    VulkanStagingRing& stagingRing = VulkanContext::GetStagingRing();
+    VulkanTimeline& transferTimeline = device.getTransferTimeline();
+    const vk::DispatchLoaderDynamic& dispatch = VulkanContext::GetDispatch();
+    const vk::DeviceSize maxRegionSize = stagingRing.getMaxAllocationSize();
+
+    // Copies are packed into as few staging regions as possible, usually exactly one. Each region
+    // is submitted on its own, so the ring is refilled while GPU copies the previous one.
+    // Submissions to one queue are ordered, barriers after the last region cover all of them
+    std::uint64_t transferValue = 0;
+    std::size_t copyIndex = 0;
+    vk::DeviceSize copyProgress = 0;
+    while (copyIndex < copies.size())
+    {
+        struct Piece
+        {
+            const Batch::Copy* copy;
+            vk::DeviceSize copyOffset;
+            vk::DeviceSize regionOffset;
+            vk::DeviceSize size;
+        };
+
+        // big copies are split between regions
+        std::vector<Piece> pieces;
+        vk::DeviceSize regionSize = 0;
+        while (copyIndex < copies.size())
+        {
+            const Batch::Copy& copy = copies[copyIndex];
+            const vk::DeviceSize regionOffset = AlignUp(regionSize, CopyAlignment);
+            if (regionOffset >= maxRegionSize)
+                break;
+
+            const vk::DeviceSize pieceSize = std::min(copy.size - copyProgress, maxRegionSize - regionOffset);
+            pieces.push_back({&copy, copyProgress, regionOffset, pieceSize});
+            regionSize = regionOffset + pieceSize;
+
+            copyProgress += pieceSize;
+            if (copyProgress == copy.size)
+            {
+                ++copyIndex;
+                copyProgress = 0;
+            }
+        }
+
+        const VulkanStagingRing::Region region = stagingRing.allocate(regionSize, CopyAlignment);
+        for (const Piece& piece : pieces)
+        {
+            std::memcpy(region.mappedData + piece.regionOffset, piece.copy->data + piece.copyOffset, piece.size);
+        }
+        stagingRing.flush(region);
+
+        const vk::CommandBuffer commandBuffer = BeginCommandBuffer(m_transferCommands, "Upload");
+
+        // one call per destination buffer
+        std::vector<vk::BufferCopy> copyRegions;
+        for (std::size_t i = 0; i < pieces.size(); ++i)
+        {
+            copyRegions.push_back({
+                .srcOffset = region.offset + pieces[i].regionOffset,
+                .dstOffset = pieces[i].copy->dstOffset + pieces[i].copyOffset,
+                .size = pieces[i].size
+            });
+
+            if (i + 1 == pieces.size() || pieces[i + 1].copy->dst != pieces[i].copy->dst)
+            {
+                commandBuffer.copyBuffer(region.buffer, pieces[i].copy->dst, copyRegions, dispatch);
+                copyRegions.clear();
+            }
+        }
+
+        if (copyIndex == copies.size())
+        {
+            recordReleaseBarriers(commandBuffer, copies, token.m_state);
+        }
+
+        transferValue = Submit(m_transferCommands, device.getQueues().transferQueue, commandBuffer);
+        stagingRing.submitted(region, transferTimeline, transferValue);
+    }
+
+    token.m_state->transferValue = transferValue;
+    if (!m_dedicated)
+    {
+        // graphics submissions made after this one are ordered after the barriers
+        token.m_state->ready.store(true, std::memory_order_release);
+    }
+
+    return token;
+}
+
+void VulkanUploader::recordReleaseBarriers(vk::CommandBuffer commandBuffer, const std::vector<Batch::Copy>& copies,
+                                           const std::shared_ptr<Token::State>& state)
+{
+    // released to graphics family by the transfer queue, or made visible to graphics reads when there is one queue
+    std::vector<vk::BufferMemoryBarrier2> releaseBarriers;
+    std::vector<vk::BufferMemoryBarrier2> acquireBarriers;
+    for (const Batch::Copy& copy : copies)
+    {
+        if (m_dedicated && copy.sharingMode == vk::SharingMode::eConcurrent)
+        {
+            // nothing to release, signaling the timeline makes the writes available. Acquire side
+            // chains its barrier to the timeline wait, which is done at all stages
+            acquireBarriers.push_back({
+                .sType = vk::StructureType::eBufferMemoryBarrier2,
+                .pNext = nullptr,
+                .srcStageMask = vk::PipelineStageFlagBits2::eAllCommands,
+                .srcAccessMask = vk::AccessFlagBits2::eNone,
+                .dstStageMask = copy.dstStage,
+                .dstAccessMask = copy.dstAccess,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .buffer = copy.dst,
+                .offset = copy.dstOffset,
+                .size = copy.size
+            });
+            continue;
+        }
+
+        const vk::BufferMemoryBarrier2 releaseBarrier = {
+            .sType = vk::StructureType::eBufferMemoryBarrier2,
+            .pNext = nullptr,
+            .srcStageMask = vk::PipelineStageFlagBits2::eCopy,
+            .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+            .dstStageMask = m_dedicated ? vk::PipelineStageFlagBits2::eNone : copy.dstStage,
+            .dstAccessMask = m_dedicated ? vk::AccessFlagBits2::eNone : copy.dstAccess,
+            .srcQueueFamilyIndex = m_dedicated ? m_transferFamily : VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = m_dedicated ? m_graphicsFamily : VK_QUEUE_FAMILY_IGNORED,
+            .buffer = copy.dst,
+            .offset = copy.dstOffset,
+            .size = copy.size
+        };
+        releaseBarriers.push_back(releaseBarrier);
+
+        if (m_dedicated)
+        {
+            vk::BufferMemoryBarrier2 acquireBarrier = releaseBarrier;
+            acquireBarrier.srcStageMask = vk::PipelineStageFlagBits2::eNone;
+            acquireBarrier.srcAccessMask = vk::AccessFlagBits2::eNone;
+            acquireBarrier.dstStageMask = copy.dstStage;
+            acquireBarrier.dstAccessMask = copy.dstAccess;
+            acquireBarriers.push_back(acquireBarrier);
+        }
+    }
+
+    const vk::DependencyInfo dependencyInfo = {
+        .sType = vk::StructureType::eDependencyInfo,
+        .pNext = nullptr,
+        .dependencyFlags = vk::DependencyFlags(),
+        .memoryBarrierCount = 0,
+        .pMemoryBarriers = nullptr,
+        .bufferMemoryBarrierCount = static_cast<std::uint32_t>(releaseBarriers.size()),
+        .pBufferMemoryBarriers = releaseBarriers.data(),
+        .imageMemoryBarrierCount = 0,
+        .pImageMemoryBarriers = nullptr
+    };
+    if (!releaseBarriers.empty())
+    {
+        commandBuffer.pipelineBarrier2(dependencyInfo, VulkanContext::GetDispatch());
+    }
+
+    if (m_dedicated)
+    {
+        m_pendingAcquires.push_back({state, std::move(acquireBarriers)});
+    }
+}
+
+void VulkanUploader::update()
+{
+    std::lock_guard lock(m_mutex);
+    submitAcquiresLocked();
+}
+
+std::uint64_t VulkanUploader::copyBuffers(std::span<const GpuCopy> copies, vk::PipelineStageFlags2 dstStage,
+                                          vk::AccessFlags2 dstAccess)
+{
+    std::lock_guard lock(m_mutex);
+
+    const vk::DispatchLoaderDynamic& dispatch = VulkanContext::GetDispatch();
+    const vk::CommandBuffer commandBuffer = BeginCommandBuffer(m_graphicsCommands, "GPU copy");
+
+    for (const GpuCopy& copy : copies)
+    {
+        commandBuffer.copyBuffer(copy.src, copy.dst, copy.regions, dispatch);
+    }
+
+    const vk::MemoryBarrier2 barrier = {
+        .sType = vk::StructureType::eMemoryBarrier2,
+        .pNext = nullptr,
+        .srcStageMask = vk::PipelineStageFlagBits2::eCopy,
+        .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+        .dstStageMask = dstStage,
+        .dstAccessMask = dstAccess
+    };
+
+    const vk::DependencyInfo dependencyInfo = {
+        .sType = vk::StructureType::eDependencyInfo,
+        .pNext = nullptr,
+        .dependencyFlags = vk::DependencyFlags(),
+        .memoryBarrierCount = 1,
+        .pMemoryBarriers = &barrier,
+        .bufferMemoryBarrierCount = 0,
+        .pBufferMemoryBarriers = nullptr,
+        .imageMemoryBarrierCount = 0,
+        .pImageMemoryBarriers = nullptr
+    };
+    commandBuffer.pipelineBarrier2(dependencyInfo, dispatch);
+
+    // every graphics submission signals the timeline, so frame slots and deletion queue keep working
+    return Submit(m_graphicsCommands, VulkanContext::GetDevice().getQueues().graphicsQueue, commandBuffer);
+}
+
+bool VulkanUploader::writeDirect(VmaAllocation allocation, vk::DeviceSize offset, const void* data,
+                                 vk::DeviceSize size)
+{
+    const VmaAllocator allocator = VulkanContext::GetDevice().getVmaAllocator();
+
+    // with ALLOW_TRANSFER_INSTEAD, VMA maps the allocation only if it ended up host visible
+    VmaAllocationInfo allocationInfo;
+    vmaGetAllocationInfo(allocator, allocation, &allocationInfo);
+    if (!allocationInfo.pMappedData)
+        return false;
+
+    std::memcpy(static_cast<std::byte *>(allocationInfo.pMappedData) + offset, data, size);
+    // submissions made afterwards see host writes, flush is only needed on non-coherent memory
+    vmaFlushAllocation(allocator, allocation, offset, size);
+
+    std::lock_guard lock(m_mutex);
+    ++m_stats.directRanges;
+    m_stats.directBytes += size;
+    return true;
+}
+
+std::size_t VulkanUploader::getPendingCount() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_pendingAcquires.size();
+}
+
+VulkanUploader::Stats VulkanUploader::getStats() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_stats;
+}
+
+VmaAllocationCreateFlags VulkanUploader::GetDirectWriteAllocationFlags()
+{
+    if (!VulkanContext::GetConfig().directBufferWrites)
+        return 0;
+
+    return VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+           VMA_ALLOCATION_CREATE_HOST_ACCESS_ALLOW_TRANSFER_INSTEAD_BIT |
+           VMA_ALLOCATION_CREATE_MAPPED_BIT;
+}
+
+std::vector<std::uint32_t> VulkanUploader::GetSharingFamilies()
+{
+    const VulkanQueueFamilyIndices& indices = VulkanContext::GetDevice().getQueueFamilyIndices();
+    if (!indices.transferFamily.has_value())
+        return {};
+
+    return {indices.graphicsFamily.value(), indices.transferFamily.value()};
+}
+
+void VulkanUploader::CreateRing(CommandBufferRing& ring, std::uint32_t queueFamily, VulkanTimeline& timeline)
+{
+    vk::CommandPoolCreateInfo commandPoolCreateInfo = {
+        .sType = vk::StructureType::eCommandPoolCreateInfo,
+        .pNext = nullptr,
+        .flags = vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+        .queueFamilyIndex = queueFamily
+    };
+
+    ring.pool = VulkanContext::GetLogicalDevice().createCommandPool(
+        commandPoolCreateInfo, nullptr, VulkanContext::GetDispatch());
+    ring.timeline = &timeline;
+}
+
+void VulkanUploader::DestroyRing(CommandBufferRing& ring) noexcept
+{
+    // command buffers are freed together with the pool
+    if (ring.pool)
+    {
+        VulkanContext::GetLogicalDevice().destroyCommandPool(ring.pool, nullptr, VulkanContext::GetDispatch());
+    }
+
+    ring.pool = VK_NULL_HANDLE;
+    ring.submitted.clear();
+    ring.free.clear();
+}
+
+vk::CommandBuffer VulkanUploader::BeginCommandBuffer(CommandBufferRing& ring, const char* label)
+{
+    while (!ring.submitted.empty() && ring.timeline->isReached(ring.submitted.front().second))
+    {
+        ring.free.push_back(ring.submitted.front().first);
+        ring.submitted.pop_front();
+    }
+
+    vk::CommandBuffer commandBuffer;
+    if (ring.free.empty())
+    {
+        vk::CommandBufferAllocateInfo allocateInfo = {
+            .sType = vk::StructureType::eCommandBufferAllocateInfo,
+            .pNext = nullptr,
+            .commandPool = ring.pool,
+            .level = vk::CommandBufferLevel::ePrimary,
+            .commandBufferCount = 1
+        };
+
+        commandBuffer = VulkanContext::GetLogicalDevice().allocateCommandBuffers(
+            allocateInfo, VulkanContext::GetDispatch()).front();
+    }
+    else
+    {
+        commandBuffer = ring.free.back();
+        ring.free.pop_back();
+    }
+
+    const vk::CommandBufferBeginInfo beginInfo = {
+        .sType = vk::StructureType::eCommandBufferBeginInfo,
+        .pNext = nullptr,
+        .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+        .pInheritanceInfo = nullptr
+    };
+
+    // pool allows resetting single buffers, so begin resets the recycled one implicitly
+    commandBuffer.begin(beginInfo, VulkanContext::GetDispatch());
+    VulkanDebugUtils::BeginLabel(commandBuffer, label, VulkanContext::GetDispatch());
+    return commandBuffer;
+}
+
+std::uint64_t VulkanUploader::Submit(CommandBufferRing& ring, vk::Queue queue, vk::CommandBuffer commandBuffer,
+                                     const VulkanTimeline* waitTimeline, std::uint64_t waitValue)
+{
+    const vk::DispatchLoaderDynamic& dispatch = VulkanContext::GetDispatch();
+
+    VulkanDebugUtils::EndLabel(commandBuffer, dispatch);
+    commandBuffer.end(dispatch);
+
+    const vk::Semaphore signalSemaphore = ring.timeline->getHandle();
+    const std::uint64_t signalValue = ring.timeline->nextSignalValue();
+
+    const vk::Semaphore waitSemaphore = waitTimeline ? waitTimeline->getHandle() : VK_NULL_HANDLE;
+    const vk::PipelineStageFlags waitStage = vk::PipelineStageFlagBits::eAllCommands;
+
+    vk::TimelineSemaphoreSubmitInfo timelineSubmitInfo = {
+        .sType = vk::StructureType::eTimelineSemaphoreSubmitInfo,
+        .pNext = nullptr,
+        .waitSemaphoreValueCount = waitTimeline ? 1u : 0u,
+        .pWaitSemaphoreValues = &waitValue,
+        .signalSemaphoreValueCount = 1,
+        .pSignalSemaphoreValues = &signalValue
+    };
+
+    vk::SubmitInfo submitInfo = {
+        .sType = vk::StructureType::eSubmitInfo,
+        .pNext = &timelineSubmitInfo,
+        .waitSemaphoreCount = waitTimeline ? 1u : 0u,
+        .pWaitSemaphores = &waitSemaphore,
+        .pWaitDstStageMask = &waitStage,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &commandBuffer,
+        .signalSemaphoreCount = 1,
+        .pSignalSemaphores = &signalSemaphore
+    };
+
+    queue.submit(submitInfo, VK_NULL_HANDLE, dispatch);
+
+    ring.submitted.emplace_back(commandBuffer, signalValue);
+    return signalValue;
+}
+
+void VulkanUploader::submitAcquiresLocked()
+{
+    if (m_pendingAcquires.empty())
+        return;
+
+    VulkanTimeline& transferTimeline = VulkanContext::GetDevice().getTransferTimeline();
+
+    // acquire must not run before the release, so only finished uploads are taken.
+    // Waiting on the timeline is then already satisfied and graphics queue never stalls on transfers
+    std::vector<vk::BufferMemoryBarrier2> barriers;
+    std::vector<std::shared_ptr<Token::State>> acquired;
+    std::uint64_t lastTransferValue = 0;
+    while (!m_pendingAcquires.empty() && transferTimeline.isReached(m_pendingAcquires.front().state->transferValue))
+    {
+        PendingAcquire& pending = m_pendingAcquires.front();
+        barriers.insert(barriers.end(), pending.barriers.begin(), pending.barriers.end());
+        lastTransferValue = pending.state->transferValue;
+        acquired.push_back(std::move(pending.state));
+        m_pendingAcquires.pop_front();
+    }
+
+    if (barriers.empty())
+        return;
+
+    const vk::CommandBuffer commandBuffer = BeginCommandBuffer(m_graphicsCommands, "Upload acquire");
+
+    const vk::DependencyInfo dependencyInfo = {
+        .sType = vk::StructureType::eDependencyInfo,
+        .pNext = nullptr,
+        .dependencyFlags = vk::DependencyFlags(),
+        .memoryBarrierCount = 0,
+        .pMemoryBarriers = nullptr,
+        .bufferMemoryBarrierCount = static_cast<std::uint32_t>(barriers.size()),
+        .pBufferMemoryBarriers = barriers.data(),
+        .imageMemoryBarrierCount = 0,
+        .pImageMemoryBarriers = nullptr
+    };
+    commandBuffer.pipelineBarrier2(dependencyInfo, VulkanContext::GetDispatch());
+
+    Submit(m_graphicsCommands, VulkanContext::GetDevice().getQueues().graphicsQueue, commandBuffer,
+           &transferTimeline, lastTransferValue);
+
+    for (const std::shared_ptr<Token::State>& state : acquired)
+    {
+        state->ready.store(true, std::memory_order_release);
+    }
+}
@@ -0,0 +1,218 @@
+#ifndef VULKANUPLOADER_H
+#define VULKANUPLOADER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan.hpp>
+
+#include "VulkanTimeline.h"
+#include "utility/NonCopyable.h"
+#include "utility/NonMovable.h"
+#include "utility/Utility.h"
+
+// Copies data into device local buffers through the staging ring without blocking the caller.
+//
+// With a dedicated transfer family copies run on the transfer queue, and buffers are released
+// to graphics family at the end of the upload. The matching acquire is submitted to graphics queue
+// by update() once the copy is done, so graphics never waits for a transfer in progress.
+// Without one, copies are submitted to graphics queue directly and need no ownership transfer.
+//
+// Many uploads are coalesced with a Batch: their data is packed into one staging region,
+// all copies are recorded into one command buffer and submitted once, with a single token.
+//
+// Buffers allocated with GetDirectWriteAllocationFlags() may end up in host visible device local
+// memory (integrated GPUs, resizable BAR). writeDirect() fills those through their mapping instead,
+// without staging, copy or submission.
+//
+// Uploads, update() and copyBuffers() submit to graphics queue, so they must run on the thread submitting frames.
+class VulkanUploader : NonCopyable, NonMovable
+{
+public:
+    class Batch;
+
+    // completion of an upload, copies share the same state
+    class Token
+    {
+    public:
+        // empty token is ready
+        Token() = default;
+
+        // graphics submissions made from now on see the uploaded data
+        NODISCARD bool isReady() const;
+        // batch was destroyed without being submitted, token never becomes ready
+        NODISCARD bool isFailed() const;
+
+        // blocks until the copy is done and submits the acquire if it's still pending, returns right away if failed
+        void wait() const;
+
+    private:
+        friend class VulkanUploader;
+        friend class Batch;
+
+        struct State
+        {
+            std::atomic<bool> ready = false;
+            std::atomic<bool> failed = false;
+            // transfer timeline value signaled by the copy
+            std::uint64_t transferValue = 0;
+        };
+
+        explicit Token(std::shared_ptr<State> state);
+
+        std::shared_ptr<State> m_state;
+    };
+
+    // uploads collected to be submitted together, reusable after submit()
+    class Batch : NonCopyable
+    {
+    public:
+        Batch();
+        // tokens of uploads that were never submitted are marked failed
+        ~Batch();
+
+        // data is read at submit(), it must stay alive until then. Returned token is shared
+        // by the whole batch and must not be waited for before the batch is submitted.
+        // Buffers shared by graphics and transfer families (see GetSharingFamilies) need no ownership transfer
+        NODISCARD Token addBuffer(vk::Buffer dst, vk::DeviceSize dstOffset, const void* data, vk::DeviceSize size,
+                                  vk::PipelineStageFlags2 dstStage, vk::AccessFlags2 dstAccess,
+                                  vk::SharingMode sharingMode = vk::SharingMode::eExclusive);
+
+        NODISCARD bool empty() const;
+        NODISCARD vk::DeviceSize getTotalSize() const;
+
+    private:
+        friend class VulkanUploader;
+
+        struct Copy
+        {
+            vk::Buffer dst;
+            vk::DeviceSize dstOffset;
+            const std::byte* data;
+            vk::DeviceSize size;
+            vk::PipelineStageFlags2 dstStage;
+            vk::AccessFlags2 dstAccess;
+            vk::SharingMode sharingMode;
+        };
+
+        std::vector<Copy> m_copies;
+        vk::DeviceSize m_totalSize = 0;
+        std::shared_ptr<Token::State> m_state;
+    };
+
+    // copy between two device buffers
+    struct GpuCopy
+    {
+        vk::Buffer src;
+        vk::Buffer dst;
+        std::vector<vk::BufferCopy> regions;
+    };
+
+    struct Stats
+    {
+        // counted per uploaded range, not per buffer: a geometry arena mesh is two ranges and
+        // its vertices and indices may take different paths. Ranges copied through the staging ring
+        std::uint64_t stagedRanges = 0;
+        std::uint64_t stagedBytes = 0;
+        // ranges written by host directly
+        std::uint64_t directRanges = 0;
+        std::uint64_t directBytes = 0;
+    };
+
+public:
+    VulkanUploader() = default;
+
+    void init();
+    // GPU must be idle
+    void destroy() noexcept;
+
+    // dstStage and dstAccess describe how graphics reads the buffer afterwards. Data is copied
+    // into the staging ring before returning, so it doesn't have to outlive the call
+    NODISCARD Token uploadBuffer(vk::Buffer dst, vk::DeviceSize dstOffset, const void* data, vk::DeviceSize size,
+                                 vk::PipelineStageFlags2 dstStage, vk::AccessFlags2 dstAccess,
+                                 vk::SharingMode sharingMode = vk::SharingMode::eExclusive);
+
+    // one submission for the whole batch, unless it doesn't fit into the staging ring at once.
+    // Batch is empty afterwards and hands out new tokens
+    Token submit(Batch& batch);
+
+    // submits acquires of finished uploads to graphics queue, called every frame
+    void update();
+
+    // Copies on graphics queue and makes results visible to dstStage and dstAccess, for moving data
+    // frames read from. Submissions made afterwards see it without a token. Returns graphics timeline
+    // value signaled by the copy, sources must stay alive until it's reached
+    std::uint64_t copyBuffers(std::span<const GpuCopy> copies, vk::PipelineStageFlags2 dstStage,
+                              vk::AccessFlags2 dstAccess);
+
+    // Writes data through the mapping of the allocation if it's host visible, GPU sees it from
+    // the next submission on. Range must not be in use by GPU. Returns false if it has to be uploaded
+    NODISCARD bool writeDirect(VmaAllocation allocation, vk::DeviceSize offset, const void* data, vk::DeviceSize size);
+
+    // number of uploads whose data is not yet visible to graphics
+    NODISCARD std::size_t getPendingCount() const;
+    NODISCARD Stats getStats() const;
+
+    // for device local buffers written by uploads, lets VMA pick host visible memory where it is
+    // device local as well, and map it. Zero when direct writes are disabled in config
+    NODISCARD static VmaAllocationCreateFlags GetDirectWriteAllocationFlags();
+
+    // queue families to list for buffers created with concurrent sharing, which are written by
+    // uploads while graphics reads other ranges of them. Empty if uploads go to graphics queue
+    NODISCARD static std::vector<std::uint32_t> GetSharingFamilies();
+
+private:
+    // command buffers of one queue family, reused once the timeline passes their last submission
+    struct CommandBufferRing
+    {
+        vk::CommandPool pool = VK_NULL_HANDLE;
+        VulkanTimeline* timeline = nullptr;
+        std::deque<std::pair<vk::CommandBuffer, std::uint64_t>> submitted;
+        std::vector<vk::CommandBuffer> free;
+    };
+
+    struct PendingAcquire
+    {
+        std::shared_ptr<Token::State> state;
+        std::vector<vk::BufferMemoryBarrier2> barriers;
+    };
+
+    static void CreateRing(CommandBufferRing& ring, std::uint32_t queueFamily, VulkanTimeline& timeline);
+    static void DestroyRing(CommandBufferRing& ring) noexcept;
+    // begun command buffer, its commands are wrapped in a debug label for capture tools
+    static vk::CommandBuffer BeginCommandBuffer(CommandBufferRing& ring, const char* label);
+    // ends the label and the command buffer and submits it, optionally waiting on a timeline value of another queue
+    static std::uint64_t Submit(CommandBufferRing& ring, vk::Queue queue, vk::CommandBuffer commandBuffer,
+                                const VulkanTimeline* waitTimeline = nullptr, std::uint64_t waitValue = 0);
+
+    // expects m_mutex to be locked
+    void recordReleaseBarriers(vk::CommandBuffer commandBuffer, const std::vector<Batch::Copy>& copies,
+                               const std::shared_ptr<Token::State>& state);
+    void submitAcquiresLocked();
+
+private:
+    mutable std::mutex m_mutex;
+
+    bool m_dedicated = false;
+    std::uint32_t m_transferFamily = 0;
+    std::uint32_t m_graphicsFamily = 0;
+
+    CommandBufferRing m_transferCommands;
+    // acquires and copies on graphics queue
+    CommandBufferRing m_graphicsCommands;
+
+    // in upload order, so in transfer timeline order
+    std::deque<PendingAcquire> m_pendingAcquires;
+
+    Stats m_stats;
+};
+
+#endif //VULKANUPLOADER_H